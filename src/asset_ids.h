@@ -0,0 +1,85 @@
+/// Asset IDs (header)
+/// Generated from assets/global.ass with "make asset_ids", do not edit
+
+#ifndef __ASSET_IDS__
+#define __ASSET_IDS__
+
+/// Asset IDs
+enum
+{
+    ASSET_ID_PLAYER = 0,
+    ASSET_ID_TILES1 = 1,
+    ASSET_ID_SKY1 = 2,
+    ASSET_ID_SKY2 = 3,
+    ASSET_ID_SKY3 = 4,
+    ASSET_ID_SKY4 = 5,
+    ASSET_ID_SKY5 = 6,
+    ASSET_ID_CLOUDS1 = 7,
+    ASSET_ID_CLOUDS2 = 8,
+    ASSET_ID_FONT = 9,
+    ASSET_ID_BOULDER = 10,
+    ASSET_ID_KEY = 11,
+    ASSET_ID_STAR = 12,
+    ASSET_ID_LOCK = 13,
+    ASSET_ID_ICONS = 14,
+    ASSET_ID_COMPL = 15,
+    ASSET_ID_ENEMY = 16,
+    ASSET_ID_BIG_STAR = 17,
+    ASSET_ID_BIG_CURSOR = 18,
+    ASSET_ID_STAGE_BUTTONS = 19,
+    ASSET_ID_COIN = 20,
+    ASSET_ID_ELECTRICITY = 21,
+    ASSET_ID_LOGO = 22,
+    ASSET_ID_BLACK_CIRCLE = 23,
+    ASSET_ID_INTRO_IMG = 24,
+    ASSET_ID_THE_END = 25,
+    ASSET_ID_BOTTLE = 26,
+    ASSET_ID_HELP = 27,
+    ASSET_ID_01 = 28,
+    ASSET_ID_02 = 29,
+    ASSET_ID_03 = 30,
+    ASSET_ID_04 = 31,
+    ASSET_ID_05 = 32,
+    ASSET_ID_06 = 33,
+    ASSET_ID_07 = 34,
+    ASSET_ID_08 = 35,
+    ASSET_ID_09 = 36,
+    ASSET_ID_10 = 37,
+    ASSET_ID_11 = 38,
+    ASSET_ID_12 = 39,
+    ASSET_ID_13 = 40,
+    ASSET_ID_14 = 41,
+    ASSET_ID_15 = 42,
+    ASSET_ID_16 = 43,
+    ASSET_ID_17 = 44,
+    ASSET_ID_18 = 45,
+    ASSET_ID_19 = 46,
+    ASSET_ID_20 = 47,
+    ASSET_ID_21 = 48,
+    ASSET_ID_22 = 49,
+    ASSET_ID_23 = 50,
+    ASSET_ID_24 = 51,
+    ASSET_ID_25 = 52,
+    ASSET_ID_THEME = 53,
+    ASSET_ID_CLEAR = 54,
+    ASSET_ID_MENU = 55,
+    ASSET_ID_FINAL = 56,
+    ASSET_ID_ENDING = 57,
+    ASSET_ID_JUMP = 58,
+    ASSET_ID_DIE = 59,
+    ASSET_ID_THWOMP = 60,
+    ASSET_ID_TRANSF = 61,
+    ASSET_ID_GET_KEY = 62,
+    ASSET_ID_OPEN_LOCK = 63,
+    ASSET_ID_PUSH = 64,
+    ASSET_ID_ACCEPT = 65,
+    ASSET_ID_SELECT = 66,
+    ASSET_ID_PAUSE = 67,
+    ASSET_ID_RESTART = 68,
+    ASSET_ID_GET_COIN = 69,
+    ASSET_ID_REJECT = 70,
+    ASSET_ID_FAILURE = 71,
+    ASSET_ID_COUNT = 72
+};
+
+#endif // __ASSET_IDS__
@@ -15,6 +15,7 @@
 #include "vpad.h"
 #include "global.h"
 #include "transition.h"
+#include "asset_ids.h"
 
 #include "stdio.h"
 #include "stdlib.h"
@@ -46,6 +47,12 @@ static float plPos;
 // Bottle wave
 static float wave;
 
+// Assets preloaded when the scene starts
+static const int ENDING_ASSETS[] = {
+    ASSET_ID_SKY5, ASSET_ID_PLAYER, ASSET_ID_TILES1, ASSET_ID_THE_END, ASSET_ID_BOTTLE,
+    ASSET_ID_STAR, ASSET_ID_ENDING, ASSET_ID_CLEAR, ASSET_ID_FAILURE,
+};
+
 // Is victory
 static bool isVictory;
 
@@ -290,6 +297,8 @@ static void ending_draw()
 // Swap to endingions
 static void ending_on_swap()
 {
+    preload_asset_set(get_global_assets(),ENDING_ASSETS,sizeof(ENDING_ASSETS) / sizeof(int));
+
     play_music(mEnding,0.70f,-1);
     ending_reset();
 }
@@ -8,7 +8,9 @@
 
 #include "controls.h"
 #include "graphics.h"
+#include "textcache.h"
 #include "assets.h"
+#include "hotreload.h"
 #include "music.h"
 #include "sample.h"
 
@@ -35,6 +37,12 @@ static int newTicks;
 // (Timer) delta time
 static int deltaTime;
 
+// Maximum amount of fixed steps per frame
+#define MAX_STEPS_PER_FRAME 5
+
+// Interpolation between the last two updates
+static float interpolation = 1.0f;
+
 // Canvas pos
 static SDL_Point canvasPos;
 // Canvas size
@@ -112,7 +120,12 @@ static int app_init_SDL()
         app_toggle_fullscreen();
 
     // Create renderer
-    rend = SDL_CreateRenderer(window,-1,SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE);
+    Uint32 flags = config.softwareRendering ? SDL_RENDERER_SOFTWARE
+        : (SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE);
+    if(config.vsync)
+        flags |= SDL_RENDERER_PRESENTVSYNC;
+
+    rend = SDL_CreateRenderer(window,-1,flags);
     if(rend == NULL)
     {
         SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Failed to create an SDL renderer!\n",NULL);
@@ -163,12 +176,28 @@ static int app_init(SCENE* arrScenes, int count, const char* assPath)
     init_graphics();
     set_global_renderer(rend);
 
-    // Create canvas
-    canvas = SDL_CreateTexture(rend,
-        SDL_PIXELFORMAT_RGBA8888,
-        SDL_TEXTUREACCESS_TARGET,
-        config.canvasWidth,
-        config.canvasHeight);
+    // Create canvas. With software rendering the canvas
+    // is drawn in memory and streamed to the texture
+    if(config.softwareRendering)
+    {
+        if(enable_software_rendering(config.canvasWidth,config.canvasHeight) != 0)
+        {
+            return 1;
+        }
+        canvas = SDL_CreateTexture(rend,
+            SDL_PIXELFORMAT_RGBA32,
+            SDL_TEXTUREACCESS_STREAMING,
+            config.canvasWidth,
+            config.canvasHeight);
+    }
+    else
+    {
+        canvas = SDL_CreateTexture(rend,
+            SDL_PIXELFORMAT_RGBA8888,
+            SDL_TEXTUREACCESS_TARGET,
+            config.canvasWidth,
+            config.canvasHeight);
+    }
     if(canvas == NULL)
     {
         SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Failed to create a texture!\n",NULL);
@@ -180,6 +209,10 @@ static int app_init(SCENE* arrScenes, int count, const char* assPath)
     SDL_GetWindowSize(window,&w,&h);
     app_calc_canvas_prop(w,h);
 
+    // Asset packs are loaded by the scenes
+    set_asset_budget((size_t)config.assetBudget * 1024);
+    enable_hot_reload(config.hotReload);
+
     // Initialize audio
     init_samples();
     if(init_music() == 1)
@@ -243,6 +276,12 @@ static void app_events()
             }
             break;
         
+        // The render targets lost their contents. A device
+        // reset that loses every texture is not recovered from
+        case SDL_RENDER_TARGETS_RESET:
+            render_targets_lost();
+            break;
+
         // Key down event
         case SDL_KEYDOWN:
             ctr_on_key_down(event.key.keysym.scancode);
@@ -320,13 +359,8 @@ static void app_events()
 
 
 // Update application
-static void app_update(Uint32 delta)
+static void app_update(float tm)
 {
-    // Calculate timer multiplier
-    float tm = (float)((float)delta/1000.0f) / (1.0f/60.0f);
-    // Limit tm (in other words, limit minimum fps)
-    if(tm > 5.0) tm = 5.0;
-
     // Quit
     if(get_key_state(SDL_SCANCODE_LCTRL) == DOWN &&
        get_key_state(SDL_SCANCODE_Q) == PRESSED)
@@ -361,24 +395,55 @@ static void app_update(Uint32 delta)
 // Draw application
 static void app_draw()
 {
-    // Clear to black
-    clear(0,0,0);
+    // Draw to the render targets before the frame
+    render_text_runs();
+    if(currentScene.on_draw_targets != NULL)
+    {
+        currentScene.on_draw_targets();
+    }
+    if(globalScene.on_draw_targets != NULL)
+    {
+        globalScene.on_draw_targets();
+    }
 
-    // Set target to the canvas texture
-    SDL_SetRenderTarget(rend,canvas);
+    if(!config.softwareRendering)
+    {
+        // Clear to black
+        clear(0,0,0);
+        flush_graphics();
+
+        // Set target to the canvas texture
+        SDL_SetRenderTarget(rend,canvas);
+    }
 
-    // Draw global & current scenes
+    // Draw global & current scenes. The draw calls are
+    // queued and submitted at once
+    set_draw_layer(0,false);
     if(currentScene.on_draw != NULL)
     {
         currentScene.on_draw();
     }
+    set_draw_layer(DRAW_LAYER_TOP,false);
     if(globalScene.on_draw != NULL)
     {
         globalScene.on_draw();
     }
+    flush_graphics();
+
+    if(config.softwareRendering)
+    {
+        // Upload the framebuffer and clear the window
+        BITMAP* fb = get_framebuffer();
+        SDL_UpdateTexture(canvas,NULL,fb->pixels,fb->w*4);
 
-    // Set target back to the main window
-    SDL_SetRenderTarget(rend,NULL);
+        SDL_SetRenderDrawColor(rend,0,0,0,255);
+        SDL_RenderClear(rend);
+    }
+    else
+    {
+        // Set target back to the main window
+        SDL_SetRenderTarget(rend,NULL);
+    }
 
     // Draw frame
     SDL_Rect dest = (SDL_Rect){canvasPos.x,canvasPos.y,canvasSize.x,canvasSize.y};
@@ -392,6 +457,9 @@ static void app_draw()
 // Destroy application
 static void app_destroy()
 {
+    // Stop decoding before the music is freed
+    quit_music();
+
     // Destroy scenes
     int i = 0;
     if(scenes[i].on_destroy != NULL)
@@ -399,6 +467,7 @@ static void app_destroy()
         scenes[i].on_destroy();
     }
 
+    destroy_text_cache();
     SDL_DestroyRenderer(rend);
     SDL_DestroyWindow(window);
 
@@ -441,24 +510,27 @@ void app_terminate()
 }
 
 
-// Run application
-int app_run(SCENE* arrScenes, int count, CONFIG c)
+// Main loop with a variable time step
+static void app_loop_variable()
 {
-    config = c;
-
     // Calculate frame wait value
     int frame_wait = (int)round(1000.0f / config.fps);
 
-    if(app_init(arrScenes,count,NULL) != 0) return 1;
+    float tm;
 
     while(isRunning)
     {
         // Set old time
         oldTicks = SDL_GetTicks();
 
+        // Calculate timer multiplier
+        tm = (float)((float)deltaTime/1000.0f) / (1.0f/60.0f);
+        // Limit tm (in other words, limit minimum fps)
+        if(tm > 5.0) tm = 5.0;
+
         // Update frame
         app_events();
-        app_update(deltaTime);
+        app_update(tm);
         app_draw();
 
         // Set new time
@@ -471,9 +543,86 @@ int app_run(SCENE* arrScenes, int count, CONFIG c)
             SDL_Delay((unsigned int) restTime);
 
         // Set delta time
-        deltaTime = SDL_GetTicks() - oldTicks;;
+        deltaTime = SDL_GetTicks() - oldTicks;
+
+    }
+}
+
+
+// Main loop with a fixed time step
+static void app_loop_fixed()
+{
+    Uint64 freq = SDL_GetPerformanceFrequency();
+    Uint64 step = freq / (Uint64)config.fps;
+    Uint64 acc = step;
+    Uint64 now;
+    Uint64 old = SDL_GetPerformanceCounter();
+    Uint64 wait;
+
+    // Time multiplier stays the same, 1.0 on 60 fps
+    float tm = 60.0f / (float)config.fps;
+
+    while(isRunning)
+    {
+        // Accumulate time
+        now = SDL_GetPerformanceCounter();
+        acc += now - old;
+        old = now;
+
+        // Drop time if we are too far behind
+        if(acc > step * MAX_STEPS_PER_FRAME)
+            acc = step * MAX_STEPS_PER_FRAME;
+
+        // Update with fixed steps
+        app_events();
+        while(acc >= step && isRunning)
+        {
+            app_update(tm);
+            acc -= step;
+        }
+
+        // Draw between the last two updates
+        interpolation = (float)acc / (float)step;
+        app_draw();
+
+        // Without vsync, wait for the next step. Sleep most of
+        // the time and spin the last millisecond
+        if(!config.vsync)
+        {
+            now = SDL_GetPerformanceCounter();
+            if(acc + (now - old) < step)
+            {
+                wait = step - acc - (now - old);
+                if(wait * 1000 / freq > 1)
+                    SDL_Delay((Uint32)(wait * 1000 / freq) - 1);
 
+                while(SDL_GetPerformanceCounter() - now < wait);
+            }
+        }
     }
+    interpolation = 1.0f;
+}
+
+
+// Get interpolation
+float app_get_interpolation()
+{
+    return interpolation;
+}
+
+
+// Run application
+int app_run(SCENE* arrScenes, int count, CONFIG c)
+{
+    config = c;
+
+    if(app_init(arrScenes,count,NULL) != 0) return 1;
+
+    if(config.fixedStep)
+        app_loop_fixed();
+    else
+        app_loop_variable();
+
     app_destroy();
 
     return 0;
@@ -24,6 +24,12 @@ void app_swap_scene(const char* name);
 /// Swap to the previous scene
 void app_swap_to_previous_scene();
 
+/// Returns where the frame is drawn between the last two
+/// updates (0 = previous, 1 = latest). Always 1 without
+/// a fixed time step
+/// > Interpolation factor
+float app_get_interpolation();
+
 /// Terminate application
 void app_terminate();
 
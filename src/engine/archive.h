@@ -0,0 +1,87 @@
+/// Asset archive format (header)
+/// (c) 2018 Jani Nykänen
+
+#ifndef __ARCHIVE__
+#define __ARCHIVE__
+
+#include "stdint.h"
+
+/// Archive magic
+#define ARCHIVE_MAGIC "AQPK"
+/// Archive version
+#define ARCHIVE_VERSION 2
+/// Entry data alignment
+#define ARCHIVE_ALIGN 16
+/// Entry name size
+#define ARCHIVE_NAME_SIZE 64
+
+/// Archive header, followed by the entry table.
+/// All the values are little endian
+typedef struct
+{
+    char magic[4]; /// ARCHIVE_MAGIC
+    uint32_t version; /// ARCHIVE_VERSION
+    uint32_t entryCount; /// Entry count
+    uint32_t reserved;
+}
+ARCHIVE_HEADER;
+
+/// Archive entry
+typedef struct
+{
+    char name[ARCHIVE_NAME_SIZE]; /// Asset name
+    uint32_t type; /// Asset type
+    uint32_t offset; /// Data offset from the beginning of the archive
+    uint32_t size; /// Data size
+    uint32_t reserved;
+}
+ARCHIVE_ENTRY;
+
+/// Bitmap formats
+enum
+{
+    ARCHIVE_RGBA = 0,
+    ARCHIVE_INDEX4 = 1,
+    ARCHIVE_INDEX8 = 2,
+};
+
+/// Bitmap data header, followed by RGBA pixels. Indexed
+/// bitmaps are followed by the palette and the packed
+/// indices instead (see lib/indexed.h)
+typedef struct
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t format; /// Bitmap format
+    uint32_t colorCount; /// Palette size of an indexed bitmap
+}
+ARCHIVE_BITMAP;
+
+/// Tilemap data header, followed by the layers
+/// as 32-bit tile values
+typedef struct
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t tileW;
+    uint32_t tileH;
+    uint32_t layerCount;
+    uint32_t reserved[3];
+}
+ARCHIVE_TILEMAP;
+
+/// Sample data header, followed by PCM data in the output
+/// format of the audio device (see lib/pcm.h)
+typedef struct
+{
+    uint32_t frequency;
+    uint16_t format; /// SDL audio format
+    uint16_t channels;
+    uint32_t size; /// PCM data size
+    uint32_t reserved;
+}
+ARCHIVE_SAMPLE;
+
+// Music and stages are stored as they are in the files
+
+#endif // __ARCHIVE__
@@ -9,24 +9,64 @@
 
 #include "../lib/parseword.h"
 #include "../lib/tmxc.h"
+#include "../lib/stagefile.h"
+#include "../lib/mapfile.h"
+#include "../lib/indexed.h"
+#include "../lib/pcm.h"
+#include "../lib/stb_image.h"
 
 #include "bitmap.h"
+#include "graphics.h"
+#include "textcache.h"
 #include "music.h"
 #include "sample.h"
+#include "archive.h"
+#include "workers.h"
 
-// Asset type enum
-enum
+// Frames an asset is kept after it was used, even
+// if the budget is exceeded
+#define EVICT_DELAY 60
+
+// Bitmap or tilemap decode job
+typedef struct
+{
+    int index;
+    int type;
+    const char* path;
+    ATLAS_IMAGE image;
+    TILEMAP* map;
+}
+DECODE_JOB;
+
+// Asset load, may be pending over several frames
+typedef struct LOAD_BATCH LOAD_BATCH;
+struct LOAD_BATCH
 {
-    T_BITMAP = 0,
-    T_TILEMAP = 1,
-    T_MUSIC = 2,
-    T_SAMPLE = 3,
+    int* queued;
+    int queueCount;
+
+    DECODE_JOB* decodes;
+    JOB* jobs;
+    int jobCount;
+    JOB_BATCH* workers;
+
+    ATLAS_IMAGE* images;
+    int* bmpIndices;
+    int bmpCount;
+
+    int* mainIndices;
+    int mainCount;
+    int mainDone;
+
+    int err;
 };
 
 // Global file path
 static char* filePath;
 // Current type
 static int assetType;
+// Memory budget of new packs
+static size_t assetBudget;
 
 
 // Calculate assets
@@ -74,26 +114,408 @@ static void parse_command_type(char* w1, char* w2)
     {
         if(strcmp(w2,"bitmap") == 0)
         {
-            assetType = T_BITMAP;
+            assetType = ASSET_BITMAP;
         }
         else if(strcmp(w2,"tilemap") == 0)
         {
-            assetType = T_TILEMAP;
+            assetType = ASSET_TILEMAP;
         }
         else if(strcmp(w2,"music") == 0)
         {
-            assetType = T_MUSIC;
+            assetType = ASSET_MUSIC;
         }
         else if(strcmp(w2,"sample") == 0)
         {
-            assetType = T_SAMPLE;
+            assetType = ASSET_SAMPLE;
+        }
+        else if(strcmp(w2,"stage") == 0)
+        {
+            assetType = ASSET_STAGE;
         }
     }
 }
 
-// Load
-ASSET_PACK* load_asset_pack(const char* path)
+
+// Get time elapsed since a performance counter value
+static float elapsed_ms(Uint64 start)
+{
+    return (float)((double)(SDL_GetPerformanceCounter() - start)
+        * 1000.0 / (double)SDL_GetPerformanceFrequency());
+}
+
+
+// Hash a name (FNV-1a)
+static Uint32 hash_name(const char* name)
+{
+    Uint32 h = 2166136261u;
+    for(; *name != 0; ++ name)
+    {
+        h ^= (Uint8)*name;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+
+// Build the name index. Names must be set before this
+static int build_index(ASSET_PACK* p)
+{
+    // Keep the table at most half full
+    p->indexSize = 16;
+    while(p->indexSize < p->assetCount*2)
+        p->indexSize *= 2;
+
+    p->hashes = (Uint32*)malloc(sizeof(Uint32) * (p->assetCount > 0 ? p->assetCount : 1));
+    p->index = (Uint32*)calloc(p->indexSize,sizeof(Uint32));
+    if(p->hashes == NULL || p->index == NULL)
+    {
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!\n",NULL);
+        return 1;
+    }
+
+    // Slots store the asset index + 1, zero means empty.
+    // On duplicate names the first asset is kept, like before
+    Uint32 i = 0;
+    Uint32 slot;
+    for(; i < p->assetCount; ++ i)
+    {
+        p->hashes[i] = hash_name(p->names[i]);
+        slot = p->hashes[i] & (p->indexSize-1);
+        while(p->index[slot] != 0)
+        {
+            slot = (slot+1) & (p->indexSize-1);
+        }
+        p->index[slot] = i+1;
+    }
+
+    return 0;
+}
+
+
+// Copy strings to a single buffer
+static int copy_strings(const char** strings, Uint32 count, char** data)
+{
+    size_t size = 1;
+    Uint32 i = 0;
+    for(; i < count; ++ i)
+    {
+        size += strlen(strings[i]) +1;
+    }
+
+    *data = (char*)malloc(size);
+    if(*data == NULL)
+    {
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!\n",NULL);
+        return 1;
+    }
+
+    char* out = *data;
+    size_t len;
+    for(i = 0; i < count; ++ i)
+    {
+        len = strlen(strings[i]) +1;
+        memcpy(out,strings[i],len);
+        strings[i] = out;
+        out += len;
+    }
+
+    return 0;
+}
+
+
+// Create a tilemap from archive data
+static TILEMAP* tilemap_from_archive(const Uint8* data, Uint32 size)
+{
+    const ARCHIVE_TILEMAP* t = (const ARCHIVE_TILEMAP*)data;
+    Uint32 tiles = t->width * t->height;
+    if(size < sizeof(ARCHIVE_TILEMAP)
+     || (size - sizeof(ARCHIVE_TILEMAP)) / 4 / (tiles > 0 ? tiles : 1) < t->layerCount)
+    {
+        return NULL;
+    }
+
+    TILEMAP* map = create_tilemap(t->width,t->height,t->tileW,t->tileH,t->layerCount);
+    if(map == NULL) return NULL;
+
+    const int32_t* src = (const int32_t*)(data + sizeof(ARCHIVE_TILEMAP));
+    Uint32 l = 0;
+    Uint32 k;
+    for(; l < t->layerCount; ++ l)
+    {
+        for(k = 0; k < tiles; ++ k)
+            map->layers[l][k] = (int)src[l*tiles + k];
+    }
+    return map;
+}
+
+
+// Get the image of an archived bitmap
+static int archive_image(const Uint8* data, Uint32 size, ATLAS_IMAGE* img)
+{
+    if(size < sizeof(ARCHIVE_BITMAP)) return 1;
+
+    const ARCHIVE_BITMAP* head = (const ARCHIVE_BITMAP*)data;
+    if(head->width > 0xffff || head->height > 0xffff) return 1;
+
+    memset(img,0,sizeof(ATLAS_IMAGE));
+    img->w = (int)head->width;
+    img->h = (int)head->height;
+    data += sizeof(ARCHIVE_BITMAP);
+    size -= sizeof(ARCHIVE_BITMAP);
+
+    if(head->format == ARCHIVE_RGBA)
+    {
+        img->pixels = data;
+        return (Uint64)img->w * img->h * 4 > size;
+    }
+
+    img->bits = head->format == ARCHIVE_INDEX4 ? 4 : 8;
+    if((head->format != ARCHIVE_INDEX4 && head->format != ARCHIVE_INDEX8)
+     || head->colorCount > (Uint32)(1 << img->bits))
+        return 1;
+
+    // The palette is followed by the indices
+    img->colors = (const Uint32*)data;
+    img->colorCount = (int)head->colorCount;
+    img->indices = data + head->colorCount * 4;
+
+    return head->colorCount * 4
+        + (Uint64)get_index_row_size(img->w,img->bits) * img->h > size;
+}
+
+
+// Create the handle of an asset. Bitmaps, music and
+// samples get an empty object that is filled when the
+// asset is loaded
+static int create_handle(ASSET_PACK* p, int i)
+{
+    ASSET_SLOT* s = &p->slots[i];
+    int comp;
+
+    switch(p->types[i])
+    {
+    case ASSET_BITMAP:
+    {
+        BITMAP* b = (BITMAP*)calloc(1,sizeof(BITMAP));
+        if(b == NULL) return 1;
+
+        // The size is known before the bitmap is loaded
+        if(s->data != NULL)
+        {
+            ATLAS_IMAGE img;
+            if(archive_image(s->data,s->size,&img) != 0)
+            {
+                free(b);
+                return 1;
+            }
+            b->w = img.w;
+            b->h = img.h;
+        }
+        else if(!stbi_info(s->path,&b->w,&b->h,&comp))
+        {
+            char msg[1024 +32];
+            snprintf(msg,1024 +32,"Failed to load a bitmap in %s!\n",s->path);
+            SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!",msg,NULL);
+            free(b);
+            return 1;
+        }
+        b->c = rgb(255,255,255);
+        b->asset = s;
+        p->objects[i] = (ANY)b;
+        break;
+    }
+
+    case ASSET_MUSIC:
+    {
+        MUSIC* m = (MUSIC*)calloc(1,sizeof(MUSIC));
+        if(m == NULL) return 1;
+
+        m->asset = s;
+        p->objects[i] = (ANY)m;
+        break;
+    }
+
+    case ASSET_SAMPLE:
+    {
+        SAMPLE* smp = (SAMPLE*)calloc(1,sizeof(SAMPLE));
+        if(smp == NULL) return 1;
+
+        smp->asset = s;
+        p->objects[i] = (ANY)smp;
+        break;
+    }
+
+    // Loaded by get_asset
+    case ASSET_TILEMAP:
+    case ASSET_STAGE:
+        break;
+
+    default:
+        return 1;
+    }
+
+    return 0;
+}
+
+
+// Create the residency slots and handles
+static int create_slots(ASSET_PACK* p)
+{
+    Uint32 count = p->assetCount > 0 ? p->assetCount : 1;
+    p->slots = (ASSET_SLOT*)calloc(count,sizeof(ASSET_SLOT));
+    if(p->slots == NULL)
+    {
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!\n",NULL);
+        return 1;
+    }
+
+    Uint32 i = 0;
+    for(; i < p->assetCount; ++ i)
+    {
+        p->slots[i].pack = (void*)p;
+        p->slots[i].id = (int)i;
+        p->slots[i].group = -1;
+    }
+
+    p->requests = (int*)malloc(sizeof(int) * count);
+    if(p->requests == NULL)
+    {
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!\n",NULL);
+        return 1;
+    }
+    return 0;
+}
+
+
+// Initialize the common pack fields
+static void init_pack(ASSET_PACK* p)
+{
+    p->types = NULL;
+    p->objects = NULL;
+    p->names = NULL;
+    p->nameData = NULL;
+    p->pathData = NULL;
+    p->hashes = NULL;
+    p->index = NULL;
+    p->indexSize = 0;
+    p->assetCount = 0;
+    p->slots = NULL;
+    p->groups = NULL;
+    p->groupCount = 0;
+    p->sampleArena = NULL;
+    p->samplesLoaded = false;
+    p->sceneSet = NULL;
+    p->sceneSetSize = 0;
+    p->loading = NULL;
+    p->requests = NULL;
+    p->requestCount = 0;
+    p->residentBytes = 0;
+    p->budget = assetBudget;
+    p->frame = 0;
+    p->archive = NULL;
+    p->timings = NULL;
+    p->uploadTime = 0.0f;
+    p->loadTime = 0.0f;
+    p->workerCount = 0;
+}
+
+
+// Load an archive
+static ASSET_PACK* load_archive(MAPPED_FILE* f)
+{
+    Uint64 startTime = SDL_GetPerformanceCounter();
+    const ARCHIVE_HEADER* head = (const ARCHIVE_HEADER*)f->data;
+    const ARCHIVE_ENTRY* entries = (const ARCHIVE_ENTRY*)(f->data + sizeof(ARCHIVE_HEADER));
+
+    if(head->version != ARCHIVE_VERSION
+     || (f->size - sizeof(ARCHIVE_HEADER)) / sizeof(ARCHIVE_ENTRY) < head->entryCount)
+    {
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Invalid asset archive!\n",NULL);
+        return NULL;
+    }
+
+    // Allocate memory
+    ASSET_PACK* p = malloc(sizeof(ASSET_PACK));
+    if(p == NULL)
+    {
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!\n",NULL);
+        return NULL;
+    }
+    init_pack(p);
+    p->assetCount = head->entryCount;
+    p->archive = f;
+
+    Uint32 count = p->assetCount > 0 ? p->assetCount : 1;
+    // Names point to the mapped entry table
+    p->names = (const char**)calloc(count,sizeof(const char*));
+    p->objects = (ANY*)calloc(count,sizeof(ANY));
+    p->types = (int*)malloc(sizeof(int) * count);
+    p->timings = (ASSET_TIMING*)calloc(count,sizeof(ASSET_TIMING));
+    if(p->names == NULL || p->objects == NULL || p->types == NULL || p->timings == NULL
+     || create_slots(p) != 0)
+    {
+        free(p->names);
+        free(p->objects);
+        free(p->types);
+        free(p->timings);
+        free(p->slots);
+        free(p->requests);
+        free(p);
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!\n",NULL);
+        return NULL;
+    }
+
+    Uint32 i = 0;
+    for(; i < p->assetCount; ++ i)
+    {
+        p->types[i] = -1;
+    }
+
+    // Assets are loaded straight from the archive data
+    // when they are needed
+    const ARCHIVE_ENTRY* e;
+    bool err = false;
+    for(i = 0; i < p->assetCount && !err; ++ i)
+    {
+        e = &entries[i];
+        if(e->offset > f->size || e->size > f->size - e->offset
+         || memchr(e->name,0,ARCHIVE_NAME_SIZE) == NULL)
+        {
+            err = true;
+            break;
+        }
+        p->types[i] = e->type;
+        p->names[i] = e->name;
+        p->slots[i].data = f->data + e->offset;
+        p->slots[i].size = e->size;
+
+        err = create_handle(p,i) != 0;
+    }
+
+    if(!err)
+        err = build_index(p) != 0;
+
+    if(err)
+    {
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Invalid asset archive!\n",NULL);
+
+        // The archive is unmapped by the caller
+        p->archive = NULL;
+        destroy_asset_pack(p);
+        return NULL;
+    }
+
+    p->loadTime = elapsed_ms(startTime);
+
+    return p;
+}
+
+
+// Load an asset list
+static ASSET_PACK* load_asset_list(const char* path)
 {
+    Uint64 startTime = SDL_GetPerformanceCounter();
+
     // Allocate memory
     ASSET_PACK* p = malloc(sizeof(ASSET_PACK));
     if(p == NULL)
@@ -101,6 +523,7 @@ ASSET_PACK* load_asset_pack(const char* path)
         SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!\n",NULL);
         return NULL;
     }
+    init_pack(p);
 
     // Load word data
     WORDDATA* w = parse_file(path);
@@ -115,35 +538,57 @@ ASSET_PACK* load_asset_pack(const char* path)
 
     // Calculate assets
     p->assetCount = calculate_assets(w);
-    
-    // Allocate more memory
-    p->names = (NAME*)malloc(sizeof(NAME) * p->assetCount);
-    p->objects = (ANY*)malloc(sizeof(ANY) * p->assetCount);
-    p->types = (int*)malloc(sizeof(int) * p->assetCount);
-    if(p->names == NULL || p->objects == NULL || p->types == NULL)
+    Uint32 count = p->assetCount > 0 ? p->assetCount : 1;
+
+    // Allocate more memory. Names point to the word
+    // data and paths to a temporary buffer until they
+    // are copied
+    p->names = (const char**)malloc(sizeof(const char*) * count);
+    p->objects = (ANY*)calloc(count,sizeof(ANY));
+    p->types = (int*)malloc(sizeof(int) * count);
+    p->timings = (ASSET_TIMING*)calloc(count,sizeof(ASSET_TIMING));
+    const char** paths = (const char**)malloc(sizeof(const char*) * count);
+    char* pathBuffer = (char*)malloc(1024 * count);
+    if(p->names == NULL || p->objects == NULL || p->types == NULL
+     || p->timings == NULL || paths == NULL || pathBuffer == NULL
+     || create_slots(p) != 0)
     {
+        free(paths);
+        free(pathBuffer);
+        free(p->objects);
+        free(p->names);
+        free(p->types);
+        free(p->timings);
+        free(p->slots);
+        free(p->requests);
         free(p);
+        destroy_word_data(w);
         SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!\n",NULL);
         return NULL;
     }
 
     // Read words
     int i = 0;
+    for(; i < p->assetCount; ++ i)
+    {
+        p->types[i] = -1;
+    }
     char* w1,*w2;
     char* op[2];
     int opIndex = 0;
     bool begun = false;
     int index = 0;
-    
-    for(; i < w->wordCount; ++ i)
-    {   
+
+    for(i = 0; i < w->wordCount; ++ i)
+    {
         w1 = get_word(w,i);
         if(!begun)
         {
             if(w1[0] == '@')
             {
                 w2 = get_word(w,++i);
-                parse_command_type(w1,w2);
+                if(w2 != NULL)
+                    parse_command_type(w1,w2);
             }
             else if(strcmp(w1,"{") == 0)
             {
@@ -157,93 +602,1190 @@ ASSET_PACK* load_asset_pack(const char* path)
                 begun = false;
                 continue;
             }
-            
+
             op[opIndex] = w1;
             opIndex = !opIndex;
             if(opIndex == 0)
             {
-                char path[1024];
-                snprintf(path,1024,"%s%s",filePath,op[1]);
-
-                if(assetType == T_BITMAP)
-                {
-                    p->objects[index] = (ANY)load_bitmap(path);
-                }
-                else if(assetType == T_TILEMAP)
-                {
-                    p->objects[index] = (ANY)load_tilemap(path);
-                }
-                else if(assetType == T_MUSIC)
-                {
-                    p->objects[index] = (ANY)load_music(path);
-                }
-                else if(assetType == T_SAMPLE)
-                {
-                    p->objects[index] = (ANY)load_sample(path);
-                }
+                snprintf(pathBuffer + index*1024,1024,"%s%s",
+                    filePath != NULL ? filePath : "",op[1]);
 
                 p->types[index] = assetType;
-                strcpy(p->names[index].data,op[0]);
-                if(p->objects[index] == NULL)
-                {
-                    free(p->objects);
-                    free(p->names);
-                    free(p->types);
-                    free(p);
-                    return NULL;
-                }
+                p->names[index] = op[0];
+                paths[index] = pathBuffer + index*1024;
                 ++ index;
             }
         }
     }
 
+    // The count may be off if the list ends
+    // in the middle of a pair
+    p->assetCount = index;
+
+    // Copy names and paths, and build the name index
+    bool err = copy_strings(p->names,p->assetCount,&p->nameData) != 0
+        || copy_strings(paths,p->assetCount,&p->pathData) != 0
+        || build_index(p) != 0;
+    for(i = 0; i < p->assetCount && !err; ++ i)
+    {
+        p->slots[i].path = paths[i];
+        err = create_handle(p,i) != 0;
+    }
+    free(paths);
+    free(pathBuffer);
+    destroy_word_data(w);
+
+    if(err)
+    {
+        destroy_asset_pack(p);
+        return NULL;
+    }
+
+    p->loadTime = elapsed_ms(startTime);
+
     return p;
 }
 
 
-// Get asset
-ANY get_asset(ASSET_PACK* p, const char* name)
+// Convert a decoded image to palette indices,
+// if it has few enough colours
+static void index_image(ATLAS_IMAGE* img)
 {
-    int i = 0;
-    for(; i < p->assetCount; ++ i)
+    Uint8* indices = (Uint8*)malloc((size_t)img->w * img->h);
+    Uint32* colors = (Uint32*)malloc(sizeof(Uint32) * INDEXED_MAX_COLORS);
+    int count = indices != NULL && colors != NULL
+        ? index_pixels(img->pixels,img->w * img->h,indices,colors)
+        : -1;
+
+    if(count < 0)
+    {
+        free(indices);
+        free(colors);
+        return;
+    }
+
+    stbi_image_free((void*)img->pixels);
+    img->pixels = NULL;
+    img->indices = indices;
+    img->bits = 8;
+    img->colors = colors;
+    img->colorCount = count;
+}
+
+
+// Decode a bitmap or parse a tilemap, on a worker thread
+static int decode_asset(void* data)
+{
+    DECODE_JOB* j = (DECODE_JOB*)data;
+    int comp;
+
+    if(j->type == ASSET_BITMAP)
+    {
+        j->image.pixels = stbi_load(j->path,&j->image.w,&j->image.h,&comp,4);
+        if(j->image.pixels == NULL) return 1;
+
+        // The software rasterizer draws indexed bitmaps
+        if(is_software_rendering())
+            index_image(&j->image);
+
+        return 0;
+    }
+
+    j->map = load_tilemap(j->path);
+    return j->map == NULL;
+}
+
+
+// Store a decoded asset, on the main thread
+static void store_asset(JOB* job, void* param)
+{
+    ASSET_PACK* p = (ASSET_PACK*)param;
+    DECODE_JOB* j = (DECODE_JOB*)job->data;
+
+    p->timings[j->index].time = get_job_time(job);
+    p->timings[j->index].worker = job->worker;
+
+    if(job->result != 0)
     {
-        if(strcmp(name,p->names[i].data) == 0)
+        // Tilemap errors are reported by the parser
+        if(j->type == ASSET_BITMAP)
         {
-            return p->objects[i];
+            char msg[1024 +32];
+            snprintf(msg,1024 +32,"Failed to load a bitmap in %s!\n",j->path);
+            SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!",msg,NULL);
         }
+        return;
     }
 
-    return NULL;
+    if(j->type == ASSET_TILEMAP)
+        p->objects[j->index] = (ANY)j->map;
 }
 
 
-// Destroy
-void destroy_asset_pack(ASSET_PACK* p)
+// Mark an asset failed
+static void set_failed(ASSET_PACK* p, int i)
 {
-    int i = 0;
-    ANY obj;
+    p->slots[i].failed = true;
+
+    char msg[128];
+    snprintf(msg,128,"Failed to load asset \"%s\"!\n",p->names[i]);
+    SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!",msg,NULL);
+}
+
+
+// Get the PCM data of a sample in the device format.
+// Converted data is stored to the buffer
+// > PCM data, NULL on error
+static const Uint8* get_sample_pcm(ASSET_PACK* p, int i,
+    const SDL_AudioSpec* to, Uint8** buffer, Uint32* len)
+{
+    ASSET_SLOT* s = &p->slots[i];
+
+    *buffer = NULL;
+    if(s->data == NULL)
+    {
+        *buffer = decode_wav(SDL_RWFromFile(s->path,"rb"),to,len);
+        return *buffer;
+    }
+
+    const ARCHIVE_SAMPLE* h = (const ARCHIVE_SAMPLE*)s->data;
+    if(s->size < sizeof(ARCHIVE_SAMPLE) || h->size > s->size - sizeof(ARCHIVE_SAMPLE))
+        return NULL;
+
+    // Packed in the device format
+    const Uint8* pcm = s->data + sizeof(ARCHIVE_SAMPLE);
+    if((int)h->frequency == to->freq && h->format == to->format
+     && h->channels == to->channels)
+    {
+        *len = h->size;
+        return pcm;
+    }
+
+    SDL_AudioSpec from;
+    from.freq = (int)h->frequency;
+    from.format = h->format;
+    from.channels = (Uint8)h->channels;
+    *buffer = convert_pcm(pcm,h->size,&from,to,len);
+
+    return *buffer;
+}
+
+
+// Load the sample bank: every sample of the pack in the
+// output format of the audio device, so the mixer does not
+// convert anything. Archived samples are used from the
+// archive, others are decoded once to one arena. The other
+// samples are made resident here, the caller makes this one
+static int load_sample_bank(ASSET_PACK* p, int id)
+{
+    SDL_AudioSpec to;
+    int freq, channels;
+    Uint16 format;
+    if(Mix_QuerySpec(&freq,&format,&channels) == 0)
+        return 1;
+    to.freq = freq;
+    to.format = format;
+    to.channels = (Uint8)channels;
+
+    Uint32 count = p->assetCount > 0 ? p->assetCount : 1;
+    const Uint8** pcm = (const Uint8**)calloc(count,sizeof(Uint8*));
+    Uint8** buffers = (Uint8**)calloc(count,sizeof(Uint8*));
+    Uint32* lens = (Uint32*)calloc(count,sizeof(Uint32));
+    if(pcm == NULL || buffers == NULL || lens == NULL)
+    {
+        free(pcm);
+        free(buffers);
+        free(lens);
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!\n",NULL);
+        return 1;
+    }
+    p->samplesLoaded = true;
+
+    // Decode and convert
+    size_t arenaSize = 0;
+    Uint32 i = 0;
     for(; i < p->assetCount; ++ i)
-    {   
-        obj = p->objects[i];
-        switch(p->types[i])
-        {
-        case T_BITMAP:
-            destroy_bitmap((BITMAP*)obj);
-            break;
-        case T_TILEMAP:
-            destroy_tilemap((TILEMAP*)obj);
-            break;
+    {
+        if(p->types[i] != ASSET_SAMPLE) continue;
 
-        case T_MUSIC:
-            destroy_music((MUSIC*)obj);
-            break;
+        pcm[i] = get_sample_pcm(p,i,&to,&buffers[i],&lens[i]);
+        if(buffers[i] != NULL)
+            arenaSize += lens[i];
+    }
 
-        case T_SAMPLE:
-            destroy_sample((SAMPLE*)obj);
-            break;
+    // Move the converted data to the arena
+    p->sampleArena = arenaSize > 0 ? (Uint8*)malloc(arenaSize) : NULL;
+    size_t pos = 0;
+    for(i = 0; i < p->assetCount; ++ i)
+    {
+        if(buffers[i] == NULL) continue;
 
-        default:
-            break;
+        if(p->sampleArena != NULL)
+        {
+            memcpy(p->sampleArena + pos,buffers[i],lens[i]);
+            pcm[i] = p->sampleArena + pos;
+            pos += lens[i];
+        }
+        else
+        {
+            pcm[i] = NULL;
         }
+        free(buffers[i]);
     }
-}
\ No newline at end of file
+
+    // The chunks point to the data
+    Mix_Chunk* chunk;
+    int err = 0;
+    for(i = 0; i < p->assetCount; ++ i)
+    {
+        if(p->types[i] != ASSET_SAMPLE) continue;
+
+        chunk = pcm[i] != NULL ? Mix_QuickLoad_RAW((Uint8*)pcm[i],lens[i]) : NULL;
+        if(chunk == NULL)
+        {
+            if((int)i == id)
+                err = 1;
+            else
+                set_failed(p,i);
+            continue;
+        }
+
+        ((SAMPLE*)p->objects[i])->chunk = chunk;
+        p->slots[i].cost = lens[i];
+        if((int)i != id)
+        {
+            p->slots[i].resident = true;
+            p->slots[i].lastUse = p->frame;
+            p->residentBytes += lens[i];
+        }
+    }
+
+    free(pcm);
+    free(buffers);
+    free(lens);
+
+    return err;
+}
+
+
+// Load an asset that is not decoded on a worker, on
+// the main thread. SDL_mixer is not thread safe
+static int load_on_main_thread(ASSET_PACK* p, int i)
+{
+    ASSET_SLOT* s = &p->slots[i];
+    Uint64 t = SDL_GetPerformanceCounter();
+
+    switch(p->types[i])
+    {
+    case ASSET_TILEMAP:
+    {
+        TILEMAP* map = tilemap_from_archive(s->data,s->size);
+        if(map == NULL) return 1;
+
+        p->objects[i] = (ANY)map;
+        s->cost = sizeof(int) * map->tcount * map->layerCount;
+        break;
+    }
+
+    // The handle takes the loaded data
+    case ASSET_MUSIC:
+    {
+        MUSIC* m = s->data != NULL
+            ? load_music_from_memory(s->data,(int)s->size)
+            : load_music(s->path);
+        if(m == NULL) return 1;
+
+        ((MUSIC*)p->objects[i])->data = m->data;
+        ((MUSIC*)p->objects[i])->size = m->size;
+        ((MUSIC*)p->objects[i])->file = m->file;
+        s->cost = m->size;
+        free(m);
+        break;
+    }
+
+    // All the samples are loaded at once
+    case ASSET_SAMPLE:
+        if(p->samplesLoaded || load_sample_bank(p,i) != 0)
+            return 1;
+        break;
+
+    // Stages point to the archive, or map their file
+    case ASSET_STAGE:
+    {
+        STAGE* stage = s->data != NULL
+            ? open_stage(s->data,s->size)
+            : load_stage(s->path);
+        if(stage == NULL) return 1;
+
+        p->objects[i] = (ANY)stage;
+        s->cost = get_stage_size(stage->width,stage->height,stage->spawnCount);
+        break;
+    }
+
+    default:
+        return 1;
+    }
+
+    p->timings[i].time = elapsed_ms(t);
+    p->timings[i].worker = 0;
+
+    return 0;
+}
+
+
+// Get a free bitmap group
+static int add_group(ASSET_PACK* p, ATLAS* atlas)
+{
+    int i = 0;
+    for(; i < p->groupCount; ++ i)
+    {
+        if(p->groups[i].atlas == NULL)
+            break;
+    }
+
+    if(i == p->groupCount)
+    {
+        ASSET_GROUP* groups = (ASSET_GROUP*)realloc(p->groups,sizeof(ASSET_GROUP) * (p->groupCount+1));
+        if(groups == NULL) return -1;
+
+        p->groups = groups;
+        ++ p->groupCount;
+    }
+    p->groups[i].atlas = atlas;
+    p->groups[i].members = 0;
+
+    return i;
+}
+
+
+// Pack loaded bitmaps to an atlas, and move the
+// atlas regions to the bitmap handles
+static int store_bitmaps(ASSET_PACK* p, int* indices, ATLAS_IMAGE* images, int count)
+{
+    BITMAP** bmps = (BITMAP**)malloc(sizeof(BITMAP*) * count);
+    if(bmps == NULL)
+    {
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!\n",NULL);
+        return 1;
+    }
+
+    Uint64 t = SDL_GetPerformanceCounter();
+    ATLAS* atlas = create_atlas(images,count,bmps);
+    p->uploadTime += elapsed_ms(t);
+
+    int g = atlas != NULL ? add_group(p,atlas) : -1;
+    if(g < 0)
+    {
+        destroy_atlas(atlas);
+        free(bmps);
+        return 1;
+    }
+
+    // The color is kept, it may have been set
+    // before the bitmap was loaded
+    BITMAP* b;
+    int i = 0;
+    for(; i < count; ++ i)
+    {
+        b = (BITMAP*)p->objects[indices[i]];
+        b->w = bmps[i]->w;
+        b->h = bmps[i]->h;
+        b->sx = bmps[i]->sx;
+        b->sy = bmps[i]->sy;
+        b->tw = bmps[i]->tw;
+        b->th = bmps[i]->th;
+        b->tex = bmps[i]->tex;
+        b->pixels = bmps[i]->pixels;
+        b->indices = bmps[i]->indices;
+        b->palette = bmps[i]->palette;
+        b->view = bmps[i]->view;
+        free(bmps[i]);
+
+        p->slots[indices[i]].group = g;
+        p->slots[indices[i]].cost = b->palette != NULL
+            ? b->w * b->h + sizeof(PALETTE)
+            : b->w * b->h * 4;
+        p->slots[indices[i]].resident = true;
+        p->residentBytes += p->slots[indices[i]].cost;
+        ++ p->groups[g].members;
+    }
+    free(bmps);
+
+    return 0;
+}
+
+
+// Free a load batch and the decoded data
+static void free_load(LOAD_BATCH* b)
+{
+    if(b == NULL) return;
+
+    int i = 0;
+    for(; b->decodes != NULL && i < b->jobCount; ++ i)
+    {
+        if(b->decodes[i].image.pixels != NULL)
+            stbi_image_free((void*)b->decodes[i].image.pixels);
+        free((void*)b->decodes[i].image.indices);
+        free((void*)b->decodes[i].image.colors);
+    }
+    free(b->decodes);
+    free(b->jobs);
+    free(b->images);
+    free(b->bmpIndices);
+    free(b->queued);
+    free(b->mainIndices);
+    free(b);
+}
+
+
+// Begin loading the assets that are not resident. Bitmaps
+// and tilemaps in asset lists are decoded on worker threads,
+// the rest is loaded on the main thread one by one
+static LOAD_BATCH* begin_load(ASSET_PACK* p, const int* ids, int count)
+{
+    if(count <= 0) return NULL;
+
+    LOAD_BATCH* b = (LOAD_BATCH*)calloc(1,sizeof(LOAD_BATCH));
+    if(b != NULL)
+    {
+        b->decodes = (DECODE_JOB*)calloc(count,sizeof(DECODE_JOB));
+        b->jobs = (JOB*)calloc(count,sizeof(JOB));
+        b->images = (ATLAS_IMAGE*)malloc(sizeof(ATLAS_IMAGE) * count);
+        b->bmpIndices = (int*)malloc(sizeof(int) * count);
+        b->queued = (int*)malloc(sizeof(int) * count);
+        b->mainIndices = (int*)malloc(sizeof(int) * count);
+    }
+    if(b == NULL || b->decodes == NULL || b->jobs == NULL || b->images == NULL
+     || b->bmpIndices == NULL || b->queued == NULL || b->mainIndices == NULL)
+    {
+        free_load(b);
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!\n",NULL);
+        return NULL;
+    }
+
+    int i = 0;
+    int j;
+    int id;
+    ASSET_SLOT* s;
+
+    // Skip resident, failed, invalid and repeated assets
+    for(; i < count; ++ i)
+    {
+        id = ids[i];
+        if(id < 0 || id >= (int)p->assetCount
+         || p->slots[id].resident || p->slots[id].failed)
+            continue;
+
+        for(j = 0; j < b->queueCount && b->queued[j] != id; ++ j);
+        if(j < b->queueCount) continue;
+
+        b->queued[b->queueCount ++] = id;
+    }
+    if(b->queueCount == 0)
+    {
+        free_load(b);
+        return NULL;
+    }
+
+    // Queue decodes and main thread loads
+    for(i = 0; i < b->queueCount; ++ i)
+    {
+        id = b->queued[i];
+        s = &p->slots[id];
+
+        if(p->types[id] == ASSET_BITMAP && s->data != NULL)
+        {
+            // Archived bitmaps are not decoded. They were
+            // validated when the handle was created
+            archive_image(s->data,s->size,&b->images[b->bmpCount]);
+            b->bmpIndices[b->bmpCount ++] = id;
+        }
+        else if((p->types[id] == ASSET_BITMAP || p->types[id] == ASSET_TILEMAP) && s->data == NULL)
+        {
+            b->decodes[b->jobCount].index = id;
+            b->decodes[b->jobCount].type = p->types[id];
+            b->decodes[b->jobCount].path = s->path;
+            b->jobs[b->jobCount].run = decode_asset;
+            b->jobs[b->jobCount].data = &b->decodes[b->jobCount];
+            ++ b->jobCount;
+        }
+        else
+        {
+            b->mainIndices[b->mainCount ++] = id;
+        }
+    }
+
+    // Without a batch the jobs are run when the load ends
+    if(b->jobCount > 0)
+        b->workers = start_jobs(b->jobs,b->jobCount);
+
+    return b;
+}
+
+
+// Load the next asset that is loaded on the main thread
+static void load_next(ASSET_PACK* p, LOAD_BATCH* b)
+{
+    int id = b->mainIndices[b->mainDone ++];
+
+    // Loaded with the sample bank
+    if(p->slots[id].resident) return;
+
+    if(load_on_main_thread(p,id) == 0)
+    {
+        p->slots[id].resident = true;
+        p->residentBytes += p->slots[id].cost;
+    }
+    else
+    {
+        set_failed(p,id);
+        b->err = 1;
+    }
+}
+
+
+// Continue loading without blocking. One main thread
+// asset is loaded per step
+// > True, if only end_load is left to do
+static bool step_load(ASSET_PACK* p, LOAD_BATCH* b)
+{
+    int left = b->workers != NULL ? poll_jobs(b->workers,store_asset,p) : 0;
+
+    if(b->mainDone < b->mainCount)
+    {
+        load_next(p,b);
+        return false;
+    }
+    return left == 0;
+}
+
+
+// Wait for the decodes and finish loading. Bitmaps loaded
+// together are packed to one atlas. Frees the batch
+// > 0 on success, 1 if an asset failed to load
+static int end_load(ASSET_PACK* p, LOAD_BATCH* b)
+{
+    int err;
+    int i;
+    int id;
+
+    while(b->mainDone < b->mainCount)
+    {
+        load_next(p,b);
+    }
+
+    // Decode
+    if(b->jobCount > 0)
+    {
+        i = b->workers != NULL
+            ? finish_jobs(b->workers,store_asset,p)
+            : run_jobs(b->jobs,b->jobCount,store_asset,p);
+        b->workers = NULL;
+        if(i > p->workerCount)
+            p->workerCount = i;
+    }
+    for(i = 0; i < b->jobCount; ++ i)
+    {
+        id = b->decodes[i].index;
+        if(b->jobs[i].result != 0)
+        {
+            set_failed(p,id);
+            b->err = 1;
+        }
+        else if(b->decodes[i].type == ASSET_BITMAP)
+        {
+            b->images[b->bmpCount] = b->decodes[i].image;
+            b->bmpIndices[b->bmpCount ++] = id;
+        }
+        else
+        {
+            TILEMAP* map = (TILEMAP*)p->objects[id];
+            p->slots[id].cost = sizeof(int) * map->tcount * map->layerCount;
+            p->slots[id].resident = true;
+            p->residentBytes += p->slots[id].cost;
+        }
+    }
+
+    // Pack bitmaps to an atlas, this uploads the pages
+    if(b->bmpCount > 0 && store_bitmaps(p,b->bmpIndices,b->images,b->bmpCount) != 0)
+    {
+        for(i = 0; i < b->bmpCount; ++ i)
+            set_failed(p,b->bmpIndices[i]);
+        b->err = 1;
+    }
+
+    // Loaded assets count as used
+    for(i = 0; i < b->queueCount; ++ i)
+    {
+        p->slots[b->queued[i]].lastUse = p->frame;
+    }
+
+    err = b->err;
+    free_load(b);
+
+    return err;
+}
+
+
+// Finish the pending asynchronous load, if any
+static int finish_pending(ASSET_PACK* p)
+{
+    if(p->loading == NULL) return 0;
+
+    LOAD_BATCH* b = p->loading;
+    p->loading = NULL;
+
+    return end_load(p,b);
+}
+
+
+// Load assets that are not resident
+static int load_assets(ASSET_PACK* p, const int* ids, int count)
+{
+    // A pending load might contain the same assets
+    int err = finish_pending(p);
+
+    LOAD_BATCH* b = begin_load(p,ids,count);
+    if(b != NULL)
+        err |= end_load(p,b);
+
+    return err;
+}
+
+
+// Release the data of a bitmap, the handle is kept
+static void release_bitmap(BITMAP* b)
+{
+    // Atlas pages are destroyed with the atlas
+    if(!b->view)
+    {
+        if(b->tex != NULL)
+            SDL_DestroyTexture(b->tex);
+        free(b->pixels);
+        free(b->indices);
+    }
+    free(b->palette);
+    b->tex = NULL;
+    b->pixels = NULL;
+    b->indices = NULL;
+    b->palette = NULL;
+    b->view = false;
+}
+
+
+// Evict an asset
+static void evict_asset(ASSET_PACK* p, int i)
+{
+    ASSET_SLOT* s = &p->slots[i];
+    ANY obj = p->objects[i];
+    int g = s->group;
+
+    switch(p->types[i])
+    {
+    case ASSET_BITMAP:
+        release_bitmap((BITMAP*)obj);
+        s->group = -1;
+
+        // The atlas is destroyed with its last bitmap
+        if(-- p->groups[g].members == 0)
+        {
+            destroy_atlas(p->groups[g].atlas);
+            p->groups[g].atlas = NULL;
+        }
+        break;
+
+    case ASSET_TILEMAP:
+        destroy_tilemap((TILEMAP*)obj);
+        p->objects[i] = NULL;
+        break;
+
+    case ASSET_MUSIC:
+        unload_music((MUSIC*)obj);
+        break;
+
+    case ASSET_SAMPLE:
+        Mix_FreeChunk(((SAMPLE*)obj)->chunk);
+        ((SAMPLE*)obj)->chunk = NULL;
+        ((SAMPLE*)obj)->played = false;
+        break;
+
+    case ASSET_STAGE:
+        destroy_stage((STAGE*)obj);
+        p->objects[i] = NULL;
+        break;
+
+    default:
+        break;
+    }
+
+    s->resident = false;
+    p->residentBytes -= s->cost;
+}
+
+
+// Evict a bitmap group, and load the pinned
+// bitmaps in it to a new group
+static void evict_group(ASSET_PACK* p, int g)
+{
+    int* pinned = (int*)malloc(sizeof(int) * p->groups[g].members);
+    int count = 0;
+    Uint32 i = 0;
+    for(; i < p->assetCount; ++ i)
+    {
+        if(p->slots[i].group != g) continue;
+
+        if(p->slots[i].pins > 0 && pinned != NULL)
+            pinned[count ++] = (int)i;
+        evict_asset(p,i);
+    }
+
+    if(count > 0)
+        load_assets(p,pinned,count);
+    free(pinned);
+}
+
+
+// Can an asset be evicted, and when was it used. Bitmaps
+// are evicted in groups, so the whole group is checked. A
+// group can be evicted if it has an unpinned bitmap, the
+// pinned ones are loaded again to a new group
+static bool can_evict(ASSET_PACK* p, int i, Uint32* lastUse)
+{
+    ASSET_SLOT* s = &p->slots[i];
+    if(!s->resident) return false;
+
+    if(p->types[i] == ASSET_MUSIC && is_music_in_use((MUSIC*)p->objects[i]))
+        return false;
+
+    // Samples share the bank, which stays loaded
+    if(p->types[i] == ASSET_SAMPLE)
+        return false;
+
+    *lastUse = s->lastUse;
+    if(p->types[i] != ASSET_BITMAP)
+        return s->pins == 0;
+
+    bool unpinned = false;
+    Uint32 j = 0;
+    for(; j < p->assetCount; ++ j)
+    {
+        if(p->slots[j].group != s->group) continue;
+
+        if(p->slots[j].pins == 0)
+            unpinned = true;
+        if(p->slots[j].lastUse > *lastUse)
+            *lastUse = p->slots[j].lastUse;
+    }
+    return unpinned;
+}
+
+
+// Load
+ASSET_PACK* load_asset_pack(const char* path)
+{
+    // Archives are mapped and used as they are
+    MAPPED_FILE* f = map_file(path);
+    if(f != NULL && f->size >= sizeof(ARCHIVE_HEADER)
+     && memcmp(f->data,ARCHIVE_MAGIC,4) == 0)
+    {
+        ASSET_PACK* p = load_archive(f);
+        if(p == NULL)
+            unmap_file(f);
+
+        return p;
+    }
+    unmap_file(f);
+
+    return load_asset_list(path);
+}
+
+
+// Set asset budget
+void set_asset_budget(size_t bytes)
+{
+    assetBudget = bytes;
+}
+
+
+// Get asset
+ANY get_asset(ASSET_PACK* p, const char* name)
+{
+    return get_asset_by_id(p,get_asset_id(p,name));
+}
+
+
+// Get asset by ID
+ANY get_asset_by_id(ASSET_PACK* p, int id)
+{
+    if(id < 0 || id >= (int)p->assetCount)
+        return NULL;
+
+    // Data assets have no handles
+    if(p->types[id] == ASSET_TILEMAP || p->types[id] == ASSET_STAGE)
+    {
+        if(!use_asset(&p->slots[id]))
+            return NULL;
+    }
+
+    return p->objects[id];
+}
+
+
+// Get asset ID
+int get_asset_id(ASSET_PACK* p, const char* name)
+{
+    Uint32 h = hash_name(name);
+    Uint32 slot = h & (p->indexSize-1);
+    Uint32 i;
+
+    while(p->index[slot] != 0)
+    {
+        i = p->index[slot] -1;
+        if(p->hashes[i] == h && strcmp(name,p->names[i]) == 0)
+        {
+            return (int)i;
+        }
+        slot = (slot+1) & (p->indexSize-1);
+    }
+
+    return -1;
+}
+
+
+// Use asset
+bool use_asset(ASSET_SLOT* s)
+{
+    ASSET_PACK* p = (ASSET_PACK*)s->pack;
+    int i = 0;
+
+    if(!s->resident && !s->failed)
+    {
+        // Bitmaps are requested while drawing. Loading them
+        // here would pack each of them to an atlas of its own
+        if(p->types[s->id] == ASSET_BITMAP)
+        {
+            for(; i < p->requestCount && p->requests[i] != s->id; ++ i);
+            if(i == p->requestCount)
+                p->requests[p->requestCount ++] = s->id;
+        }
+        else
+        {
+            load_assets(p,&s->id,1);
+        }
+    }
+
+    s->lastUse = p->frame;
+    return s->resident;
+}
+
+
+// Reload asset
+int reload_asset(ASSET_PACK* p, int id)
+{
+    // Samples share the bank, and
+    // are not loaded one by one
+    if(id < 0 || id >= (int)p->assetCount || p->slots[id].path == NULL
+     || p->types[id] == ASSET_SAMPLE)
+        return 1;
+
+    // A pending load might be reading the old file
+    finish_pending(p);
+
+    // Text drawn with the old glyphs is not reused
+    if(p->types[id] == ASSET_BITMAP)
+        flush_text_runs((BITMAP*)p->objects[id]);
+
+    // Assets that are not resident are read
+    // from the new file when they are used
+    ASSET_SLOT* s = &p->slots[id];
+    s->failed = false;
+    if(!s->resident) return 0;
+
+    size_t cost = s->cost;
+
+    switch(p->types[id])
+    {
+    // The new content is swapped to the old object,
+    // and the old content is destroyed. On error the
+    // old content is kept
+    case ASSET_TILEMAP:
+    {
+        TILEMAP* map = load_tilemap(s->path);
+        if(map == NULL) return 1;
+
+        TILEMAP old = *(TILEMAP*)p->objects[id];
+        *(TILEMAP*)p->objects[id] = *map;
+        *map = old;
+        destroy_tilemap(map);
+
+        map = (TILEMAP*)p->objects[id];
+        s->cost = sizeof(int) * map->tcount * map->layerCount;
+        break;
+    }
+
+    case ASSET_STAGE:
+    {
+        STAGE* stage = load_stage(s->path);
+        if(stage == NULL) return 1;
+
+        STAGE old = *(STAGE*)p->objects[id];
+        *(STAGE*)p->objects[id] = *stage;
+        *stage = old;
+        destroy_stage(stage);
+
+        stage = (STAGE*)p->objects[id];
+        s->cost = get_stage_size(stage->width,stage->height,stage->spawnCount);
+        break;
+    }
+
+    // Freeing music that is playing would stop it
+    case ASSET_MUSIC:
+        if(is_music_in_use((MUSIC*)p->objects[id]))
+            return 1;
+        // Fallthrough
+
+    // The handle is kept, only its data is loaded again
+    default:
+        evict_asset(p,id);
+        return load_assets(p,&id,1);
+    }
+
+    p->residentBytes += s->cost - cost;
+    return 0;
+}
+
+
+// Pin or unpin assets
+static void add_pins(ASSET_PACK* p, const int* ids, int count, int pins)
+{
+    int i = 0;
+    for(; i < count; ++ i)
+    {
+        if(ids[i] < 0 || ids[i] >= (int)p->assetCount)
+            continue;
+
+        p->slots[ids[i]].pins += pins;
+        if(p->slots[ids[i]].pins < 0)
+            p->slots[ids[i]].pins = 0;
+    }
+}
+
+
+// Replace the scene set
+static int set_scene_set(ASSET_PACK* p, const int* ids, int count)
+{
+    int* set = (int*)malloc(sizeof(int) * (count > 0 ? count : 1));
+    if(set == NULL)
+    {
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!\n",NULL);
+        return 1;
+    }
+    memcpy(set,ids,sizeof(int) * count);
+
+    // The new set is pinned first, so the assets
+    // in both sets stay pinned
+    add_pins(p,ids,count,1);
+    add_pins(p,p->sceneSet,p->sceneSetSize,-1);
+    free(p->sceneSet);
+    p->sceneSet = set;
+    p->sceneSetSize = count;
+
+    return 0;
+}
+
+
+// Preload asset set
+int preload_asset_set(ASSET_PACK* p, const int* ids, int count)
+{
+    if(set_scene_set(p,ids,count) != 0)
+        return 1;
+
+    return load_assets(p,ids,count);
+}
+
+
+// Preload asset set in the background
+void preload_asset_set_async(ASSET_PACK* p, const int* ids, int count)
+{
+    if(set_scene_set(p,ids,count) != 0)
+        return;
+
+    finish_pending(p);
+    p->loading = begin_load(p,ids,count);
+}
+
+
+// Is loading
+bool is_asset_set_loading(ASSET_PACK* p)
+{
+    return p->loading != NULL;
+}
+
+
+// Pin assets
+int pin_assets(ASSET_PACK* p, const int* ids, int count)
+{
+    add_pins(p,ids,count,1);
+    return load_assets(p,ids,count);
+}
+
+
+// Unpin assets
+void unpin_assets(ASSET_PACK* p, const int* ids, int count)
+{
+    add_pins(p,ids,count,-1);
+}
+
+
+// Update residency
+void update_asset_residency(ASSET_PACK* p)
+{
+    ++ p->frame;
+
+    // Bitmaps used since the last update
+    if(p->requestCount > 0)
+    {
+        load_assets(p,p->requests,p->requestCount);
+        p->requestCount = 0;
+    }
+
+    // Nothing is evicted while loading, the pinned
+    // bitmaps of a group would be loaded right away
+    if(p->loading != NULL)
+    {
+        if(step_load(p,p->loading))
+            finish_pending(p);
+        return;
+    }
+    if(p->budget == 0) return;
+
+    // Evict the least recently used assets. Assets used
+    // during the last frames are kept, they would only be
+    // loaded again right away
+    Uint32 lastUse;
+    Uint32 bestUse;
+    int best;
+    Uint32 i;
+    while(p->residentBytes > p->budget)
+    {
+        best = -1;
+        bestUse = p->frame;
+        for(i = 0; i < p->assetCount; ++ i)
+        {
+            if(can_evict(p,i,&lastUse) && lastUse + EVICT_DELAY < p->frame
+             && lastUse < bestUse)
+            {
+                best = (int)i;
+                bestUse = lastUse;
+            }
+        }
+        if(best < 0) break;
+
+        if(p->types[best] == ASSET_BITMAP)
+            evict_group(p,p->slots[best].group);
+        else
+            evict_asset(p,best);
+    }
+}
+
+
+// Print timings
+void print_asset_timings(ASSET_PACK* p)
+{
+    static const char* TYPE_NAMES[] = {"bitmap","tilemap","music","sample","stage"};
+
+    float total = 0.0f;
+    int loaded = 0;
+    int i = 0;
+    for(; i < p->assetCount; ++ i)
+    {
+        printf("%-16s %-8s ",p->names[i],
+            p->types[i] >= 0 && p->types[i] <= ASSET_STAGE ? TYPE_NAMES[p->types[i]] : "?");
+        if(!p->slots[i].resident)
+        {
+            printf("%s\n",p->slots[i].failed ? "failed" : "not resident");
+            continue;
+        }
+
+        printf("%8.2f ms %8.1f KB",p->timings[i].time,(float)p->slots[i].cost / 1024.0f);
+        if(p->timings[i].worker > 0)
+            printf("  worker %d\n",p->timings[i].worker);
+        else
+            printf("  main\n");
+
+        total += p->timings[i].time;
+        ++ loaded;
+    }
+    printf("%d/%d assets resident, %.1f KB", loaded,(int)p->assetCount,
+        (float)p->residentBytes / 1024.0f);
+    if(p->budget > 0)
+        printf(" of %.1f KB",(float)p->budget / 1024.0f);
+    printf(", %.2f ms in total on %d worker(s), atlas %.2f ms, open %.2f ms\n",
+        total,p->workerCount,p->uploadTime,p->loadTime);
+}
+
+
+// Destroy
+void destroy_asset_pack(ASSET_PACK* p)
+{
+    // The workers must not write to the objects
+    finish_pending(p);
+
+    int i = 0;
+    ANY obj;
+    for(; i < p->assetCount; ++ i)
+    {
+        obj = p->objects != NULL ? p->objects[i] : NULL;
+        if(obj == NULL) continue;
+
+        switch(p->types[i])
+        {
+        case ASSET_BITMAP:
+            release_bitmap((BITMAP*)obj);
+            free(obj);
+            break;
+        case ASSET_TILEMAP:
+            destroy_tilemap((TILEMAP*)obj);
+            break;
+
+        case ASSET_MUSIC:
+            destroy_music((MUSIC*)obj);
+            break;
+
+        case ASSET_SAMPLE:
+            destroy_sample((SAMPLE*)obj);
+            break;
+
+        case ASSET_STAGE:
+            destroy_stage((STAGE*)obj);
+            break;
+
+        default:
+            break;
+        }
+    }
+    for(i = 0; i < p->groupCount; ++ i)
+    {
+        destroy_atlas(p->groups[i].atlas);
+    }
+
+    free(p->objects);
+    free(p->types);
+    free(p->names);
+    free(p->nameData);
+    free(p->pathData);
+    free(p->hashes);
+    free(p->index);
+    free(p->timings);
+    free(p->slots);
+    free(p->groups);
+    free(p->sceneSet);
+    free(p->requests);
+    // The sample chunks only point to the arena
+    free(p->sampleArena);
+
+    // Music may be streamed from the archive, so
+    // it is unmapped last. Names point to it, too
+    unmap_file(p->archive);
+    free(p);
+}
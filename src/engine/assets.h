@@ -6,39 +6,193 @@
 
 #include "SDL2/SDL.h"
 
-/// Asset buffer size
-#define NAME_BUFFER_SIZE 64
+#include "atlas.h"
+
+#include "../lib/mapfile.h"
+
+#include "stdbool.h"
+
+/// Asset types
+enum
+{
+    ASSET_BITMAP = 0,
+    ASSET_TILEMAP = 1,
+    ASSET_MUSIC = 2,
+    ASSET_SAMPLE = 3,
+    ASSET_STAGE = 4,
+};
 
 /// Any asset type aka void pointer
 typedef void* ANY;
 
-/// Name structure 
+/// Asset load timing
 typedef struct
 {
-    char data[NAME_BUFFER_SIZE];
+    float time;
+    int worker;
 }
-NAME;
+ASSET_TIMING;
+
+/// Asset residency slot. Bitmaps, music and samples point to
+/// their slot, so they can be loaded again when used after
+/// being evicted
+typedef struct ASSET_SLOT
+{
+    void* pack; /// Owner pack
+    int id; /// Asset index
+    int group; /// Bitmap group (atlas), -1 if none
+    size_t cost; /// Bytes used while resident
+    Uint32 lastUse; /// Frame of the last use
+    int pins; /// Pin count, pinned assets are not evicted
+    bool resident; /// Is the asset loaded
+    bool failed; /// Did the asset fail to load
+    const char* path; /// Source file (asset lists)
+    const Uint8* data; /// Source data (archives)
+    Uint32 size; /// Source data size
+}
+ASSET_SLOT;
+
+/// Bitmaps loaded together share an atlas
+typedef struct
+{
+    ATLAS* atlas;
+    int members;
+}
+ASSET_GROUP;
 
 /// Asset pack type
 typedef struct
 {
     int* types;
     ANY* objects;
-    NAME* names;
+    const char** names;
+    char* nameData;
+    char* pathData;
+    Uint32* hashes;
+    Uint32* index;
+    Uint32 indexSize;
     Uint32 assetCount;
+    ASSET_SLOT* slots;
+    ASSET_GROUP* groups;
+    int groupCount;
+    Uint8* sampleArena; /// Converted samples, see load_sample_bank
+    bool samplesLoaded;
+    int* sceneSet;
+    int sceneSetSize;
+    struct LOAD_BATCH* loading;
+    int* requests; /// Bitmaps to load in the next update, see use_asset
+    int requestCount;
+    size_t residentBytes;
+    size_t budget;
+    Uint32 frame;
+    MAPPED_FILE* archive;
+    ASSET_TIMING* timings;
+    float uploadTime;
+    float loadTime;
+    int workerCount;
 }
 ASSET_PACK;
 
-/// Load an asset pack
-/// < path Asset list path
+/// Set the memory budget of the asset packs loaded
+/// after this. When the resident assets use more, the
+/// least recently used ones are evicted
+/// < bytes Budget in bytes, 0 for unlimited
+void set_asset_budget(size_t bytes);
+
+/// Load an asset pack. The file can be either a text
+/// asset list or a binary archive made by the packer.
+/// Nothing is loaded yet, see get_asset
+/// < path Asset list or archive path
 /// > A new asset pack
 ASSET_PACK* load_asset_pack(const char* path);
 
-/// Get an asset by its name
+/// Get an asset by its name. Bitmaps, music and samples
+/// are handles that stay valid, and they are loaded when
+/// they are first drawn or played. A bitmap is loaded in the
+/// update after it was first drawn. Stages and tilemaps are
+/// loaded here, and must be pinned while they are used
 /// < p Asset pack
 /// < name Asset name
+/// > Asset, NULL if not found
 ANY get_asset(ASSET_PACK* p, const char* name);
 
+/// Get an asset by its index in the asset list. The
+/// indices are generated to asset_ids.h with "make asset_ids"
+/// < p Asset pack
+/// < id Asset ID
+/// > Asset, NULL if out of range
+ANY get_asset_by_id(ASSET_PACK* p, int id);
+
+/// Get the index of an asset
+/// < p Asset pack
+/// < name Asset name
+/// > Asset ID, -1 if not found
+int get_asset_id(ASSET_PACK* p, const char* name);
+
+/// Make sure an asset is loaded and mark it used. Bitmaps are
+/// used while drawing, so they are not loaded here but in the
+/// next update_asset_residency, all in one atlas
+/// < s Residency slot
+/// > True, if the asset is resident
+bool use_asset(ASSET_SLOT* s);
+
+/// Load an asset again from its source file. Handles are
+/// updated in place, and so are resident stages and tilemaps,
+/// so pointers to them stay valid. Only for asset lists
+/// < p Asset pack
+/// < id Asset ID
+/// > 0 on success, 1 on error
+int reload_asset(ASSET_PACK* p, int id);
+
+/// Load assets and keep them resident until another
+/// set is preloaded. Called when a scene starts
+/// < p Asset pack
+/// < ids Asset IDs
+/// < count ID count
+/// > 0 on success, 1 if an asset failed to load
+int preload_asset_set(ASSET_PACK* p, const int* ids, int count);
+
+/// Pin a set like preload_asset_set, but load it in the
+/// background while frames are drawn. The loading continues
+/// in update_asset_residency. Assets used before the load
+/// is ready are loaded right away
+/// < p Asset pack
+/// < ids Asset IDs
+/// < count ID count
+void preload_asset_set_async(ASSET_PACK* p, const int* ids, int count);
+
+/// Is an asynchronous preload still loading
+/// < p Asset pack
+/// > True, if loading
+bool is_asset_set_loading(ASSET_PACK* p);
+
+/// Load assets and keep them resident until unpinned
+/// < p Asset pack
+/// < ids Asset IDs
+/// < count ID count
+/// > 0 on success, 1 if an asset failed to load
+int pin_assets(ASSET_PACK* p, const int* ids, int count);
+
+/// Allow pinned assets to be evicted again
+/// < p Asset pack
+/// < ids Asset IDs
+/// < count ID count
+void unpin_assets(ASSET_PACK* p, const int* ids, int count);
+
+/// Advance the frame counter, load the bitmaps used while they
+/// were not resident, continue an asynchronous preload and
+/// evict the least recently used assets until
+/// the pack fits its budget. Called once a frame, when no
+/// draw calls are queued
+/// < p Asset pack
+void update_asset_residency(ASSET_PACK* p);
+
+/// Print the time each loaded asset took to load and the
+/// resident memory. Bitmaps and tilemaps are decoded on
+/// worker threads, the rest on the main thread
+/// < p Asset pack
+void print_asset_timings(ASSET_PACK* p);
+
 /// Destroy an asset pack
 /// < p Asset pack
 void destroy_asset_pack(ASSET_PACK* p);
@@ -0,0 +1,457 @@
+/// Texture atlas (source)
+/// (c) 2018 Jani Nykänen
+
+#include "atlas.h"
+
+#include "graphics.h"
+
+#include "../lib/indexed.h"
+
+#include "stdlib.h"
+#include "string.h"
+
+// Maximum amount of skyline nodes per page
+#define MAX_NODES 256
+
+// Skyline node
+typedef struct
+{
+    int x;
+    int y;
+    int w;
+}
+NODE;
+
+// Page that is being packed
+typedef struct
+{
+    NODE nodes[MAX_NODES];
+    int nodeCount;
+    int width;
+    int height;
+    Uint8* pixels;
+}
+PAGE;
+
+// Decoded image
+typedef struct
+{
+    int index;
+    int w;
+    int h;
+    const ATLAS_IMAGE* src;
+}
+IMAGE;
+
+
+// Bytes per page pixel, pages are indexed
+// in software rendering
+static int page_bpp()
+{
+    return is_software_rendering() ? 1 : 4;
+}
+
+
+// Sort images by height, tallest first
+static int compare_images(const void* a, const void* b)
+{
+    return ((IMAGE*)b)->h - ((IMAGE*)a)->h;
+}
+
+
+// Get the y position where a rectangle fits, if placed
+// on the node in the index, -1 if it does not fit
+static int skyline_fit(PAGE* p, int index, int w, int h)
+{
+    int x = p->nodes[index].x;
+    int y = p->nodes[index].y;
+    int left = w;
+    int i = index;
+
+    if(x + w > ATLAS_PAGE_SIZE) return -1;
+
+    while(left > 0)
+    {
+        if(i >= p->nodeCount) return -1;
+
+        if(p->nodes[i].y > y)
+            y = p->nodes[i].y;
+        if(y + h > ATLAS_PAGE_SIZE) return -1;
+
+        left -= p->nodes[i].w;
+        ++ i;
+    }
+    return y;
+}
+
+
+// Insert a rectangle to the skyline (bottom-left rule)
+static bool skyline_insert(PAGE* p, int w, int h, int* ox, int* oy)
+{
+    int best = -1;
+    int bestBottom = ATLAS_PAGE_SIZE +1;
+    int bestWidth = ATLAS_PAGE_SIZE +1;
+    int y;
+    int i = 0;
+
+    if(p->nodeCount >= MAX_NODES) return false;
+
+    // Find the lowest position
+    for(; i < p->nodeCount; ++ i)
+    {
+        y = skyline_fit(p,i,w,h);
+        if(y < 0) continue;
+
+        if(y + h < bestBottom || (y + h == bestBottom && p->nodes[i].w < bestWidth))
+        {
+            best = i;
+            bestBottom = y + h;
+            bestWidth = p->nodes[i].w;
+            *ox = p->nodes[i].x;
+            *oy = y;
+        }
+    }
+    if(best < 0) return false;
+
+    // Add a new node
+    memmove(&p->nodes[best+1],&p->nodes[best],sizeof(NODE) * (p->nodeCount-best));
+    p->nodes[best] = (NODE){*ox,*oy + h,w};
+    ++ p->nodeCount;
+
+    // Shrink or remove the nodes under the new one
+    for(i = best+1; i < p->nodeCount; )
+    {
+        int prevEnd = p->nodes[i-1].x + p->nodes[i-1].w;
+        if(p->nodes[i].x >= prevEnd) break;
+
+        int shrink = prevEnd - p->nodes[i].x;
+        p->nodes[i].x += shrink;
+        p->nodes[i].w -= shrink;
+        if(p->nodes[i].w > 0) break;
+
+        memmove(&p->nodes[i],&p->nodes[i+1],sizeof(NODE) * (p->nodeCount-i-1));
+        -- p->nodeCount;
+    }
+
+    // Merge nodes on the same level
+    for(i = 0; i < p->nodeCount-1; )
+    {
+        if(p->nodes[i].y == p->nodes[i+1].y)
+        {
+            p->nodes[i].w += p->nodes[i+1].w;
+            memmove(&p->nodes[i+1],&p->nodes[i+2],sizeof(NODE) * (p->nodeCount-i-2));
+            -- p->nodeCount;
+        }
+        else
+        {
+            ++ i;
+        }
+    }
+
+    if(bestBottom > p->height)
+        p->height = bestBottom;
+    if(*ox + w > p->width)
+        p->width = *ox + w;
+
+    return true;
+}
+
+
+// Start a new page
+static int begin_page(PAGE* p)
+{
+    p->pixels = (Uint8*)calloc(ATLAS_PAGE_SIZE*ATLAS_PAGE_SIZE,page_bpp());
+    if(p->pixels == NULL)
+    {
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!\n",NULL);
+        return 1;
+    }
+    p->nodes[0] = (NODE){0,0,ATLAS_PAGE_SIZE};
+    p->nodeCount = 1;
+    p->width = 0;
+    p->height = 0;
+
+    return 0;
+}
+
+
+// Cut the unused columns off a page, so a page of a
+// few small bitmaps is only as big as they need
+static void crop_page(PAGE* p)
+{
+    int bpp = page_bpp();
+    int y = 1;
+    for(; y < p->height; ++ y)
+    {
+        memmove(p->pixels + y * p->width * bpp,p->pixels + y * ATLAS_PAGE_SIZE * bpp,p->width * bpp);
+    }
+}
+
+
+// Upload a page to a texture
+static SDL_Texture* upload_page(PAGE* p)
+{
+    SDL_Surface* surf = SDL_CreateRGBSurfaceFrom((void*)p->pixels, p->width, p->height, 32, p->width*4,
+                                             0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+    if(surf == NULL)
+    {
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Failed to create a surface!",NULL);
+        return NULL;
+    }
+
+    SDL_Texture* tex = SDL_CreateTextureFromSurface(get_global_renderer(),surf);
+    if(tex == NULL)
+    {
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Failed to create a texture from a surface!",NULL);
+    }
+    SDL_FreeSurface(surf);
+
+    return tex;
+}
+
+
+// Expand a row of indices to RGBA
+static void expand_row(const ATLAS_IMAGE* img, int y, Uint32* out)
+{
+    const Uint8* row = img->indices + get_index_row_size(img->w,img->bits) * y;
+    Uint8 index;
+    int i = 0;
+
+    for(; i < img->w; ++ i)
+    {
+        index = img->bits == 4 ? (row[i/2] >> ((i & 1) * 4)) & 0x0f : row[i];
+        out[i] = index < img->colorCount ? img->colors[index] : 0;
+    }
+}
+
+
+// Copy an image to a page
+static void copy_image(PAGE* p, IMAGE* img, POINT pos)
+{
+    const ATLAS_IMAGE* src = img->src;
+    Uint8* dst;
+    int y = 0;
+
+    for(; y < img->h; ++ y)
+    {
+        dst = p->pixels + ((pos.y + y) * ATLAS_PAGE_SIZE + pos.x) * page_bpp();
+
+        // Software pages keep the indices
+        if(is_software_rendering())
+            unpack_index_row(src->indices + get_index_row_size(img->w,src->bits) * y,img->w,src->bits,dst);
+        else if(src->pixels == NULL)
+            expand_row(src,y,(Uint32*)dst);
+        else
+            memcpy(dst,src->pixels + y * img->w * 4,img->w * 4);
+    }
+}
+
+
+// Create a bitmap of its own for an image
+static BITMAP* create_own_bitmap(IMAGE* img)
+{
+    if(img->src->pixels != NULL)
+        return create_bitmap(img->w,img->h,img->src->pixels);
+
+    Uint32* pixels = (Uint32*)malloc(sizeof(Uint32) * img->w * img->h);
+    if(pixels == NULL)
+    {
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!\n",NULL);
+        return NULL;
+    }
+
+    int y = 0;
+    for(; y < img->h; ++ y)
+    {
+        expand_row(img->src,y,pixels + y*img->w);
+    }
+
+    BITMAP* bmp = create_bitmap(img->w,img->h,(const Uint8*)pixels);
+    free(pixels);
+
+    return bmp;
+}
+
+
+// Create bitmap views to the page
+static int create_views(ATLAS* a, PAGE* p, IMAGE* img, POINT* pos, int start, int end, BITMAP** out)
+{
+    SDL_Texture* tex = NULL;
+    Uint8* indices = NULL;
+    bool software = is_software_rendering();
+
+    crop_page(p);
+
+    // The software rasterizer keeps the indices, otherwise
+    // the pixels are uploaded to a texture
+    if(software)
+    {
+        indices = (Uint8*)realloc(p->pixels,p->width*p->height);
+        if(indices == NULL) return 1;
+        p->pixels = NULL;
+    }
+    else
+    {
+        tex = upload_page(p);
+        if(tex == NULL) return 1;
+    }
+
+    a->pages[a->pageCount] = tex;
+    a->indices[a->pageCount] = indices;
+    ++ a->pageCount;
+
+    int i = start;
+    for(; i < end; ++ i)
+    {
+        BITMAP* bmp = (BITMAP*)malloc(sizeof(BITMAP));
+        if(bmp == NULL)
+        {
+            SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Failed to allocate memory for a bitmap!\n",NULL);
+            return 1;
+        }
+
+        bmp->w = img[i].w;
+        bmp->h = img[i].h;
+        bmp->sx = pos[i].x;
+        bmp->sy = pos[i].y;
+        bmp->tw = p->width;
+        bmp->th = p->height;
+        bmp->tex = tex;
+        bmp->pixels = NULL;
+        bmp->indices = indices;
+        bmp->palette = NULL;
+        bmp->c = rgb(255,255,255);
+        bmp->view = true;
+        bmp->asset = NULL;
+
+        out[img[i].index] = bmp;
+
+        if(software)
+        {
+            bmp->palette = create_palette(img[i].src->colors,img[i].src->colorCount);
+            if(bmp->palette == NULL) return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+// Pack images to an atlas
+ATLAS* create_atlas(ATLAS_IMAGE* images, int count, BITMAP** out)
+{
+    ATLAS* a = (ATLAS*)malloc(sizeof(ATLAS));
+    IMAGE* img = (IMAGE*)calloc(count,sizeof(IMAGE));
+    POINT* pos = (POINT*)malloc(sizeof(POINT) * count);
+    PAGE* p = (PAGE*)malloc(sizeof(PAGE));
+    if(a == NULL || img == NULL || pos == NULL || p == NULL)
+    {
+        free(a); free(img); free(pos); free(p);
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!\n",NULL);
+        return NULL;
+    }
+    a->pageCount = 0;
+    p->pixels = NULL;
+
+    int i = 0;
+    int err = 0;
+
+    for(; i < count; ++ i)
+    {
+        out[i] = NULL;
+        img[i].index = i;
+        img[i].w = images[i].w;
+        img[i].h = images[i].h;
+        img[i].src = &images[i];
+    }
+
+    // Pack tallest first
+    qsort(img,count,sizeof(IMAGE),compare_images);
+    err = begin_page(p);
+
+    int start = 0;
+    int w, h;
+    for(i = 0; i < count && !err; ++ i)
+    {
+        w = img[i].w + ATLAS_PADDING;
+        h = img[i].h + ATLAS_PADDING;
+
+        // Too big to be packed or not indexed in software
+        // rendering, use a bitmap of its own
+        if(w > ATLAS_PAGE_SIZE || h > ATLAS_PAGE_SIZE
+         || (is_software_rendering() && img[i].src->pixels != NULL))
+        {
+            out[img[i].index] = create_own_bitmap(&img[i]);
+            err = out[img[i].index] == NULL;
+
+            // Keep the packed range contiguous
+            IMAGE tmp = img[i];
+            memmove(&img[start+1],&img[start],sizeof(IMAGE) * (i-start));
+            memmove(&pos[start+1],&pos[start],sizeof(POINT) * (i-start));
+            img[start ++] = tmp;
+            continue;
+        }
+
+        // Page full, upload and start a new one
+        if(!skyline_insert(p,w,h,&pos[i].x,&pos[i].y))
+        {
+            if(a->pageCount >= ATLAS_MAX_PAGES-1 || i == start)
+            {
+                SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Too many bitmaps for the atlas!\n",NULL);
+                err = 1;
+                break;
+            }
+
+            err = create_views(a,p,img,pos,start,i,out);
+            free(p->pixels);
+            start = i;
+            err = err || begin_page(p);
+            -- i;
+            continue;
+        }
+
+        copy_image(p,&img[i],pos[i]);
+    }
+
+    // Upload the last page
+    if(!err && start < count)
+    {
+        err = create_views(a,p,img,pos,start,count,out);
+    }
+
+    // Free temporary data
+    free(p->pixels);
+    free(p);
+    free(img);
+    free(pos);
+
+    // The bitmaps made before the error are destroyed
+    if(err)
+    {
+        for(i = 0; i < count; ++ i)
+        {
+            destroy_bitmap(out[i]);
+            out[i] = NULL;
+        }
+        destroy_atlas(a);
+        return NULL;
+    }
+
+    return a;
+}
+
+
+// Destroy atlas
+void destroy_atlas(ATLAS* a)
+{
+    if(a == NULL) return;
+
+    int i = 0;
+    for(; i < a->pageCount; ++ i)
+    {
+        if(a->pages[i] != NULL)
+            SDL_DestroyTexture(a->pages[i]);
+        free(a->indices[i]);
+    }
+    free(a);
+}
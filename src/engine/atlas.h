@@ -0,0 +1,53 @@
+/// Texture atlas (header)
+/// (c) 2018 Jani Nykänen
+
+#ifndef __ATLAS__
+#define __ATLAS__
+
+#include "bitmap.h"
+
+/// Atlas page size. The pages are cut to the area that is used
+#define ATLAS_PAGE_SIZE 1024
+/// Maximum amount of atlas pages
+#define ATLAS_MAX_PAGES 8
+/// Empty pixels between packed bitmaps
+#define ATLAS_PADDING 1
+
+/// Atlas type
+typedef struct
+{
+    SDL_Texture* pages[ATLAS_MAX_PAGES]; /// Page textures
+    Uint8* indices[ATLAS_MAX_PAGES]; /// Page palette indices (software rendering only)
+    int pageCount; /// Page count
+}
+ATLAS;
+
+/// Image to be packed
+typedef struct
+{
+    int w; /// Width
+    int h; /// Height
+    const Uint8* pixels; /// RGBA pixels, NULL if the image is indexed
+    const Uint8* indices; /// Packed palette indices
+    int bits; /// Bits per index, 4 or 8
+    const Uint32* colors; /// Palette colours
+    int colorCount; /// Palette colour count
+}
+ATLAS_IMAGE;
+
+/// Pack images to atlas pages. Textures are always RGBA, so
+/// indexed images are expanded when the pages are uploaded.
+/// The software rasterizer keeps the pages as indices, and
+/// each bitmap gets its own palette. RGBA images get a bitmap
+/// of their own in software rendering
+/// < images Images
+/// < count Image count
+/// < out Where the bitmaps (atlas regions) are stored
+/// > A new atlas, NULL on error. No bitmaps are left then
+ATLAS* create_atlas(ATLAS_IMAGE* images, int count, BITMAP** out);
+
+/// Destroy an atlas and its pages
+/// < a Atlas
+void destroy_atlas(ATLAS* a);
+
+#endif // __ATLAS__
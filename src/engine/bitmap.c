@@ -2,18 +2,22 @@
 /// (c) 2018 Jani Nykänen
 
 #define STB_IMAGE_IMPLEMENTATION
+// The failure string is a global, which would race
+// when images are decoded on worker threads
+#define STBI_NO_FAILURE_STRINGS
 #include "../lib/stb_image.h"
 
 #include "bitmap.h"
 #include "graphics.h"
 
 #include "stdlib.h"
+#include "string.h"
 #include "math.h"
 #include "stdio.h"
 
 
-// Load bitmap
-BITMAP* load_bitmap(const char* path)
+// Create a bitmap from pixel data
+BITMAP* create_bitmap(int w, int h, const Uint8* pixels)
 {
     // Allocate memory
     BITMAP* bmp = (BITMAP*)malloc(sizeof(BITMAP));
@@ -22,10 +26,92 @@ BITMAP* load_bitmap(const char* path)
         SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Failed to allocate memory for a bitmap!\n",NULL);
         return NULL;
     }
+    bmp->w = w;
+    bmp->h = h;
+    bmp->tex = NULL;
+    bmp->pixels = NULL;
+    bmp->indices = NULL;
+    bmp->palette = NULL;
+    bmp->asset = NULL;
+
+    // The software rasterizer keeps a copy of the pixels
+    if(is_software_rendering())
+    {
+        bmp->pixels = (Uint32*)malloc(w*h*4);
+        if(bmp->pixels == NULL)
+        {
+            free(bmp);
+            SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Failed to allocate memory for a bitmap!\n",NULL);
+            return NULL;
+        }
+        memcpy(bmp->pixels,pixels,w*h*4);
+    }
+    else
+    {
+        // Create surface
+        SDL_Surface* surf = SDL_CreateRGBSurfaceFrom((void*)pixels, w, h, 32, w*4,
+                                                 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+        if(surf == NULL)
+        {
+            free(bmp);
+            SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Failed to create a surface!",NULL);
+            return NULL;
+        }
+
+        // Create texture
+        bmp->tex = SDL_CreateTextureFromSurface(get_global_renderer(),surf);
+        SDL_FreeSurface(surf);
+        if(bmp->tex == NULL)
+        {
+            free(bmp);
+            SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Failed to create a texture from a surface!",NULL);
+            return NULL;
+        }
+    }
+
+    // Set color to white
+    bmp->c = rgb(255,255,255);
+
+    // The bitmap owns the whole texture
+    bmp->sx = 0;
+    bmp->sy = 0;
+    bmp->tw = w;
+    bmp->th = h;
+    bmp->view = false;
+
+    return bmp;
+}
+
+
+// Create a palette
+PALETTE* create_palette(const Uint32* colors, int count)
+{
+    PALETTE* pal = (PALETTE*)malloc(sizeof(PALETTE));
+    if(pal == NULL)
+    {
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Failed to allocate memory for a palette!\n",NULL);
+        return NULL;
+    }
+
+    // Unused entries are transparent
+    if(count > PALETTE_SIZE) count = PALETTE_SIZE;
+    memset(pal->base,0,sizeof(pal->base));
+    memcpy(pal->base,colors,sizeof(Uint32) * count);
+    memcpy(pal->colors,pal->base,sizeof(pal->base));
+    pal->tint = rgb(255,255,255);
+    pal->count = count;
+
+    return pal;
+}
+
+
+// Load bitmap
+BITMAP* load_bitmap(const char* path)
+{
+    int w, h, comp;
 
-    int comp;
     // Load image
-    Uint8* pdata = stbi_load(path,&bmp->w,&bmp->h,&comp,4);
+    Uint8* pdata = stbi_load(path,&w,&h,&comp,4);
     if(pdata == NULL)
     {
         char err[256];
@@ -34,31 +120,65 @@ BITMAP* load_bitmap(const char* path)
         return NULL;
     }
 
-    // Create surface
-    SDL_Surface* surf = SDL_CreateRGBSurfaceFrom((void*)pdata, bmp->w, bmp->h, 32, bmp->w*4,
-                                             0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
-    if(surf == NULL)
+    BITMAP* bmp = create_bitmap(w,h,pdata);
+
+    // Free data
+    stbi_image_free(pdata);
+
+    return bmp;
+}
+
+
+// Create a render target bitmap
+BITMAP* create_target_bitmap(int w, int h)
+{
+    // Allocate memory
+    BITMAP* bmp = (BITMAP*)malloc(sizeof(BITMAP));
+    if(bmp == NULL)
     {
-        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Failed to create a surface!",NULL);
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Failed to allocate memory for a bitmap!\n",NULL);
         return NULL;
     }
 
-    // Create texture
-    bmp->tex = SDL_CreateTextureFromSurface(get_global_renderer(),surf);
-    if(bmp->tex == NULL)
+    // Create texture, or pixel data for the software rasterizer
+    bmp->tex = NULL;
+    bmp->pixels = NULL;
+    bmp->indices = NULL;
+    bmp->palette = NULL;
+    bmp->asset = NULL;
+    if(is_software_rendering())
     {
-        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Failed to create a texture from a surface!",NULL);
-        return NULL;
+        bmp->pixels = (Uint32*)calloc(w*h,sizeof(Uint32));
+        if(bmp->pixels == NULL)
+        {
+            free(bmp);
+            SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Failed to allocate memory for a bitmap!\n",NULL);
+            return NULL;
+        }
+    }
+    else
+    {
+        bmp->tex = SDL_CreateTexture(get_global_renderer(),
+            SDL_PIXELFORMAT_RGBA8888,
+            SDL_TEXTUREACCESS_TARGET,
+            w,h);
+        if(bmp->tex == NULL)
+        {
+            free(bmp);
+            SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Failed to create a texture!\n",NULL);
+            return NULL;
+        }
+        SDL_SetTextureBlendMode(bmp->tex,SDL_BLENDMODE_BLEND);
     }
 
-    // Set color to white
+    bmp->w = w;
+    bmp->h = h;
+    bmp->sx = 0;
+    bmp->sy = 0;
+    bmp->tw = w;
+    bmp->th = h;
     bmp->c = rgb(255,255,255);
-
-    // Free surface
-    SDL_FreeSurface(surf);
-
-    // Free data
-    stbi_image_free(pdata);
+    bmp->view = false;
 
     return bmp;
 }
@@ -69,6 +189,16 @@ void destroy_bitmap(BITMAP* bmp)
 {
     if(bmp == NULL) return;
 
-    SDL_DestroyTexture(bmp->tex);
+    // Atlas pages are destroyed with the atlas
+    if(!bmp->view)
+    {
+        if(bmp->tex != NULL)
+            SDL_DestroyTexture(bmp->tex);
+        if(bmp->pixels != NULL)
+            free(bmp->pixels);
+        if(bmp->indices != NULL)
+            free(bmp->indices);
+    }
+    free(bmp->palette);
     free(bmp);
 }
@@ -6,6 +6,8 @@
 
 #include <SDL2/SDL.h>
 
+#include "stdbool.h"
+
 /// Color
 typedef struct
 {
@@ -15,13 +17,36 @@ COLOR;
 #define rgb(r,g,b) (COLOR){r,g,b,255}
 #define rgba(r,g,b,a) (COLOR){rg,b,a}
 
+/// Palette size
+#define PALETTE_SIZE 256
+
+/// Palette of an indexed bitmap. The colours are
+/// 32-bit values with the bytes in RGBA order
+typedef struct
+{
+    Uint32 base[PALETTE_SIZE]; /// Colours of the image
+    Uint32 colors[PALETTE_SIZE]; /// Colours modulated with the tint
+    COLOR tint; /// Tint of the modulated colours
+    int count; /// Colour count
+}
+PALETTE;
+
 /// Bitmap type
 typedef struct
 {
     int w; /// Bitmap width
     int h; /// Bitmap height
+    int sx; /// X position in the texture
+    int sy; /// Y position in the texture
+    int tw; /// Texture width
+    int th; /// Texture height
     SDL_Texture* tex; /// Texture
+    Uint32* pixels; /// Pixel data of the texture (software rendering only)
+    Uint8* indices; /// Palette indices of the texture (software rendering only)
+    PALETTE* palette; /// Palette, NULL if the bitmap is not indexed
     COLOR c; /// Color (needed in one place only)
+    bool view; /// Is the texture shared (an atlas region)
+    struct ASSET_SLOT* asset; /// Residency slot, if the bitmap is an asset
 }
 BITMAP;
 
@@ -30,6 +55,25 @@ BITMAP;
 /// > Returns a new bitmap (pointer)
 BITMAP* load_bitmap(const char* path);
 
+/// Create a bitmap from RGBA pixel data
+/// < w Width
+/// < h Height
+/// < pixels Pixel data (copied)
+/// > Returns a new bitmap (pointer)
+BITMAP* create_bitmap(int w, int h, const Uint8* pixels);
+
+/// Create an empty bitmap that can be used as a render target
+/// < w Width
+/// < h Height
+/// > Returns a new bitmap (pointer)
+BITMAP* create_target_bitmap(int w, int h);
+
+/// Create a palette for an indexed bitmap
+/// < colors Colours, bytes in RGBA order
+/// < count Colour count
+/// > Returns a new palette (pointer)
+PALETTE* create_palette(const Uint32* colors, int count);
+
 /// Destroy bitmap
 void destroy_bitmap(BITMAP* bmp);
 
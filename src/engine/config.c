@@ -36,6 +36,13 @@ int read_config(CONFIG* c, const char* path)
         return 1;
     }
 
+    // Defaults for optional keys
+    c->softwareRendering = false;
+    c->fixedStep = false;
+    c->vsync = false;
+    c->assetBudget = 0;
+    c->hotReload = false;
+
     // Read words
     int count = 0;
     int i = 0;
@@ -75,6 +82,26 @@ int read_config(CONFIG* c, const char* path)
             {
                 c->fullscreen = (bool)strtol(value,NULL,10);
             }
+            else if(strcmp(key,"software_rendering") == 0)
+            {
+                c->softwareRendering = (bool)strtol(value,NULL,10);
+            }
+            else if(strcmp(key,"fixed_step") == 0)
+            {
+                c->fixedStep = (bool)strtol(value,NULL,10);
+            }
+            else if(strcmp(key,"vsync") == 0)
+            {
+                c->vsync = (bool)strtol(value,NULL,10);
+            }
+            else if(strcmp(key,"asset_budget") == 0)
+            {
+                c->assetBudget = (int)strtol(value,NULL,10);
+            }
+            else if(strcmp(key,"hot_reload") == 0)
+            {
+                c->hotReload = (bool)strtol(value,NULL,10);
+            }
         }
 
         count = !count;
@@ -20,6 +20,11 @@ typedef struct
     int canvasHeight;
     int fps;
     bool fullscreen;
+    bool softwareRendering;
+    bool fixedStep;
+    bool vsync;
+    int assetBudget; /// Asset memory budget in kilobytes, 0 for unlimited
+    bool hotReload; /// Reload assets when their files change
     char title[TITLE_STRING_SIZE];
 }
 CONFIG;
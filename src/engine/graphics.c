@@ -4,8 +4,13 @@
 #include "graphics.h"
 
 #include "mathext.h"
+#include "textcache.h"
+#include "softrender.h"
+#include "assets.h"
 
 #include "malloc.h"
+#include "string.h"
+#include "stdint.h"
 #include "stdlib.h"
 #include "math.h"
 #include "stdio.h"
@@ -15,17 +20,328 @@ static SDL_Renderer* grend;
 // Window dim
 static SDL_Point windowDim;
 
+// Target to restore after drawing to a bitmap
+static SDL_Texture* prevTarget;
+
 // Translate x
 static int transX;
 // Translate y
 static int transY;
 
+// Render command types
+enum
+{
+    CMD_QUAD = 0,
+    CMD_FILL = 1,
+    CMD_CLEAR = 2,
+};
+
+// Render command
+typedef struct
+{
+    int type;
+    int layer;
+    int group;
+    SDL_Texture* tex;
+    SDL_Vertex verts[4];
+    SDL_Rect rect;
+    COLOR c;
+}
+RENDER_CMD;
+
+// Recorded commands
+static RENDER_CMD* commands = NULL;
+// Submission order
+static int* order = NULL;
+// Command count
+static int cmdCount;
+// Room for commands
+static int cmdCapacity = 0;
+
+// Current layer
+static int drawLayer;
+// Can the current layer be sorted by texture
+static bool sortLayer;
+// Current group. Commands are never moved
+// over a group boundary
+static int drawGroup;
+// Texture of the previous command
+static SDL_Texture* lastTex;
+// Must the queue be sorted, that is, was a sorted layer
+// used or a layer below the previous one
+static bool needSort;
+
+// Batched vertices
+static SDL_Vertex batchVerts[MAX_BATCH_QUADS*4];
+// Batch indices (same for every batch)
+static int batchIndices[MAX_BATCH_QUADS*6];
+// Texture of the current batch
+static SDL_Texture* batchTex;
+// Quads in the current batch
+static int batchCount;
+
+// Times the render targets have lost their contents
+static Uint32 targetLosses = 0;
+
+// Is the software rasterizer used
+static bool software = false;
+// Software framebuffer
+static BITMAP* framebuffer = NULL;
+// Current software target
+static BITMAP* swTarget;
+// Software target to restore
+static BITMAP* swPrevTarget;
+
+
+// Compare commands by layer, group and texture,
+// keeping the recorded order otherwise
+static int compare_commands(const void* a, const void* b)
+{
+    int i1 = *(const int*)a;
+    int i2 = *(const int*)b;
+    RENDER_CMD* c1 = &commands[i1];
+    RENDER_CMD* c2 = &commands[i2];
+
+    if(c1->layer != c2->layer)
+        return c1->layer < c2->layer ? -1 : 1;
+    if(c1->group != c2->group)
+        return c1->group < c2->group ? -1 : 1;
+    if(c1->tex != c2->tex)
+        return (uintptr_t)c1->tex < (uintptr_t)c2->tex ? -1 : 1;
+
+    return i1 - i2;
+}
+
+
+// Make room for more commands
+// > True on success
+static bool grow_commands()
+{
+    int cap = cmdCapacity == 0 ? RENDER_COMMANDS_INITIAL : cmdCapacity*2;
+
+    RENDER_CMD* c = (RENDER_CMD*)realloc(commands,cap * sizeof(RENDER_CMD));
+    if(c == NULL) return false;
+    commands = c;
+
+    int* o = (int*)realloc(order,cap * sizeof(int));
+    if(o == NULL) return false;
+    order = o;
+
+    cmdCapacity = cap;
+    return true;
+}
+
+
+// Add a new command
+// > Command, NULL if out of memory
+static RENDER_CMD* add_command(int type, SDL_Texture* tex)
+{
+    // Flushing in the middle of a frame would draw the
+    // layers out of order, so the queue grows instead
+    if(cmdCount >= cmdCapacity && !grow_commands())
+    {
+        flush_graphics();
+        if(cmdCapacity == 0) return NULL;
+    }
+
+    // Untextured commands are barriers, and so is
+    // a texture change in an unsorted layer
+    if(type != CMD_QUAD || (!sortLayer && tex != lastTex))
+        ++ drawGroup;
+
+    if(sortLayer || (cmdCount > 0 && drawLayer < commands[cmdCount-1].layer))
+        needSort = true;
+
+    RENDER_CMD* c = &commands[cmdCount ++];
+    c->type = type;
+    c->layer = drawLayer;
+    c->group = drawGroup;
+    c->tex = tex;
+
+    if(type != CMD_QUAD)
+        ++ drawGroup;
+    lastTex = tex;
+
+    return c;
+}
+
+
+// Submit batched quads
+static void submit_batch()
+{
+    if(batchCount > 0)
+    {
+        SDL_RenderGeometry(grend,batchTex,batchVerts,batchCount*4,batchIndices,batchCount*6);
+    }
+    batchCount = 0;
+}
+
+
+// Add a quad to the command queue
+static void push_quad(BITMAP* b, int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, int flip)
+{
+    // Assets are loaded when they are first drawn
+    if(b->asset != NULL && !use_asset(b->asset))
+        return;
+
+    // Software rendering is immediate
+    if(software)
+    {
+        sw_draw_bitmap(swTarget,b,sx,sy,sw,sh,dx,dy,dw,dh,flip,b->c);
+        return;
+    }
+
+    RENDER_CMD* cmd = add_command(CMD_QUAD,b->tex);
+    if(cmd == NULL) return;
+
+    // Texture coordinates (the bitmap may be a region of an atlas)
+    sx += b->sx;
+    sy += b->sy;
+    float u1 = (float)sx / (float)b->tw;
+    float v1 = (float)sy / (float)b->th;
+    float u2 = (float)(sx+sw) / (float)b->tw;
+    float v2 = (float)(sy+sh) / (float)b->th;
+    float tmp;
+
+    if(flip & FLIP_HORIZONTAL)
+    {
+        tmp = u1; u1 = u2; u2 = tmp;
+    }
+    if(flip & FLIP_VERTICAL)
+    {
+        tmp = v1; v1 = v2; v2 = tmp;
+    }
+
+    SDL_Color col = (SDL_Color){b->c.r,b->c.g,b->c.b,255};
+    SDL_Vertex* v = cmd->verts;
+
+    v[0] = (SDL_Vertex){ {(float)dx,(float)dy}, col, {u1,v1} };
+    v[1] = (SDL_Vertex){ {(float)(dx+dw),(float)dy}, col, {u2,v1} };
+    v[2] = (SDL_Vertex){ {(float)(dx+dw),(float)(dy+dh)}, col, {u2,v2} };
+    v[3] = (SDL_Vertex){ {(float)dx,(float)(dy+dh)}, col, {u1,v2} };
+}
+
 
 // Initialize graphics
 void init_graphics()
 {
     transX = 0;
     transY = 0;
+
+    // Two triangles per quad
+    int i = 0;
+    for(; i < MAX_BATCH_QUADS; ++ i)
+    {
+        batchIndices[i*6] = i*4;
+        batchIndices[i*6 +1] = i*4 +1;
+        batchIndices[i*6 +2] = i*4 +2;
+        batchIndices[i*6 +3] = i*4;
+        batchIndices[i*6 +4] = i*4 +2;
+        batchIndices[i*6 +5] = i*4 +3;
+    }
+    batchTex = NULL;
+    batchCount = 0;
+
+    cmdCount = 0;
+    grow_commands();
+    drawGroup = 0;
+    lastTex = NULL;
+    needSort = false;
+    set_draw_layer(0,false);
+}
+
+
+// Enable software rendering
+int enable_software_rendering(int w, int h)
+{
+    software = true;
+    framebuffer = create_target_bitmap(w,h);
+    if(framebuffer == NULL)
+    {
+        software = false;
+        return 1;
+    }
+    swTarget = framebuffer;
+    swPrevTarget = framebuffer;
+
+    return 0;
+}
+
+
+// Is software rendering
+bool is_software_rendering()
+{
+    return software;
+}
+
+
+// Get framebuffer
+BITMAP* get_framebuffer()
+{
+    return framebuffer;
+}
+
+
+// Flush the command queue
+void flush_graphics()
+{
+    if(cmdCount == 0) return;
+
+    int i = 0;
+    for(; i < cmdCount; ++ i)
+    {
+        order[i] = i;
+    }
+    // Otherwise the commands are in order already
+    if(needSort)
+        qsort(order,cmdCount,sizeof(int),compare_commands);
+
+    // Submit, merging quads with the same texture
+    RENDER_CMD* c;
+    for(i = 0; i < cmdCount; ++ i)
+    {
+        c = &commands[order[i]];
+        if(c->type == CMD_QUAD)
+        {
+            if(c->tex != batchTex || batchCount >= MAX_BATCH_QUADS)
+            {
+                submit_batch();
+                batchTex = c->tex;
+            }
+            memcpy(&batchVerts[batchCount*4],c->verts,sizeof(SDL_Vertex)*4);
+            ++ batchCount;
+            continue;
+        }
+
+        submit_batch();
+        if(c->type == CMD_CLEAR)
+        {
+            SDL_SetRenderDrawColor(grend,c->c.r,c->c.g,c->c.b,255);
+            SDL_RenderClear(grend);
+        }
+        else
+        {
+            // Draw blending is off by default, so this overwrites alpha too
+            SDL_SetRenderDrawBlendMode(grend,SDL_BLENDMODE_NONE);
+            SDL_SetRenderDrawColor(grend,c->c.r,c->c.g,c->c.b,c->c.a);
+            SDL_RenderFillRect(grend,&c->rect);
+        }
+    }
+    submit_batch();
+
+    cmdCount = 0;
+    drawGroup = 0;
+    lastTex = NULL;
+    needSort = false;
+}
+
+
+// Set draw layer
+void set_draw_layer(int layer, bool sortTextures)
+{
+    drawLayer = layer;
+    sortLayer = sortTextures;
+    ++ drawGroup;
 }
 
 
@@ -46,8 +362,16 @@ SDL_Renderer* get_global_renderer()
 // Clear screen
 void clear(unsigned char r, unsigned char g, unsigned char b)
 {
-    SDL_SetRenderDrawColor(grend, r,g,b, 255);
-    SDL_RenderClear(grend);
+    if(software)
+    {
+        sw_fill_rect(swTarget,0,0,swTarget->w,swTarget->h,rgb(r,g,b));
+        return;
+    }
+
+    RENDER_CMD* c = add_command(CMD_CLEAR,NULL);
+    if(c == NULL) return;
+
+    c->c = rgb(r,g,b);
 }
 
 
@@ -72,14 +396,7 @@ void draw_bitmap(BITMAP* b, int dx, int dy, int flip)
     dx += transX;
     dy += transY;
 
-    SDL_Rect dest;
-
-    dest.x = dx;
-    dest.y = dy;
-    dest.w = b->w;
-    dest.h = b->h;
-
-    SDL_RenderCopyEx(grend,b->tex,NULL,&dest,0,NULL,(SDL_RendererFlip)flip);
+    push_quad(b,0,0,b->w,b->h,dx,dy,b->w,b->h,flip);
 }
 
 
@@ -89,14 +406,7 @@ void draw_scaled_bitmap(BITMAP* b, int dx, int dy, float sx, float sy, int flip)
     dx += transX;
     dy += transY;
 
-    SDL_Rect dest;
-
-    dest.x = dx;
-    dest.y = dy;
-    dest.w = (int)round(b->w * sx);
-    dest.h = (int)round(b->h * sy);
-
-    SDL_RenderCopyEx(grend,b->tex,NULL,&dest,0,NULL,(SDL_RendererFlip)flip);
+    push_quad(b,0,0,b->w,b->h,dx,dy,(int)round(b->w * sx),(int)round(b->h * sy),flip);
 }
 
 
@@ -106,19 +416,7 @@ void draw_bitmap_region(BITMAP* b, int sx, int sy, int sw, int sh, int dx, int d
     dx += transX;
     dy += transY;
 
-    SDL_Rect src, dest;
-
-    dest.x = dx;
-    dest.y = dy;
-    dest.w = sw;
-    dest.h = sh;
-
-    src.x = sx;
-    src.y = sy;
-    src.w = sw;
-    src.h = sh;
-
-    SDL_RenderCopyEx(grend,b->tex,&src,&dest,0,NULL,(SDL_RendererFlip)flip);
+    push_quad(b,sx,sy,sw,sh,dx,dy,sw,sh,flip);
 }
 
 
@@ -171,18 +469,34 @@ void draw_text_with_borders(BITMAP* b, Uint8* text, int len, int dx, int dy, int
     int x = -1;
     int y = -1;
 
+    if(len == -1) len = strlen((const char*)text);
+
+    // Use a pre-rendered run, if possible
+    POINT o;
+    BITMAP* run = get_text_run(b,text,len,xoff,yoff,true,&o);
+    if(run != NULL)
+    {
+        if(center)
+            dx -= (int) ( ((float)len+1)/2.0f * (float)(b->w/16 +xoff) );
+
+        draw_bitmap(run,dx - o.x,dy - o.y,0);
+        return;
+    }
+
+    COLOR c = b->c;
+    b->c = rgb(0,0,0);
+
     for(; y <= 1; ++ y)
     {
         for(x=-1; x <= 1; ++ x)
         {
             if(x == y && x == 0) continue;
 
-            SDL_SetTextureColorMod(b->tex,0,0,0);
             draw_text(b,text,len,dx +x,dy +y,xoff,yoff,center);
         }
     }
 
-    SDL_SetTextureColorMod(b->tex,b->c.r,b->c.g,b->c.b);
+    b->c = c;
     draw_text(b,text,len,dx,dy,xoff,yoff,center);
 }
 
@@ -190,23 +504,115 @@ void draw_text_with_borders(BITMAP* b, Uint8* text, int len, int dx, int dy, int
 // Fill rectangle
 void fill_rect(int x, int y, int w, int h, COLOR c)
 {
-    SDL_Rect dst = (SDL_Rect){x,y,w,h};
-    SDL_SetRenderDrawColor(grend,c.r,c.g,c.b,c.a);
-    SDL_RenderFillRect(grend,&dst);
+    if(software)
+    {
+        sw_fill_rect(swTarget,x,y,w,h,c);
+        return;
+    }
+
+    RENDER_CMD* cmd = add_command(CMD_FILL,NULL);
+    if(cmd == NULL) return;
+
+    cmd->rect = (SDL_Rect){x,y,w,h};
+    cmd->c = c;
 }
 
 
 // Set bitmap color
 void set_bitmap_color(BITMAP* b, COLOR c)
 {
-    SDL_SetTextureColorMod(b->tex,c.r,c.g,c.b);
+    // Stored to the vertex colours of the batch. The software
+    // rasterizer swaps the palette of an indexed bitmap instead
     b->c = c;
 }
 
 
+// Render targets lost
+void render_targets_lost()
+{
+    ++ targetLosses;
+
+    // The text runs are drawn again when used
+    destroy_text_cache();
+}
+
+
+// Get render target losses
+Uint32 get_render_target_losses()
+{
+    return targetLosses;
+}
+
+
+// Set render target
+void set_render_target(BITMAP* b)
+{
+    if(software)
+    {
+        if(b == NULL)
+        {
+            swTarget = swPrevTarget;
+            return;
+        }
+        swPrevTarget = swTarget;
+        swTarget = b;
+        return;
+    }
+
+    flush_graphics();
+
+    if(b == NULL)
+    {
+        SDL_SetRenderTarget(grend,prevTarget);
+        return;
+    }
+
+    prevTarget = SDL_GetRenderTarget(grend);
+    SDL_SetRenderTarget(grend,b->tex);
+}
+
+
+// Clear region
+void clear_region(int x, int y, int w, int h)
+{
+    if(software)
+    {
+        sw_fill_rect(swTarget,x,y,w,h,(COLOR){0,0,0,0});
+        return;
+    }
+
+    RENDER_CMD* cmd = add_command(CMD_FILL,NULL);
+    if(cmd == NULL) return;
+
+    cmd->rect = (SDL_Rect){x,y,w,h};
+    cmd->c = (COLOR){0,0,0,0};
+}
+
+
 // Translate graphics
 void translate(int x, int y)
 {
     transX = x;
     transY = y;
-}
\ No newline at end of file
+}
+
+
+// Get translation
+POINT get_translation()
+{
+    return (POINT){transX,transY};
+}
+
+
+// Draw a sprite frame
+void spr_draw_frame(SPRITE*s, BITMAP* bmp, int frame, int row, int x, int y, int flip)
+{
+    draw_bitmap_region(bmp,s->w*frame,s->h*row,s->w,s->h,x,y,flip);
+}
+
+
+// Draw a sprite
+void spr_draw(SPRITE* s, BITMAP* bmp, int x, int y, int flip)
+{
+    spr_draw_frame(s,bmp,s->frame,s->row,x,y,flip);
+}
@@ -8,6 +8,15 @@
 
 #include "bitmap.h"
 #include "vector.h"
+#include "sprite.h"
+
+/// Maximum amount of quads in a single batch
+#define MAX_BATCH_QUADS 2048
+/// Initial room for queued render commands, the
+/// queue grows if a frame needs more
+#define RENDER_COMMANDS_INITIAL 4096
+/// Layer for overlays drawn on top of the scenes
+#define DRAW_LAYER_TOP 0x7fff
 
 /// Flipping enumerations
 enum
@@ -21,6 +30,35 @@ enum
 /// Initialize graphics
 void init_graphics();
 
+/// Enable the software rasterizer. Must be called before
+/// any bitmaps are loaded
+/// < w Framebuffer width
+/// < h Framebuffer height
+/// > 0 on success, 1 on error
+int enable_software_rendering(int w, int h);
+
+/// Is the software rasterizer in use
+/// > True, if software rendering is enabled
+bool is_software_rendering();
+
+/// Returns the software framebuffer
+/// > Framebuffer, NULL if software rendering is not enabled
+BITMAP* get_framebuffer();
+
+/// Sort and submit the queued render commands. Called
+/// automatically when the render target changes, must be
+/// called before the frame is presented
+void flush_graphics();
+
+/// Set the layer of the following draw calls. Commands are
+/// submitted in layer order. Inside a layer, commands are
+/// grouped by texture if sorting is allowed, which is only
+/// safe when draws of different textures do not overlap.
+/// Otherwise the drawing order is kept
+/// < layer Layer
+/// < sortTextures Allow sorting by texture
+void set_draw_layer(int layer, bool sortTextures);
+
 /// Set the global renderer
 /// < rend Renderer
 void set_global_renderer(SDL_Renderer* rend);
@@ -105,9 +143,52 @@ void fill_rect(int x, int y, int w, int h, COLOR c);
 /// < c Color
 void set_bitmap_color(BITMAP* b, COLOR c);
 
+/// Set the render target. The queued commands are submitted
+/// first, so the targets are drawn to before a frame is drawn
+/// < b Target bitmap, NULL to restore the previous target
+void set_render_target(BITMAP* b);
+
+/// Tell that the render targets have lost their contents, like when
+/// the window is resized with some renderers. The cached text runs are
+/// destroyed
+void render_targets_lost();
+
+/// Get how many times the render targets have lost their contents
+/// > Count, a bitmap drawn to before it changed must be drawn again
+Uint32 get_render_target_losses();
+
+/// Clear a region of the current target to transparent
+/// < x X coordinate
+/// < y Y coordinate
+/// < w Width
+/// < h Height
+void clear_region(int x, int y, int w, int h);
+
 /// Translate graphics
 /// < x Horizontal translation
 /// < y Vertical translation
 void translate(int x, int y);
 
+/// Returns the current translation
+/// > Translation
+POINT get_translation();
+
+/// Draw a sprite frame
+/// < s Sprite to draw
+/// < bmp Bitmap to use
+/// < frame Sprite frame to draw
+/// < row Sprite row to draw
+/// < x Destination X 
+/// < y Destination Y
+/// < flip Flipping flag
+void spr_draw_frame(SPRITE*s, BITMAP* bmp, int frame, int row, int x, int y, int flip);
+
+/// Draw a sprite
+/// < s Sprite to draw
+/// < bmp Bitmap to use
+/// < x Destination X 
+/// < y Destination Y
+/// < flip Flipping flag
+void spr_draw(SPRITE* s, BITMAP* bmp, int x, int y, int flip);
+
 #endif // __GRAPHICS__
@@ -0,0 +1,303 @@
+/// Asset hot reloading (source)
+/// (c) 2018 Jani Nykänen
+
+#include "hotreload.h"
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#ifdef __linux__
+#define USE_INOTIFY
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Maximum amount of watched directories
+#define MAX_WATCHES 16
+// Path buffer size
+#define PATH_SIZE 256
+
+// Watched directory
+typedef struct
+{
+    int wd;
+    char dir[PATH_SIZE]; // Ends with a slash, or is empty
+    bool stageSources;
+}
+WATCH;
+
+// Is hot reloading enabled
+static bool enabled = false;
+// inotify instance, -1 if none
+static int fd = -1;
+// Watched directories
+static WATCH watches[MAX_WATCHES];
+static int watchCount = 0;
+// Watched pack
+static ASSET_PACK* pack = NULL;
+// Assets changed since the last update
+static bool* changed = NULL;
+// Stage spawn check
+static SPAWN_CHECK spawnCheck = NULL;
+// Reload callback
+static RELOAD_CALLBACK reloaded = NULL;
+
+
+// Get the file name part of a path
+static const char* file_name(const char* path)
+{
+    const char* slash = strrchr(path,'/');
+    return slash != NULL ? slash+1 : path;
+}
+
+
+// Can the asset be reloaded
+static bool is_reloadable(ASSET_PACK* p, int i)
+{
+    int type = p->types[i];
+    return p->slots[i].path != NULL
+        && (type == ASSET_BITMAP || type == ASSET_TILEMAP || type == ASSET_STAGE);
+}
+
+
+#ifdef USE_INOTIFY
+
+// Add a watch, if the directory is not watched yet
+static int add_watch(const char* dir, int len, bool stageSources)
+{
+    if(len >= PATH_SIZE) return 1;
+
+    int i = 0;
+    for(; i < watchCount; ++ i)
+    {
+        if((int)strlen(watches[i].dir) == len && strncmp(watches[i].dir,dir,len) == 0)
+        {
+            watches[i].stageSources |= stageSources;
+            return 0;
+        }
+    }
+    if(watchCount == MAX_WATCHES) return 1;
+
+    if(fd < 0)
+    {
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if(fd < 0) return 1;
+    }
+
+    WATCH* w = &watches[watchCount];
+    memcpy(w->dir,dir,len);
+    w->dir[len] = '\0';
+    w->stageSources = stageSources;
+
+    // Editors either write the file or move a new one over it
+    w->wd = inotify_add_watch(fd,len > 0 ? w->dir : ".",IN_CLOSE_WRITE | IN_MOVED_TO);
+    if(w->wd < 0)
+    {
+        printf("Failed to watch %s for changes.\n",w->dir);
+        return 1;
+    }
+    ++ watchCount;
+
+    return 0;
+}
+
+
+// Compile a changed TMX stage source over the stage
+// file. The stage is reloaded when the stage file changes
+static void compile_source(const char* path)
+{
+    const char* name = file_name(path);
+    const char* ext = strrchr(name,'.');
+    if(ext == NULL || strcmp(ext,".tmx") != 0) return;
+
+    char stageName[PATH_SIZE];
+    snprintf(stageName,PATH_SIZE,"%.*s.stg",(int)(ext-name),name);
+
+    Uint32 i = 0;
+    for(; i < pack->assetCount; ++ i)
+    {
+        if(pack->types[i] == ASSET_STAGE && pack->slots[i].path != NULL
+         && strcmp(file_name(pack->slots[i].path),stageName) == 0)
+            break;
+    }
+    if(i == pack->assetCount) return;
+
+    TILEMAP* t = load_tilemap(path);
+    if(t == NULL) return;
+
+    size_t size;
+    uint8_t* data = compile_stage(t,spawnCheck,&size);
+    destroy_tilemap(t);
+    if(data == NULL) return;
+
+    // The old stage maps its file, so the file is
+    // replaced instead of written over
+    char tmp[PATH_SIZE +8];
+    snprintf(tmp,PATH_SIZE +8,"%s.tmp",pack->slots[i].path);
+
+    FILE* f = fopen(tmp,"wb");
+    bool ok = f != NULL && fwrite(data,1,size,f) == size;
+    if(f != NULL && fclose(f) != 0)
+        ok = false;
+    if(!ok || rename(tmp,pack->slots[i].path) != 0)
+    {
+        printf("Failed to write %s.\n",pack->slots[i].path);
+        remove(tmp);
+    }
+    free(data);
+}
+
+
+// Handle a changed file
+static void on_change(const WATCH* w, const char* name)
+{
+    char path[PATH_SIZE*2];
+    snprintf(path,PATH_SIZE*2,"%s%s",w->dir,name);
+
+    if(w->stageSources && spawnCheck != NULL)
+        compile_source(path);
+
+    Uint32 i = 0;
+    for(; i < pack->assetCount; ++ i)
+    {
+        if(is_reloadable(pack,i) && strcmp(pack->slots[i].path,path) == 0)
+            changed[i] = true;
+    }
+}
+
+
+// Read the pending events
+static void read_events()
+{
+    // Aligned for the event structure
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event* ev;
+    ssize_t len;
+    char* ptr;
+    int i;
+
+    while((len = read(fd,buf,sizeof(buf))) > 0)
+    {
+        for(ptr = buf; ptr < buf + len; ptr += sizeof(struct inotify_event) + ev->len)
+        {
+            ev = (const struct inotify_event*)ptr;
+            if(ev->len == 0) continue;
+
+            for(i = 0; i < watchCount; ++ i)
+            {
+                if(watches[i].wd == ev->wd)
+                    on_change(&watches[i],ev->name);
+            }
+        }
+    }
+}
+
+#else
+
+// Add a watch
+static int add_watch(const char* dir, int len, bool stageSources)
+{
+    return 1;
+}
+
+
+// Read the pending events
+static void read_events() { }
+
+#endif
+
+
+// Enable hot reloading
+void enable_hot_reload(bool state)
+{
+    enabled = state;
+}
+
+
+// Watch asset pack
+int watch_asset_pack(ASSET_PACK* p)
+{
+    if(!enabled || pack != NULL) return 1;
+
+    changed = (bool*)calloc(p->assetCount > 0 ? p->assetCount : 1,sizeof(bool));
+    if(changed == NULL) return 1;
+    pack = p;
+
+    // Archives have no source files
+    const char* path;
+    Uint32 i = 0;
+    for(; i < p->assetCount; ++ i)
+    {
+        if(!is_reloadable(p,i)) continue;
+
+        path = p->slots[i].path;
+        add_watch(path,(int)(file_name(path) - path),false);
+    }
+
+    if(watchCount == 0)
+    {
+        printf("Hot reloading is not available.\n");
+        return 1;
+    }
+    printf("Watching %d asset directories for changes.\n",watchCount);
+
+    return 0;
+}
+
+
+// Watch stage sources
+void watch_stage_sources(const char* dir, SPAWN_CHECK is_spawn)
+{
+    if(pack == NULL) return;
+
+    spawnCheck = is_spawn;
+    add_watch(dir,(int)strlen(dir),true);
+}
+
+
+// Set reload callback
+void set_reload_callback(RELOAD_CALLBACK cb)
+{
+    reloaded = cb;
+}
+
+
+// Update hot reloading
+void update_hot_reload()
+{
+    if(pack == NULL || fd < 0) return;
+
+    read_events();
+
+    // An editor may write a file more than once
+    // a frame, it is reloaded once
+    Uint32 i = 0;
+    for(; i < pack->assetCount; ++ i)
+    {
+        if(!changed[i]) continue;
+        changed[i] = false;
+
+        printf("Reloading \"%s\".\n",pack->names[i]);
+        if(reload_asset(pack,(int)i) == 0 && reloaded != NULL)
+            reloaded((int)i);
+    }
+}
+
+
+// Stop hot reloading
+void stop_hot_reload()
+{
+#ifdef USE_INOTIFY
+    if(fd >= 0)
+        close(fd);
+#endif
+    fd = -1;
+    watchCount = 0;
+
+    free(changed);
+    changed = NULL;
+    pack = NULL;
+    spawnCheck = NULL;
+    reloaded = NULL;
+}
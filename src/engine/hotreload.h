@@ -0,0 +1,49 @@
+/// Asset hot reloading (header)
+/// (c) 2018 Jani Nykänen
+///
+/// A development mode that watches the asset directories, and
+/// reloads the assets whose files change. Only bitmaps, tilemaps
+/// and stages of a pack loaded from an asset list are reloaded.
+/// Uses inotify, so it works on Linux only
+
+#ifndef __HOT_RELOAD__
+#define __HOT_RELOAD__
+
+#include "assets.h"
+
+#include "../lib/stagefile.h"
+
+#include "stdbool.h"
+
+/// Reload callback, called after an asset was reloaded
+typedef void (*RELOAD_CALLBACK)(int id);
+
+/// Enable or disable hot reloading. Watching does
+/// nothing unless it is enabled
+/// < state True to enable
+void enable_hot_reload(bool state);
+
+/// Watch the directories of the assets in a pack
+/// < p Asset pack, loaded from an asset list
+/// > 0 on success, 1 if nothing is watched
+int watch_asset_pack(ASSET_PACK* p);
+
+/// Watch a directory of TMX stage sources. When "name.tmx"
+/// changes, it is compiled over the "name.stg" file of a
+/// stage in the pack, which is then reloaded
+/// < dir Directory path, ending with a slash
+/// < is_spawn Tells which tiles are object spawns
+void watch_stage_sources(const char* dir, SPAWN_CHECK is_spawn);
+
+/// Set the reload callback
+/// < cb Callback, may be NULL
+void set_reload_callback(RELOAD_CALLBACK cb);
+
+/// Reload the assets whose files have changed. Called once
+/// a frame, when no draw calls are queued
+void update_hot_reload();
+
+/// Stop watching
+void stop_hot_reload();
+
+#endif // __HOT_RELOAD__
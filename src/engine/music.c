@@ -2,6 +2,10 @@
 /// (c) 2018 Jani Nykänen
 
 #include "music.h"
+#include "assets.h"
+#include "stream.h"
+
+#include "../lib/pcm.h"
 
 #include "SDL2/SDL.h"
 
@@ -10,25 +14,29 @@
 #include "stdlib.h"
 #include "math.h"
 #include "stdio.h"
+#include "string.h"
+
 
+// Crossfade time in milliseconds
+#define FADE_TIME 1000
 
 // Global music volume
 static int globalMusicVol;
-// Is music playing
-static bool playing;
 // Music enabled
 static bool musicEnabled;
-// Old volume
-static float oldVol;
+// Stream of the music played last, -1 if none
+static int current;
+// Prefetched stream, -1 if none
+static int prefetched;
 
 
 // Init music
 int init_music()
 {
     globalMusicVol = 100;
-    playing = false;
     musicEnabled = true;
-    oldVol = 1.0f;
+    current = -1;
+    prefetched = -1;
 
     // Init formats
     int flags = MIX_INIT_OGG;
@@ -39,15 +47,32 @@ int init_music()
         return 0;
     }
 
-    // Open audio
-    if(Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 512)==-1) 
+    // Open audio, samples are stored in this format
+    if(Mix_OpenAudio(PCM_FREQUENCY, PCM_FORMAT, PCM_CHANNELS, 512)==-1) 
     {
         SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Failed to open audio!\n",NULL);
         return 1;
     }
 
-    return 0;
-}   
+    // Music is decoded by the streams, not SDL_mixer
+    return init_streams();
+}
+
+
+// Quit music
+void quit_music()
+{
+    quit_streams();
+    current = -1;
+    prefetched = -1;
+}
+
+
+// Check the file type
+static bool is_ogg(const void* data, size_t size)
+{
+    return size >= 4 && memcmp(data,"OggS",4) == 0;
+}
 
 
 // Load music
@@ -60,15 +85,48 @@ MUSIC* load_music(const char* path)
         return NULL;
     }
 
-    m->data = Mix_LoadMUS(path);
-    if(m->data == NULL)
+    // The file is mapped, and decoded while playing
+    m->asset = NULL;
+    m->file = map_file(path);
+    if(m->file == NULL || !is_ogg(m->file->data,m->file->size))
     {
         char err [64];
         snprintf(err,64,"Failed to load a file in %s!",path);
 
         SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!",err,NULL);
+        unmap_file(m->file);
+        free(m);
         return NULL;
     }
+    m->data = m->file->data;
+    m->size = m->file->size;
+
+    return m;
+}
+
+
+// Load music from memory
+MUSIC* load_music_from_memory(const void* data, int size)
+{
+    MUSIC* m = (MUSIC*)malloc(sizeof(MUSIC));
+    if(m == NULL)
+    {
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!\n",NULL);
+        return NULL;
+    }
+
+    // Music is decoded from the data while playing
+    m->asset = NULL;
+    m->file = NULL;
+    if(size < 0 || !is_ogg(data,(size_t)size))
+    {
+        free(m);
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Failed to load music from memory!",NULL);
+        return NULL;
+    }
+    m->data = (const Uint8*)data;
+    m->size = (size_t)size;
+
     return m;
 }
 
@@ -77,20 +135,67 @@ MUSIC* load_music(const char* path)
 void play_music(MUSIC* mus, float vol, int loops)
 {
     if(!musicEnabled) return;
+    if(mus->asset != NULL && !use_asset(mus->asset)) return;
+
+    // Music that is still heard is faded back in instead of
+    // restarted, so restarting a stage costs nothing. Music
+    // that was prefetched starts right away
+    int s = find_stream(mus);
+    if(s < 0)
+        s = open_stream(mus->data,mus->size,loops,mus);
+    if(s < 0) return;
+
+    if(s == prefetched)
+        prefetched = -1;
+
+    // Crossfade from the previous music
+    if(current != s && is_stream_audible(current))
+        fade_stream(current,0.0f,FADE_TIME);
+    fade_stream(s,vol,FADE_TIME);
+
+    current = s;
+}
+
+
+// Prefetch music
+void prefetch_music(MUSIC* mus, int loops)
+{
+    if(!musicEnabled) return;
+    if(mus->asset != NULL && !use_asset(mus->asset)) return;
+    if(find_stream(mus) >= 0) return;
+
+    // Only the latest guess is kept
+    if(prefetched >= 0 && !is_stream_audible(prefetched))
+        close_stream(prefetched,false);
+
+    prefetched = open_stream(mus->data,mus->size,loops,mus);
+}
 
-    oldVol = vol;
 
-    float mvol = (float)globalMusicVol / 100.0f;
+// Is the music playing
+bool is_music_playing(MUSIC* m)
+{
+    return find_stream(m) == current && is_stream_audible(current);
+}
 
-    int v = (int)(128 * vol * mvol);
-    if(v > 128) v = 128;
-    if(v < 0) v = 0;
 
-    Mix_HaltMusic();
-    Mix_VolumeMusic(v);
-    Mix_FadeInMusic(mus->data, loops,1000);
+// Is the music in use
+bool is_music_in_use(MUSIC* m)
+{
+    return find_stream(m) >= 0;
+}
+
+
+// Unload music
+void unload_music(MUSIC* m)
+{
+    // The decoder must not read the data anymore
+    close_owner_streams(m);
 
-    playing = true;
+    unmap_file(m->file);
+    m->file = NULL;
+    m->data = NULL;
+    m->size = 0;
 }
 
 
@@ -99,7 +204,7 @@ void destroy_music(MUSIC* m)
 {
     if(m == NULL) return;
 
-    Mix_FreeMusic(m->data);
+    unload_music(m);
     free(m);
 }
 
@@ -109,42 +214,32 @@ void stop_music()
 {
     if(!musicEnabled) return;
 
-    Mix_FadeOutMusic(1000);
+    fade_out_music(FADE_TIME);
 }
 
 
 // Fade out
 void fade_out_music(int ms)
 {
-    Mix_FadeOutMusic(ms);
+    if(is_stream_audible(current))
+        fade_stream(current,0.0f,ms);
+    current = -1;
 }
 
 
 // Enable music
 void enable_music(bool state)
 {
-    if(!state)
-    {
-        Mix_PauseMusic();
-        globalMusicVol = 0;
-    }
-    else
-    {
-        Mix_ResumeMusic();
-        globalMusicVol = 100;
-    }
+    pause_streams(!state);
+    globalMusicVol = state ? 100 : 0;
     musicEnabled = state;
-    
 }
 
 
 // Set global music volume
 void set_global_music_volume(int vol)
 {
-    float mvol = (float)vol / 100.0f;
-    int v = (int)(128 * oldVol * mvol);
-
-    Mix_VolumeMusic(v);
+    set_stream_volume(MIX_MAX_VOLUME * vol / 100);
 
     globalMusicVol = vol;
 }
@@ -154,4 +249,4 @@ void set_global_music_volume(int vol)
 int get_global_music_volume()
 {
     return globalMusicVol;
-}
\ No newline at end of file
+}
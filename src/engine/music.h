@@ -6,28 +6,65 @@
 
 #include "SDL2/SDL_mixer.h"
 
+#include "../lib/mapfile.h"
+
 #include "stdbool.h"
+#include "stddef.h"
 
-/// Music
+/// Music, an OGG file that is decoded while playing
 typedef struct
 {
-    Mix_Music* data;
+    const Uint8* data; /// File data, NULL if not loaded
+    size_t size; /// Data size
+    MAPPED_FILE* file; /// Owned file, if any
+    struct ASSET_SLOT* asset; /// Residency slot, if the music is an asset
 }
 MUSIC;
 
 /// Init music
 int init_music();
 
+/// Stop decoding music
+void quit_music();
+
 /// Load music
 /// < path File path
 MUSIC* load_music(const char* path);
 
-/// Play music
+/// Load music from memory. The data must stay
+/// valid as long as the music exists
+/// < data File data
+/// < size Data size
+MUSIC* load_music_from_memory(const void* data, int size);
+
+/// Play music, crossfading from the previous music. If
+/// the music is already playing, only its volume is changed
 /// < mus Music to play
 /// < vol Volume
 /// < loops Loops
 void play_music(MUSIC* mus, float vol, int loops);
 
+/// Start decoding music that is likely played next, so
+/// that it starts without a delay
+/// < mus Music
+/// < loops Loops
+void prefetch_music(MUSIC* mus, int loops);
+
+/// Is the music playing (or fading)
+/// < m Music
+/// > True, if m was played last and is still playing
+bool is_music_playing(MUSIC* m);
+
+/// Is the music playing, fading out or prefetched. The
+/// data of music in use must not be freed
+/// < m Music
+/// > True, if the music is decoded
+bool is_music_in_use(MUSIC* m);
+
+/// Free the data of music, the handle is kept
+/// < m Music
+void unload_music(MUSIC* m);
+
 /// Destroy music
 /// < m Music
 void destroy_music(MUSIC* m);
@@ -2,6 +2,7 @@
 /// (c) 2018 Jani Nykänen
 
 #include "sample.h"
+#include "assets.h"
 
 #include "stdlib.h"
 #include "math.h"
@@ -33,7 +34,7 @@ void set_global_sample_volume(int vol)
 SAMPLE* load_sample(const char* path)
 {
     // Allocate memory
-    SAMPLE * s = (SAMPLE*)malloc(sizeof(s));
+    SAMPLE * s = (SAMPLE*)malloc(sizeof(SAMPLE));
     if(s == NULL)
     {
         printf("Memory allocation error!\n");
@@ -52,6 +53,36 @@ SAMPLE* load_sample(const char* path)
     // Set default values
     s->channel = 0;
     s->played = false;
+    s->asset = NULL;
+
+    return s;
+}
+
+
+// Load a sound from memory
+SAMPLE* load_sample_from_memory(const void* data, int size)
+{
+    // Allocate memory
+    SAMPLE* s = (SAMPLE*)malloc(sizeof(SAMPLE));
+    if(s == NULL)
+    {
+        printf("Memory allocation error!\n");
+        return NULL;
+    }
+
+    // Decode WAV
+    s->chunk = Mix_LoadWAV_RW(SDL_RWFromConstMem(data,size),1);
+    if(!s->chunk) 
+    {
+        printf("Failed to load a sound from memory!\n");
+        free(s);
+        return NULL;
+    }
+
+    // Set default values
+    s->channel = 0;
+    s->played = false;
+    s->asset = NULL;
 
     return s;
 }
@@ -61,6 +92,7 @@ SAMPLE* load_sample(const char* path)
 void play_sample(SAMPLE* s, float vol)
 {
     if(s == NULL || !samplesEnabled) return;
+    if(s->asset != NULL && !use_asset(s->asset)) return;
 
     float svol = (float)globalSoundVol / 100.0f;
 
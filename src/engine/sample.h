@@ -15,6 +15,7 @@ typedef struct
     Mix_Chunk* chunk; /// Chunk
     int channel; /// Channel
     bool played; /// Has the sound been played at least once
+    struct ASSET_SLOT* asset; /// Residency slot, if the sample is an asset
 }
 SAMPLE;
 
@@ -30,6 +31,12 @@ void set_global_sample_volume(int vol);
 /// > A new sound
 SAMPLE* load_sample(const char* path);
 
+/// Load a sample from memory
+/// < data WAV file data
+/// < size Data size
+/// > A new sound
+SAMPLE* load_sample_from_memory(const void* data, int size);
+
 /// Play a sample
 /// < s Sample to play
 /// < vol Volume
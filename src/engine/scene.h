@@ -12,6 +12,7 @@ typedef struct
     void (*on_draw) (); /// Draw
     void (*on_destroy) (void); /// Destroy
     void (*on_swap) (void); /// Scene swapped
+    void (*on_draw_targets) (void); /// Draw to render targets, before the frame
     char name[8]; /// Scene name
 }
 SCENE;
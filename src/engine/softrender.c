@@ -0,0 +1,320 @@
+/// Software rasterizer (source)
+/// (c) 2018 Jani Nykänen
+
+#include "softrender.h"
+
+#include "graphics.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Pixels are stored as RGBA bytes
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+#define SHIFT_R 24
+#define SHIFT_G 16
+#define SHIFT_B 8
+#define SHIFT_A 0
+#else
+#define SHIFT_R 0
+#define SHIFT_G 8
+#define SHIFT_B 16
+#define SHIFT_A 24
+#endif
+
+// Maximum width of a scaled row
+#define MAX_ROW_WIDTH 1024
+
+// Pack a color
+#define PACK(r,g,b,a) ( ((Uint32)(r) << SHIFT_R) | ((Uint32)(g) << SHIFT_G) \
+    | ((Uint32)(b) << SHIFT_B) | ((Uint32)(a) << SHIFT_A) )
+// Get a channel
+#define CHANNEL(p,s) (((p) >> (s)) & 0xff)
+
+// Pixel at a bitmap position
+#define PIXEL(b,x,y) ((b)->pixels + ((b)->sy + (y)) * (b)->tw + (b)->sx + (x))
+// Palette index at a bitmap position
+#define INDEX(b,x,y) ((b)->indices + ((b)->sy + (y)) * (b)->tw + (b)->sx + (x))
+
+
+// Divide by 255, rounded
+static inline Uint32 div255(Uint32 v)
+{
+    v += 128;
+    return (v + (v >> 8)) >> 8;
+}
+
+
+// Modulate a pixel with a color
+static inline Uint32 modulate(Uint32 p, COLOR c)
+{
+    return PACK(div255(CHANNEL(p,SHIFT_R) * c.r),
+        div255(CHANNEL(p,SHIFT_G) * c.g),
+        div255(CHANNEL(p,SHIFT_B) * c.b),
+        CHANNEL(p,SHIFT_A));
+}
+
+
+// Blend a pixel to another
+static inline Uint32 blend(Uint32 s, Uint32 d)
+{
+    Uint32 a = CHANNEL(s,SHIFT_A);
+    Uint32 ia = 255 - a;
+
+    return PACK(div255(CHANNEL(s,SHIFT_R) * a + CHANNEL(d,SHIFT_R) * ia),
+        div255(CHANNEL(s,SHIFT_G) * a + CHANNEL(d,SHIFT_G) * ia),
+        div255(CHANNEL(s,SHIFT_B) * a + CHANNEL(d,SHIFT_B) * ia),
+        a + div255(CHANNEL(d,SHIFT_A) * ia));
+}
+
+
+// Draw a single pixel
+static inline void put_pixel(Uint32* d, Uint32 s, COLOR c, bool mod)
+{
+    if(mod) s = modulate(s,c);
+
+    Uint32 a = CHANNEL(s,SHIFT_A);
+    if(a == 255)
+        *d = s;
+    else if(a > 0)
+        *d = blend(s,*d);
+}
+
+
+#ifdef __SSE2__
+
+// Modulate four pixels
+static inline __m128i modulate4(__m128i s, __m128i c16)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi16(128);
+
+    __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(s,zero),c16);
+    __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(s,zero),c16);
+
+    lo = _mm_add_epi16(lo,half);
+    hi = _mm_add_epi16(hi,half);
+    lo = _mm_srli_epi16(_mm_add_epi16(lo,_mm_srli_epi16(lo,8)),8);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi,_mm_srli_epi16(hi,8)),8);
+
+    return _mm_packus_epi16(lo,hi);
+}
+
+#endif
+
+
+// Draw a row of pixels. If step is -1, the source
+// is read backwards
+static void draw_row(Uint32* d, const Uint32* s, int n, int step, COLOR c)
+{
+    bool mod = c.r != 255 || c.g != 255 || c.b != 255;
+    int i = 0;
+
+#ifdef __SSE2__
+    // Four pixels at once, as long as the alpha of
+    // each one is either zero or full
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi32(255);
+    const __m128i c16 = _mm_set_epi16(255,c.b,c.g,c.r,255,c.b,c.g,c.r);
+    __m128i src, dst, a, transp, opaque;
+
+    for(; i + 4 <= n; i += 4)
+    {
+        if(step > 0)
+        {
+            src = _mm_loadu_si128((const __m128i*)(s + i));
+        }
+        else
+        {
+            src = _mm_loadu_si128((const __m128i*)(s - i - 3));
+            src = _mm_shuffle_epi32(src,_MM_SHUFFLE(0,1,2,3));
+        }
+        if(mod) src = modulate4(src,c16);
+
+        a = _mm_srli_epi32(src,24);
+        transp = _mm_cmpeq_epi32(a,zero);
+        opaque = _mm_cmpeq_epi32(a,full);
+
+        if(_mm_movemask_epi8(_mm_or_si128(transp,opaque)) != 0xffff)
+        {
+            // Translucent pixels, blend one by one
+            int j = 0;
+            for(; j < 4; ++ j)
+                put_pixel(&d[i+j],s[(i+j) * step],c,mod);
+            continue;
+        }
+
+        dst = _mm_loadu_si128((const __m128i*)(d + i));
+        dst = _mm_or_si128(_mm_and_si128(transp,dst),_mm_andnot_si128(transp,src));
+        _mm_storeu_si128((__m128i*)(d + i),dst);
+    }
+#endif
+
+    for(; i < n; ++ i)
+    {
+        put_pixel(&d[i],s[i * step],c,mod);
+    }
+}
+
+
+// Modulate the palette with a colour, if the colour
+// has changed since the last time
+static void tint_palette(PALETTE* pal, COLOR c)
+{
+    if(pal->tint.r == c.r && pal->tint.g == c.g && pal->tint.b == c.b)
+        return;
+
+    int i = 0;
+    for(; i < pal->count; ++ i)
+    {
+        pal->colors[i] = modulate(pal->base[i],c);
+    }
+    pal->tint = c;
+}
+
+
+// Draw an indexed bitmap. Rows are expanded through the
+// palette, which is already modulated with the colour
+static void draw_indexed(BITMAP* dst, BITMAP* src, int sx, int sy, int sw, int sh,
+    int dx, int dy, int dw, int dh, int flip, int x1, int y1, int x2, int y2)
+{
+    const Uint32* lut = src->palette->colors;
+    const COLOR white = rgb(255,255,255);
+    Uint32 buffer[MAX_ROW_WIDTH];
+
+    int n = x2 - x1;
+    if(n > MAX_ROW_WIDTH) n = MAX_ROW_WIDTH;
+
+    Uint32 stepX = ((Uint32)sw << 16) / (Uint32)dw;
+    Uint32 stepY = ((Uint32)sh << 16) / (Uint32)dh;
+    Uint32 u, v;
+    const Uint8* s;
+    int x, y;
+    int row, col;
+
+    for(y = y1; y < y2; ++ y)
+    {
+        v = (Uint32)(y-dy) * stepY + stepY/2;
+        row = (int)(v >> 16);
+        if(flip & FLIP_VERTICAL) row = sh-1 - row;
+
+        s = INDEX(src,sx,sy + row);
+
+        // Non-scaled rows are read in order
+        if(stepX == (1 << 16) && !(flip & FLIP_HORIZONTAL))
+        {
+            s += x1-dx;
+            for(x = 0; x < n; ++ x)
+                buffer[x] = lut[s[x]];
+        }
+        else
+        {
+            for(x = 0; x < n; ++ x)
+            {
+                u = (Uint32)(x1-dx + x) * stepX + stepX/2;
+                col = (int)(u >> 16);
+                if(flip & FLIP_HORIZONTAL) col = sw-1 - col;
+
+                buffer[x] = lut[s[col]];
+            }
+        }
+        draw_row(PIXEL(dst,x1,y),buffer,n,1,white);
+    }
+}
+
+
+// Draw bitmap
+void sw_draw_bitmap(BITMAP* dst, BITMAP* src, int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, int flip, COLOR c)
+{
+    if(dw <= 0 || dh <= 0 || sw <= 0 || sh <= 0) return;
+
+    // Clip
+    int x1 = dx < 0 ? 0 : dx;
+    int y1 = dy < 0 ? 0 : dy;
+    int x2 = dx + dw > dst->w ? dst->w : dx + dw;
+    int y2 = dy + dh > dst->h ? dst->h : dy + dh;
+    if(x1 >= x2 || y1 >= y2) return;
+
+    // Indexed bitmaps are recoloured by their palette
+    if(src->indices != NULL && src->palette != NULL)
+    {
+        tint_palette(src->palette,c);
+        draw_indexed(dst,src,sx,sy,sw,sh,dx,dy,dw,dh,flip,x1,y1,x2,y2);
+        return;
+    }
+
+    int n = x2 - x1;
+    int x, y;
+    int row;
+    const Uint32* s;
+
+    // Non-scaled
+    if(dw == sw && dh == sh)
+    {
+        for(y = y1; y < y2; ++ y)
+        {
+            row = (flip & FLIP_VERTICAL) ? sh-1 - (y-dy) : (y-dy);
+            if(flip & FLIP_HORIZONTAL)
+            {
+                s = PIXEL(src,sx + sw-1 - (x1-dx),sy + row);
+                draw_row(PIXEL(dst,x1,y),s,n,-1,c);
+            }
+            else
+            {
+                s = PIXEL(src,sx + (x1-dx),sy + row);
+                draw_row(PIXEL(dst,x1,y),s,n,1,c);
+            }
+        }
+        return;
+    }
+
+    // Scaled, nearest neighbour. Columns are fetched
+    // to a buffer first
+    Uint32 buffer[MAX_ROW_WIDTH];
+    if(n > MAX_ROW_WIDTH) n = MAX_ROW_WIDTH;
+
+    Uint32 stepX = ((Uint32)sw << 16) / (Uint32)dw;
+    Uint32 stepY = ((Uint32)sh << 16) / (Uint32)dh;
+    Uint32 u, v;
+    int col;
+
+    for(y = y1; y < y2; ++ y)
+    {
+        v = (Uint32)(y-dy) * stepY + stepY/2;
+        row = (int)(v >> 16);
+        if(flip & FLIP_VERTICAL) row = sh-1 - row;
+
+        s = PIXEL(src,sx,sy + row);
+        for(x = 0; x < n; ++ x)
+        {
+            u = (Uint32)(x1-dx + x) * stepX + stepX/2;
+            col = (int)(u >> 16);
+            if(flip & FLIP_HORIZONTAL) col = sw-1 - col;
+
+            buffer[x] = s[col];
+        }
+        draw_row(PIXEL(dst,x1,y),buffer,n,1,c);
+    }
+}
+
+
+// Fill rectangle
+void sw_fill_rect(BITMAP* dst, int x, int y, int w, int h, COLOR c)
+{
+    int x1 = x < 0 ? 0 : x;
+    int y1 = y < 0 ? 0 : y;
+    int x2 = x + w > dst->w ? dst->w : x + w;
+    int y2 = y + h > dst->h ? dst->h : y + h;
+    if(x1 >= x2 || y1 >= y2) return;
+
+    Uint32 p = PACK(c.r,c.g,c.b,c.a);
+    Uint32* d;
+    int i;
+
+    for(; y1 < y2; ++ y1)
+    {
+        d = PIXEL(dst,x1,y1);
+        for(i = 0; i < x2-x1; ++ i)
+            d[i] = p;
+    }
+}
@@ -0,0 +1,36 @@
+/// Software rasterizer (header)
+/// (c) 2018 Jani Nykänen
+
+#ifndef __SOFT_RENDER__
+#define __SOFT_RENDER__
+
+#include "bitmap.h"
+
+/// Draw a (scaled) bitmap region to a bitmap. Alpha is blended
+/// like SDL_BLENDMODE_BLEND, and source colours are modulated
+/// with the given colour. Indexed bitmaps modulate their palette
+/// instead, only when the colour changes
+/// < dst Destination bitmap
+/// < src Source bitmap
+/// < sx Source X
+/// < sy Source Y
+/// < sw Source W
+/// < sh Source H
+/// < dx Destination X
+/// < dy Destination Y
+/// < dw Destination W
+/// < dh Destination H
+/// < flip Flip
+/// < c Color
+void sw_draw_bitmap(BITMAP* dst, BITMAP* src, int sx, int sy, int sw, int sh, int dx, int dy, int dw, int dh, int flip, COLOR c);
+
+/// Fill a rectangle in a bitmap, alpha is overwritten
+/// < dst Destination bitmap
+/// < x X coordinate
+/// < y Y coordinate
+/// < w Width
+/// < h Height
+/// < c Color
+void sw_fill_rect(BITMAP* dst, int x, int y, int w, int h, COLOR c);
+
+#endif // __SOFT_RENDER__
@@ -1,11 +1,12 @@
 /// Sprite (header)
 /// (c) 2018 Jani Nykänen
+///
+/// Sprite animation only, sprites are drawn with
+/// the functions in graphics.h
 
 #ifndef __SPRITE__
 #define __SPRITE__
 
-#include "bitmap.h"
-
 /// Sprite object
 typedef struct
 {
@@ -32,22 +33,4 @@ SPRITE create_sprite(int w, int h);
 /// < tm Time multiplier
 void spr_animate(SPRITE*s, int row, int start, int end, float speed, float tm);
 
-/// Draw a sprite frame
-/// < s Sprite to draw
-/// < bmp Bitmap to use
-/// < frame Sprite frame to draw
-/// < row Sprite row to draw
-/// < x Destination X 
-/// < y Destination Y
-/// < flip Flipping flag
-void spr_draw_frame(SPRITE*s, BITMAP* bmp, int frame, int row, int x, int y, int flip);
-
-/// Draw a sprite
-/// < s Sprite to draw
-/// < bmp Bitmap to use
-/// < x Destination X 
-/// < y Destination Y
-/// < flip Flipping flag
-void spr_draw(SPRITE* s, BITMAP* bmp, int x, int y, int flip);
-
 #endif // __SPRITE__
\ No newline at end of file
@@ -0,0 +1,591 @@
+/// Music streams (source)
+/// (c) 2018 Jani Nykänen
+
+#include "stream.h"
+
+#include "SDL2/SDL_mixer.h"
+#include "vorbis/vorbisfile.h"
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+// Ring buffer size in bytes, a power of two. About
+// 0.37 seconds of 44.1 kHz 16-bit stereo
+#define RING_SIZE 65536
+// Bytes decoded at a time
+#define DECODE_SIZE 4096
+// How long the decoder waits when the rings are full
+#define DECODER_SLEEP 10
+
+// A fade command is the target volume in thousandths,
+// and the fade length in frames in the low bits
+#define FADE_FRAME_BITS 20
+#define FADE_FRAME_MASK ((1 << FADE_FRAME_BITS) -1)
+
+// Stream states
+enum
+{
+    STREAM_IDLE = 0,
+    STREAM_START = 1, // Opened, the decoder opens the file
+    STREAM_DECODING = 2,
+    STREAM_ENDED = 3, // Everything is decoded
+    STREAM_CLOSING = 4, // The decoder closes the file
+};
+
+// Stream
+typedef struct
+{
+    // Written by the decoder, read by the audio thread
+    Uint8 ring[RING_SIZE];
+
+    // Set when opened, read by the decoder
+    const void* owner;
+    const Uint8* data;
+    size_t size;
+    int loops; // Times left to loop, -1 for forever
+    Uint32 startPos; // Write position when opened
+
+    // Decoder thread only
+    OggVorbis_File vorbis;
+    SDL_AudioStream* convert;
+    size_t pos; // Read position in the data
+    bool open;
+    bool flushed;
+
+    // Shared. Positions are byte counts that wrap around. Only
+    // the decoder moves the write position, and only the audio
+    // thread the read position
+    SDL_atomic_t state;
+    SDL_atomic_t generation; // Incremented when opened
+    SDL_atomic_t audible;
+    SDL_atomic_t fade;
+    SDL_atomic_t readPos;
+    SDL_atomic_t writePos;
+
+    // Audio thread only
+    int mixGeneration;
+    int lastFade;
+    float gain;
+    float target;
+    float step;
+    int fadeLeft;
+}
+STREAM;
+
+// Streams
+static STREAM streams[MAX_STREAMS];
+// Decoder thread
+static SDL_Thread* decoder = NULL;
+// Wakes the decoder up
+static SDL_sem* wake = NULL;
+// Is the decoder running
+static SDL_atomic_t running;
+// Volume of all the streams, 0-128
+static SDL_atomic_t volume;
+// Are the streams paused
+static SDL_atomic_t paused;
+
+// Output format
+static int frequency;
+static int channels;
+static int frameSize;
+
+
+// Read from the file data
+static size_t read_data(void* ptr, size_t size, size_t count, void* source)
+{
+    STREAM* s = (STREAM*)source;
+    if(size == 0) return 0;
+
+    size_t n = count;
+    if(n > (s->size - s->pos) / size)
+        n = (s->size - s->pos) / size;
+
+    memcpy(ptr,s->data + s->pos,n * size);
+    s->pos += n * size;
+
+    return n;
+}
+
+
+// Seek in the file data
+static int seek_data(void* source, ogg_int64_t offset, int whence)
+{
+    STREAM* s = (STREAM*)source;
+    ogg_int64_t pos = offset;
+    if(whence == SEEK_CUR)
+        pos += (ogg_int64_t)s->pos;
+    else if(whence == SEEK_END)
+        pos += (ogg_int64_t)s->size;
+
+    if(pos < 0 || pos > (ogg_int64_t)s->size)
+        return -1;
+
+    s->pos = (size_t)pos;
+    return 0;
+}
+
+
+// Tell the position in the file data
+static long tell_data(void* source)
+{
+    return (long)((STREAM*)source)->pos;
+}
+
+
+// Wake the decoder up, if it is waiting
+static void wake_decoder()
+{
+    if(wake != NULL && SDL_SemValue(wake) == 0)
+        SDL_SemPost(wake);
+}
+
+
+// Open the file of a stream
+static int open_file(STREAM* s)
+{
+    ov_callbacks cb = {read_data, seek_data, NULL, tell_data};
+
+    s->pos = 0;
+    s->flushed = false;
+    if(ov_open_callbacks(s,&s->vorbis,NULL,0,cb) != 0)
+        return 1;
+
+    // Converted to the output format as it is decoded
+    vorbis_info* info = ov_info(&s->vorbis,-1);
+    s->convert = SDL_NewAudioStream(AUDIO_S16LSB,(Uint8)info->channels,(int)info->rate,
+        AUDIO_S16SYS,(Uint8)channels,frequency);
+    if(s->convert == NULL)
+    {
+        ov_clear(&s->vorbis);
+        return 1;
+    }
+    s->open = true;
+
+    return 0;
+}
+
+
+// Close the file of a stream
+static void close_file(STREAM* s)
+{
+    if(!s->open) return;
+
+    SDL_FreeAudioStream(s->convert);
+    ov_clear(&s->vorbis);
+    s->convert = NULL;
+    s->open = false;
+}
+
+
+// Write to the ring buffer
+static void write_ring(STREAM* s, const Uint8* buf, int len)
+{
+    Uint32 w = (Uint32)SDL_AtomicGet(&s->writePos);
+    int i = (int)(w & (RING_SIZE-1));
+    int first = RING_SIZE - i < len ? RING_SIZE - i : len;
+
+    memcpy(s->ring + i,buf,first);
+    memcpy(s->ring,buf + first,len - first);
+
+    // The data must be visible before the position
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&s->writePos,(int)(w + (Uint32)len));
+}
+
+
+// Decode until the ring buffer is full
+// > True, if anything was decoded
+static bool decode(STREAM* s)
+{
+    Uint8 buf[DECODE_SIZE];
+    bool decoded = false;
+    int section;
+    long got;
+    int space;
+    int n;
+
+    for(;;)
+    {
+        space = RING_SIZE - (int)((Uint32)SDL_AtomicGet(&s->writePos)
+            - (Uint32)SDL_AtomicGet(&s->readPos));
+        if(space > DECODE_SIZE) space = DECODE_SIZE;
+        space -= space % frameSize;
+        if(space <= 0) break;
+
+        // Move converted frames to the ring
+        n = SDL_AudioStreamAvailable(s->convert);
+        n -= n % frameSize;
+        if(n > 0)
+        {
+            n = SDL_AudioStreamGet(s->convert,buf,n < space ? n : space);
+            if(n <= 0) break;
+
+            write_ring(s,buf,n);
+            decoded = true;
+            continue;
+        }
+        if(s->flushed)
+        {
+            SDL_AtomicCAS(&s->state,STREAM_DECODING,STREAM_ENDED);
+            break;
+        }
+
+        got = ov_read(&s->vorbis,(char*)buf,DECODE_SIZE,0,2,1,&section);
+        if(got > 0)
+        {
+            SDL_AudioStreamPut(s->convert,buf,(int)got);
+        }
+        else if(got == OV_HOLE)
+        {
+            continue;
+        }
+        // Loops continue from the first frame without a gap
+        else if(got == 0 && s->loops != 0 && ov_pcm_seek(&s->vorbis,0) == 0)
+        {
+            if(s->loops > 0)
+                -- s->loops;
+        }
+        else
+        {
+            SDL_AudioStreamFlush(s->convert);
+            s->flushed = true;
+        }
+    }
+
+    return decoded;
+}
+
+
+// Update a stream on the decoder thread
+// > True, if there was something to do
+static bool update_decoder(STREAM* s)
+{
+    switch(SDL_AtomicGet(&s->state))
+    {
+    case STREAM_START:
+        // The fields set when opened
+        SDL_MemoryBarrierAcquire();
+        if(open_file(s) != 0)
+        {
+            printf("Failed to decode music!\n");
+            SDL_AtomicCAS(&s->state,STREAM_START,STREAM_CLOSING);
+        }
+        else
+        {
+            SDL_AtomicCAS(&s->state,STREAM_START,STREAM_DECODING);
+        }
+        return true;
+
+    case STREAM_DECODING:
+        return decode(s);
+
+    case STREAM_CLOSING:
+        close_file(s);
+        SDL_AtomicSet(&s->audible,0);
+        SDL_AtomicSet(&s->state,STREAM_IDLE);
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+
+// Decoder thread
+static int decoder_thread(void* data)
+{
+    bool busy;
+    int i;
+
+    while(SDL_AtomicGet(&running))
+    {
+        busy = false;
+        for(i = 0; i < MAX_STREAMS; ++ i)
+        {
+            busy |= update_decoder(&streams[i]);
+        }
+
+        if(!busy)
+            SDL_SemWaitTimeout(wake,DECODER_SLEEP);
+    }
+
+    for(i = 0; i < MAX_STREAMS; ++ i)
+    {
+        close_file(&streams[i]);
+        SDL_AtomicSet(&streams[i].audible,0);
+        SDL_AtomicSet(&streams[i].state,STREAM_IDLE);
+    }
+
+    return 0;
+}
+
+
+// Mix a stream to the output, on the audio thread
+static void mix_stream(STREAM* s, Sint16* out, int frames, float master)
+{
+    int state = SDL_AtomicGet(&s->state);
+    if(state == STREAM_IDLE || state == STREAM_CLOSING)
+        return;
+
+    // A new stream starts silent, after the data left
+    // by the previous one
+    int gen = SDL_AtomicGet(&s->generation);
+    if(gen != s->mixGeneration)
+    {
+        SDL_MemoryBarrierAcquire();
+        SDL_AtomicSet(&s->readPos,(int)s->startPos);
+
+        s->mixGeneration = gen;
+        s->lastFade = -1;
+        s->gain = 0.0f;
+        s->fadeLeft = 0;
+    }
+    if(!SDL_AtomicGet(&s->audible))
+        return;
+
+    // Start a new fade from the current volume
+    int fade = SDL_AtomicGet(&s->fade);
+    if(fade != s->lastFade)
+    {
+        s->lastFade = fade;
+        s->target = (float)(fade >> FADE_FRAME_BITS) / 1000.0f;
+        s->fadeLeft = fade & FADE_FRAME_MASK;
+        if(s->fadeLeft > 0)
+            s->step = (s->target - s->gain) / (float)s->fadeLeft;
+        else
+            s->gain = s->target;
+    }
+
+    Uint32 r = (Uint32)SDL_AtomicGet(&s->readPos);
+    Uint32 avail = (Uint32)SDL_AtomicGet(&s->writePos) - r;
+    SDL_MemoryBarrierAcquire();
+
+    int count = (int)(avail / frameSize);
+    if(count > frames) count = frames;
+
+    Sint32 v;
+    int i = 0;
+    int c;
+    for(; i < count; ++ i)
+    {
+        if(s->fadeLeft > 0 && -- s->fadeLeft == 0)
+            s->gain = s->target;
+        else if(s->fadeLeft > 0)
+            s->gain += s->step;
+
+        for(c = 0; c < channels; ++ c)
+        {
+            v = *out + (Sint32)((float)*(const Sint16*)(s->ring + (r & (RING_SIZE-1))) * s->gain * master);
+            *(out ++) = (Sint16)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+            r += 2;
+        }
+    }
+
+    // The data is read before the space is freed
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&s->readPos,(int)r);
+    if(count > 0)
+        wake_decoder();
+
+    // Faded out and drained streams are closed by the decoder
+    if((s->fadeLeft == 0 && s->gain <= 0.0f)
+     || (state == STREAM_ENDED && avail == (Uint32)(count * frameSize)))
+    {
+        SDL_AtomicCAS(&s->state,state,STREAM_CLOSING);
+        wake_decoder();
+    }
+}
+
+
+// Mix the streams, called by SDL_mixer before the channels
+// are mixed. The output is silent when this is called
+static void mix_streams(void* udata, Uint8* out, int len)
+{
+    if(SDL_AtomicGet(&paused)) return;
+
+    float master = (float)SDL_AtomicGet(&volume) / (float)MIX_MAX_VOLUME;
+    int i = 0;
+    for(; i < MAX_STREAMS; ++ i)
+    {
+        mix_stream(&streams[i],(Sint16*)out,len / frameSize,master);
+    }
+}
+
+
+// Init streams
+int init_streams()
+{
+    Uint16 format;
+    if(Mix_QuerySpec(&frequency,&format,&channels) == 0 || format != AUDIO_S16SYS)
+    {
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Unsupported audio format!\n",NULL);
+        return 1;
+    }
+    frameSize = 2 * channels;
+
+    int i = 0;
+    for(; i < MAX_STREAMS; ++ i)
+    {
+        SDL_AtomicSet(&streams[i].state,STREAM_IDLE);
+        SDL_AtomicSet(&streams[i].audible,0);
+        streams[i].open = false;
+    }
+    SDL_AtomicSet(&volume,MIX_MAX_VOLUME);
+    SDL_AtomicSet(&paused,0);
+    SDL_AtomicSet(&running,1);
+
+    wake = SDL_CreateSemaphore(0);
+    decoder = wake != NULL ? SDL_CreateThread(decoder_thread,"music",NULL) : NULL;
+    if(decoder == NULL)
+    {
+        if(wake != NULL) SDL_DestroySemaphore(wake);
+        wake = NULL;
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Failed to start the music decoder!\n",NULL);
+        return 1;
+    }
+
+    Mix_HookMusic(mix_streams,NULL);
+
+    return 0;
+}
+
+
+// Quit streams
+void quit_streams()
+{
+    if(decoder == NULL) return;
+
+    Mix_HookMusic(NULL,NULL);
+
+    SDL_AtomicSet(&running,0);
+    SDL_SemPost(wake);
+    SDL_WaitThread(decoder,NULL);
+    SDL_DestroySemaphore(wake);
+    decoder = NULL;
+    wake = NULL;
+}
+
+
+// Open stream
+int open_stream(const void* data, size_t size, int loops, const void* owner)
+{
+    if(decoder == NULL || data == NULL) return -1;
+
+    int i = 0;
+    for(; i < MAX_STREAMS; ++ i)
+    {
+        if(SDL_AtomicGet(&streams[i].state) == STREAM_IDLE)
+            break;
+    }
+    if(i == MAX_STREAMS) return -1;
+
+    // Idle streams are not used by the other threads
+    STREAM* s = &streams[i];
+    s->owner = owner;
+    s->data = (const Uint8*)data;
+    s->size = size;
+    s->loops = loops < 0 ? -1 : (loops > 1 ? loops-1 : 0);
+    // The audio thread may still store the read position of the
+    // previous stream, so it skips to this position itself
+    s->startPos = (Uint32)SDL_AtomicGet(&s->writePos);
+    SDL_AtomicAdd(&s->generation,1);
+
+    // The fields must be visible before the state
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&s->state,STREAM_START);
+    wake_decoder();
+
+    return i;
+}
+
+
+// Fade stream
+void fade_stream(int s, float volume, int ms)
+{
+    if(s < 0 || s >= MAX_STREAMS) return;
+
+    if(volume < 0.0f) volume = 0.0f;
+    if(volume > 1.0f) volume = 1.0f;
+
+    int frames = (int)((Sint64)(ms > 0 ? ms : 0) * frequency / 1000);
+    if(frames > FADE_FRAME_MASK) frames = FADE_FRAME_MASK;
+
+    SDL_AtomicSet(&streams[s].fade,((int)(volume * 1000.0f + 0.5f) << FADE_FRAME_BITS) | frames);
+    SDL_AtomicSet(&streams[s].audible,1);
+}
+
+
+// Close stream
+void close_stream(int s, bool wait)
+{
+    if(s < 0 || s >= MAX_STREAMS) return;
+
+    STREAM* st = &streams[s];
+    int state = SDL_AtomicGet(&st->state);
+    while(state != STREAM_IDLE && state != STREAM_CLOSING
+     && !SDL_AtomicCAS(&st->state,state,STREAM_CLOSING))
+    {
+        state = SDL_AtomicGet(&st->state);
+    }
+    wake_decoder();
+
+    while(wait && decoder != NULL && SDL_AtomicGet(&st->state) != STREAM_IDLE)
+    {
+        SDL_Delay(1);
+    }
+}
+
+
+// Find stream
+int find_stream(const void* owner)
+{
+    int state;
+    int i = 0;
+    for(; i < MAX_STREAMS; ++ i)
+    {
+        state = SDL_AtomicGet(&streams[i].state);
+        if(state != STREAM_IDLE && state != STREAM_CLOSING && streams[i].owner == owner)
+            return i;
+    }
+    return -1;
+}
+
+
+// Is stream audible
+bool is_stream_audible(int s)
+{
+    if(s < 0 || s >= MAX_STREAMS) return false;
+
+    int state = SDL_AtomicGet(&streams[s].state);
+    return SDL_AtomicGet(&streams[s].audible)
+        && state != STREAM_IDLE && state != STREAM_CLOSING;
+}
+
+
+// Set stream volume
+void set_stream_volume(int vol)
+{
+    SDL_AtomicSet(&volume,vol < 0 ? 0 : (vol > MIX_MAX_VOLUME ? MIX_MAX_VOLUME : vol));
+}
+
+
+// Pause streams
+void pause_streams(bool state)
+{
+    SDL_AtomicSet(&paused,state);
+}
+
+
+// Close owner streams
+void close_owner_streams(const void* owner)
+{
+    int i = 0;
+    for(; i < MAX_STREAMS; ++ i)
+    {
+        // A closing stream may still be decoding
+        if(SDL_AtomicGet(&streams[i].state) != STREAM_IDLE && streams[i].owner == owner)
+            close_stream(i,true);
+    }
+}
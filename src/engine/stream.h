@@ -0,0 +1,75 @@
+/// Music streams (header)
+/// (c) 2018 Jani Nykänen
+///
+/// OGG files are decoded on a background thread to a ring
+/// buffer per stream, in the output format of the audio device.
+/// The streams are mixed in the music hook of SDL_mixer, where
+/// their volumes are faded frame by frame, so two streams can
+/// be crossfaded. The ring buffers are lock-free, the audio
+/// thread never waits for the decoder
+
+#ifndef __STREAM__
+#define __STREAM__
+
+#include "SDL2/SDL.h"
+
+#include "stdbool.h"
+#include "stddef.h"
+
+/// Maximum amount of streams: the playing one, the
+/// ones fading out and a prefetched one
+#define MAX_STREAMS 6
+
+/// Start the decoder thread and hook the streams to the mixer.
+/// The audio device must be open
+/// > 0 on success, 1 on error
+int init_streams();
+
+/// Unhook the streams and stop the decoder thread
+void quit_streams();
+
+/// Open a stream. Decoding starts in the background, and the
+/// stream is silent until it is faded in
+/// < data OGG file data, must stay valid until the stream is closed
+/// < size Data size
+/// < loops Times to play, -1 for forever (0 and 1 both play once)
+/// < owner Identifies the stream in find_stream
+/// > Stream index, -1 if all the streams are in use
+int open_stream(const void* data, size_t size, int loops, const void* owner);
+
+/// Fade the volume of a stream, starting from the next mixed
+/// frame. A stream that is faded to zero is closed
+/// < s Stream index
+/// < volume Target volume, 0-1
+/// < ms Fade time in milliseconds
+void fade_stream(int s, float volume, int ms);
+
+/// Close a stream
+/// < s Stream index
+/// < wait Wait until the decoder no longer reads the data
+void close_stream(int s, bool wait);
+
+/// Close all the streams of an owner, including the ones that
+/// are already closing, and wait until the data is no longer read
+/// < owner Owner
+void close_owner_streams(const void* owner);
+
+/// Find the open stream of an owner
+/// < owner Owner
+/// > Stream index, -1 if none
+int find_stream(const void* owner);
+
+/// Is a stream open and faded in (or fading)
+/// < s Stream index
+/// > True, if the stream is heard
+bool is_stream_audible(int s);
+
+/// Set the volume of all the streams
+/// < vol Volume in range 0-128
+void set_stream_volume(int vol);
+
+/// Pause or resume all the streams
+/// < state True to pause
+void pause_streams(bool state);
+
+#endif // __STREAM__
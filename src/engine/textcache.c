@@ -0,0 +1,286 @@
+/// Text run cache (source)
+/// (c) 2018 Jani Nykänen
+
+#include "textcache.h"
+
+#include "graphics.h"
+#include "assets.h"
+
+#include "stdlib.h"
+#include "string.h"
+
+// Cached text run. The bitmap of a requested
+// run is rendered before the next frame
+typedef struct
+{
+    BITMAP* font;
+    COLOR c;
+    bool borders;
+    int xoff;
+    int yoff;
+    int len;
+    Uint8 text[TEXT_CACHE_MAX_LEN];
+    BITMAP* bmp;
+    POINT origin;
+    Uint32 lastUse;
+}
+TEXT_RUN;
+
+// Runs
+static TEXT_RUN runs[TEXT_CACHE_MAX_RUNS];
+// Run count
+static int runCount = 0;
+// Runs to be rendered
+static TEXT_RUN requests[TEXT_CACHE_MAX_RUNS];
+// Request count
+static int requestCount = 0;
+// Texture memory in use
+static int memUsed = 0;
+// Use counter
+static Uint32 useCounter = 0;
+
+
+// Bitmap memory size
+static int run_size(BITMAP* b)
+{
+    return b->w * b->h * 4;
+}
+
+
+// Find a run in a list
+static TEXT_RUN* find_run(TEXT_RUN* list, int count, BITMAP* font, Uint8* text, int len, int xoff, int yoff, bool borders)
+{
+    int i = 0;
+    TEXT_RUN* r;
+    for(; i < count; ++ i)
+    {
+        r = &list[i];
+        if(r->font == font && r->len == len && r->borders == borders
+         && r->xoff == xoff && r->yoff == yoff
+         && r->c.r == font->c.r && r->c.g == font->c.g && r->c.b == font->c.b
+         && memcmp(r->text,text,len) == 0)
+        {
+            return r;
+        }
+    }
+    return NULL;
+}
+
+
+// Remove a run
+static void remove_run(int i)
+{
+    memUsed -= run_size(runs[i].bmp);
+    destroy_bitmap(runs[i].bmp);
+
+    runs[i] = runs[-- runCount];
+}
+
+
+// Remove the least recently used run
+static void evict_run()
+{
+    int i = 1;
+    int oldest = 0;
+    for(; i < runCount; ++ i)
+    {
+        if(runs[i].lastUse < runs[oldest].lastUse)
+            oldest = i;
+    }
+
+    remove_run(oldest);
+}
+
+
+// Get the area the text covers, relative to the first character
+static void measure_text(BITMAP* font, Uint8* text, int len, int xoff, int yoff, SDL_Rect* area)
+{
+    int cw = font->w / 16;
+    int ch = cw;
+    int x = 0;
+    int y = 0;
+    int minx = 0, miny = 0, maxx = 0, maxy = 0;
+    int i = 0;
+
+    for(; i < len; ++ i)
+    {
+        if(text[i] == '\n')
+        {
+            x = 0;
+            y += yoff + ch;
+            continue;
+        }
+
+        if(x < minx) minx = x;
+        if(y < miny) miny = y;
+        if(x + cw > maxx) maxx = x + cw;
+        if(y + ch > maxy) maxy = y + ch;
+
+        x += cw + xoff;
+    }
+
+    *area = (SDL_Rect){minx,miny,maxx-minx,maxy-miny};
+}
+
+
+// Render a run to a new bitmap
+static BITMAP* render_run(TEXT_RUN* r)
+{
+    BITMAP* font = r->font;
+    SDL_Rect area;
+    int pad = r->borders ? 1 : 0;
+
+    measure_text(font,r->text,r->len,r->xoff,r->yoff,&area);
+
+    BITMAP* bmp = create_target_bitmap(area.w + pad*2,area.h + pad*2);
+    if(bmp == NULL) return NULL;
+
+    r->origin.x = pad - area.x;
+    r->origin.y = pad - area.y;
+
+    POINT tr = get_translation();
+    COLOR c = font->c;
+    int x, y;
+
+    set_render_target(bmp);
+    clear_region(0,0,bmp->w,bmp->h);
+    translate(0,0);
+
+    // Borders
+    if(r->borders)
+    {
+        font->c = rgb(0,0,0);
+        for(y = -1; y <= 1; ++ y)
+        {
+            for(x = -1; x <= 1; ++ x)
+            {
+                if(x == y && x == 0) continue;
+
+                draw_text(font,r->text,r->len,r->origin.x +x,r->origin.y +y,r->xoff,r->yoff,false);
+            }
+        }
+    }
+    font->c = r->c;
+    draw_text(font,r->text,r->len,r->origin.x,r->origin.y,r->xoff,r->yoff,false);
+    font->c = c;
+
+    set_render_target(NULL);
+    translate(tr.x,tr.y);
+
+    return bmp;
+}
+
+
+// Get text run
+BITMAP* get_text_run(BITMAP* font, Uint8* text, int len, int xoff, int yoff, bool borders, POINT* origin)
+{
+    // The text may end before the given length
+    int i = 0;
+    for(; i < len && text[i] != '\0'; ++ i);
+    len = i;
+
+    if(len > TEXT_CACHE_MAX_LEN) return NULL;
+
+    // A run is not rendered before the font is loaded
+    if(font->asset != NULL && !use_asset(font->asset)) return NULL;
+
+    TEXT_RUN* r = find_run(runs,runCount,font,text,len,xoff,yoff,borders);
+    if(r != NULL)
+    {
+        r->lastUse = ++ useCounter;
+        *origin = r->origin;
+        return r->bmp;
+    }
+
+    // Changing the render target now would submit the
+    // frame drawn so far, so the run is rendered before
+    // the next frame, and drawn glyph by glyph until then
+    if(requestCount >= TEXT_CACHE_MAX_RUNS
+     || find_run(requests,requestCount,font,text,len,xoff,yoff,borders) != NULL)
+        return NULL;
+
+    SDL_Rect area;
+    int pad = borders ? 1 : 0;
+    measure_text(font,text,len,xoff,yoff,&area);
+    if(area.w <= 0 || area.h <= 0
+     || (area.w + pad*2) * (area.h + pad*2) * 4 > TEXT_CACHE_BUDGET)
+        return NULL;
+
+    r = &requests[requestCount ++];
+    r->font = font;
+    r->c = font->c;
+    r->borders = borders;
+    r->xoff = xoff;
+    r->yoff = yoff;
+    r->len = len;
+    memcpy(r->text,text,len);
+    r->bmp = NULL;
+
+    return NULL;
+}
+
+
+// Render text runs
+void render_text_runs()
+{
+    TEXT_RUN* r;
+    int size;
+    int i = 0;
+    for(; i < requestCount; ++ i)
+    {
+        r = &requests[i];
+
+        // The font may have been evicted since
+        if(r->font->asset != NULL && !use_asset(r->font->asset))
+            continue;
+
+        r->bmp = render_run(r);
+        if(r->bmp == NULL) continue;
+
+        // Make room. Nothing is drawn yet, so the
+        // evicted runs are not in use
+        size = run_size(r->bmp);
+        while(runCount > 0 && (runCount >= TEXT_CACHE_MAX_RUNS || memUsed + size > TEXT_CACHE_BUDGET))
+        {
+            evict_run();
+        }
+
+        r->lastUse = ++ useCounter;
+        runs[runCount ++] = *r;
+        memUsed += size;
+    }
+    requestCount = 0;
+}
+
+
+// Flush the runs of a font
+void flush_text_runs(BITMAP* font)
+{
+    // The last run is moved to the place of a removed one
+    int i = runCount-1;
+    for(; i >= 0; -- i)
+    {
+        if(runs[i].font == font)
+            remove_run(i);
+    }
+
+    for(i = requestCount-1; i >= 0; -- i)
+    {
+        if(requests[i].font == font)
+            requests[i] = requests[-- requestCount];
+    }
+}
+
+
+// Destroy text cache
+void destroy_text_cache()
+{
+    int i = 0;
+    for(; i < runCount; ++ i)
+    {
+        destroy_bitmap(runs[i].bmp);
+    }
+    runCount = 0;
+    memUsed = 0;
+    requestCount = 0;
+}
@@ -0,0 +1,41 @@
+/// Text run cache (header)
+/// (c) 2018 Jani Nykänen
+
+#ifndef __TEXT_CACHE__
+#define __TEXT_CACHE__
+
+#include "bitmap.h"
+#include "vector.h"
+
+/// Maximum amount of cached text runs
+#define TEXT_CACHE_MAX_RUNS 32
+/// Maximum text length of a cached run
+#define TEXT_CACHE_MAX_LEN 64
+/// Texture memory the cached runs may use, in bytes
+#define TEXT_CACHE_BUDGET (128*1024)
+
+/// Get a pre-rendered text run. A run that is not cached is
+/// rendered in the next render_text_runs
+/// < font Bitmap font
+/// < text Text
+/// < len Text length
+/// < xoff X offset
+/// < yoff Y offset
+/// < borders Draw black borders
+/// < origin Position of the first character in the run bitmap
+/// > The run bitmap, NULL if the text is not cached
+BITMAP* get_text_run(BITMAP* font, Uint8* text, int len, int xoff, int yoff, bool borders, POINT* origin);
+
+/// Render the text runs requested since the last call. Called
+/// before a frame is drawn, when no draw calls are queued
+void render_text_runs();
+
+/// Destroy the cached runs of a font. The runs are found by the font
+/// handle, which is kept when the bitmap is loaded again
+/// < font Bitmap font
+void flush_text_runs(BITMAP* font);
+
+/// Destroy all the cached runs
+void destroy_text_cache();
+
+#endif // __TEXT_CACHE__
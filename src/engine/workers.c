@@ -0,0 +1,208 @@
+/// Worker threads (source)
+/// (c) 2018 Jani Nykänen
+
+#include "workers.h"
+
+#include "stdlib.h"
+#include "stdbool.h"
+
+// Worker
+typedef struct
+{
+    JOB_BATCH* batch;
+    int id;
+}
+WORKER;
+
+// Shared job state
+struct JOB_BATCH
+{
+    JOB* jobs;
+    int count;
+    SDL_atomic_t next;
+
+    // Completion queue
+    SDL_mutex* lock;
+    SDL_cond* cond;
+    int* queue;
+    int tail;
+    // Jobs passed to the callback
+    int head;
+
+    SDL_Thread* threads[MAX_WORKERS];
+    WORKER workers[MAX_WORKERS];
+    int workerCount;
+};
+
+
+// Run a job
+static void run_job(JOB* j, int worker)
+{
+    j->worker = worker;
+    j->start = SDL_GetPerformanceCounter();
+    j->result = j->run(j->data);
+    j->end = SDL_GetPerformanceCounter();
+}
+
+
+// Worker thread
+static int worker_thread(void* data)
+{
+    WORKER* w = (WORKER*)data;
+    JOB_BATCH* s = w->batch;
+    int i;
+
+    while((i = SDL_AtomicAdd(&s->next,1)) < s->count)
+    {
+        run_job(&s->jobs[i],w->id);
+
+        SDL_LockMutex(s->lock);
+        s->queue[s->tail ++] = i;
+        SDL_CondSignal(s->cond);
+        SDL_UnlockMutex(s->lock);
+    }
+
+    return 0;
+}
+
+
+// Pass the next finished job to the callback.
+// Without workers the job is run here
+static bool handle_next(JOB_BATCH* b, bool wait, JOB_DONE done, void* param)
+{
+    int index = b->head;
+
+    if(b->workerCount > 0)
+    {
+        SDL_LockMutex(b->lock);
+        while(wait && b->tail <= b->head)
+        {
+            SDL_CondWait(b->cond,b->lock);
+        }
+        if(b->tail <= b->head)
+        {
+            SDL_UnlockMutex(b->lock);
+            return false;
+        }
+        index = b->queue[b->head];
+        SDL_UnlockMutex(b->lock);
+    }
+    else
+    {
+        run_job(&b->jobs[index],0);
+    }
+    ++ b->head;
+
+    if(done != NULL)
+        done(&b->jobs[index],param);
+
+    return true;
+}
+
+
+// Start jobs
+JOB_BATCH* start_jobs(JOB* jobs, int count)
+{
+    JOB_BATCH* b = (JOB_BATCH*)malloc(sizeof(JOB_BATCH));
+    if(b == NULL) return NULL;
+
+    b->jobs = jobs;
+    b->count = count;
+    b->tail = 0;
+    b->head = 0;
+    b->workerCount = 0;
+    SDL_AtomicSet(&b->next,0);
+    b->lock = SDL_CreateMutex();
+    b->cond = SDL_CreateCond();
+    b->queue = (int*)malloc(sizeof(int) * (count > 0 ? count : 1));
+
+    // One worker per core, the calling thread only
+    // consumes the results
+    int max = SDL_GetCPUCount();
+    if(max > MAX_WORKERS) max = MAX_WORKERS;
+    if(max > count) max = count;
+
+    if(b->lock == NULL || b->cond == NULL || b->queue == NULL)
+        return b;
+
+    int i = 0;
+    for(; i < max; ++ i)
+    {
+        b->workers[i].batch = b;
+        b->workers[i].id = i+1;
+        b->threads[i] = SDL_CreateThread(worker_thread,"worker",&b->workers[i]);
+        if(b->threads[i] == NULL) break;
+
+        ++ b->workerCount;
+    }
+
+    return b;
+}
+
+
+// Poll jobs
+int poll_jobs(JOB_BATCH* b, JOB_DONE done, void* param)
+{
+    // Without workers only one job is run at a time,
+    // so the caller is not blocked for long
+    while(b->head < b->count && handle_next(b,false,done,param)
+        && b->workerCount > 0);
+
+    return b->count - b->head;
+}
+
+
+// Finish jobs
+int finish_jobs(JOB_BATCH* b, JOB_DONE done, void* param)
+{
+    // Handle jobs in the order they complete
+    while(b->head < b->count)
+    {
+        handle_next(b,true,done,param);
+    }
+
+    int i = 0;
+    for(; i < b->workerCount; ++ i)
+    {
+        SDL_WaitThread(b->threads[i],NULL);
+    }
+
+    int workerCount = b->workerCount;
+    if(b->cond != NULL) SDL_DestroyCond(b->cond);
+    if(b->lock != NULL) SDL_DestroyMutex(b->lock);
+    free(b->queue);
+    free(b);
+
+    return workerCount;
+}
+
+
+// Run jobs
+int run_jobs(JOB* jobs, int count, JOB_DONE done, void* param)
+{
+    if(count <= 0) return 0;
+
+    JOB_BATCH* b = start_jobs(jobs,count);
+    if(b == NULL)
+    {
+        // No memory for the batch, run everything here
+        int i = 0;
+        for(; i < count; ++ i)
+        {
+            run_job(&jobs[i],0);
+            if(done != NULL)
+                done(&jobs[i],param);
+        }
+        return 0;
+    }
+
+    return finish_jobs(b,done,param);
+}
+
+
+// Get job time
+float get_job_time(JOB* job)
+{
+    return (float)((double)(job->end - job->start) * 1000.0
+        / (double)SDL_GetPerformanceFrequency());
+}
@@ -0,0 +1,72 @@
+/// Worker threads (header)
+/// (c) 2018 Jani Nykänen
+
+#ifndef __WORKERS__
+#define __WORKERS__
+
+#include "SDL2/SDL.h"
+
+/// Maximum amount of worker threads
+#define MAX_WORKERS 16
+
+/// Job function, called on a worker thread
+/// > 0 on success, 1 on error
+typedef int (*JOB_FUNC)(void* data);
+
+/// Job type
+typedef struct
+{
+    JOB_FUNC run;
+    void* data;
+    int result;
+    int worker;
+    Uint64 start;
+    Uint64 end;
+}
+JOB;
+
+/// Job completion callback, called on the calling thread
+typedef void (*JOB_DONE)(JOB* job, void* param);
+
+/// Jobs running in the background
+typedef struct JOB_BATCH JOB_BATCH;
+
+/// Run jobs on worker threads. The calling thread waits on the
+/// completion queue and passes each job to the callback as soon
+/// as it is finished, so the callback may use the renderer
+/// < jobs Jobs
+/// < count Job count
+/// < done Completion callback, may be NULL
+/// < param Parameter passed to the callback
+/// > Amount of workers used, 0 if the jobs were run on the calling thread
+int run_jobs(JOB* jobs, int count, JOB_DONE done, void* param);
+
+/// Start running jobs on worker threads and return at once.
+/// The jobs must stay valid until finish_jobs is called
+/// < jobs Jobs
+/// < count Job count
+/// > Job batch, NULL on error
+JOB_BATCH* start_jobs(JOB* jobs, int count);
+
+/// Pass the jobs finished so far to the callback, without
+/// waiting. If there are no workers, one job is run here
+/// < b Job batch
+/// < done Completion callback, may be NULL
+/// < param Parameter passed to the callback
+/// > Amount of jobs not yet passed to the callback
+int poll_jobs(JOB_BATCH* b, JOB_DONE done, void* param);
+
+/// Wait for the remaining jobs and pass them to the
+/// callback, then destroy the batch
+/// < b Job batch
+/// < done Completion callback, may be NULL
+/// < param Parameter passed to the callback
+/// > Amount of workers used, 0 if the jobs were run on the calling thread
+int finish_jobs(JOB_BATCH* b, JOB_DONE done, void* param);
+
+/// Get the time a job took
+/// < job Job
+/// > Time in milliseconds
+float get_job_time(JOB* job);
+
+#endif // __WORKERS__
@@ -3,26 +3,15 @@
 
 #include "boulder.h"
 
-#include "../engine/graphics.h"
-#include "../engine/sample.h"
-
-#include "../vpad.h"
-
 #include "stage.h"
 #include "player.h"
 #include "objects.h"
+#include "hooks.h"
 
 #include "stdio.h"
+#include "stdlib.h"
 #include "math.h"
 
-// Boulder bitmap
-static BITMAP* bmpBoulder;
-
-// Sound effects
-static SAMPLE* sThwomp;
-static SAMPLE* sTransf;
-static SAMPLE* sPush;
-
 
 // Get gravity
 static void b_get_gravity(BOULDER* b)
@@ -74,7 +63,7 @@ static void b_fall(BOULDER* b, float tm)
     if(stage_is_lava(b->x,b->y) && fabs(target-b->vpos.y) <= 16.0f)
     {
         b->changing = true;
-        play_sample(sTransf,0.50f);
+        raise_event(EVENT_TRANSFORM);
     }
 
     if(b->vpos.y < target)
@@ -92,7 +81,7 @@ static void b_fall(BOULDER* b, float tm)
             b->falling = false;
 
             if(!b->changing)
-                play_sample(sThwomp,0.60f);
+                raise_event(EVENT_THWOMP);
         }
     }
 }
@@ -128,7 +117,7 @@ static void boulder_player_collision(void* o, void* p)
         return;
     }
 
-    VEC2 stick = vpad_get_stick();
+    VEC2 stick = input_get_stick();
 
     // Push
     if(pl->canMove && !pl->bouncing && !pl->moving && !b->falling 
@@ -148,7 +137,7 @@ static void boulder_player_collision(void* o, void* p)
             pl->pushing = true;
             b->moving = true;
 
-            play_sample(sPush,0.60f);
+            raise_event(EVENT_PUSH);
         }
     }
 
@@ -193,13 +182,13 @@ static void boulder_update(void* o, float tm)
 }
 
 
-// Draw boulder
-static void boulder_draw(void* o)
+// Is the boulder idle
+static bool boulder_is_idle(void* o, void* p)
 {
     BOULDER* b = (BOULDER*)o;
-    if(b->exist == false) return;
 
-    spr_draw(&b->spr,bmpBoulder,(int)round(b->vpos.x),(int)round(b->vpos.y) +1,0);
+    return !b->exist || (!b->moving && !b->falling && !b->changing
+        && stage_is_solid(b->x,b->y+1));
 }
 
 
@@ -218,30 +207,20 @@ static void boulder_reset(void* o)
 }
 
 
-// Initialize
-void boulder_init(ASSET_PACK* ass)
-{
-    // Get asset
-    bmpBoulder = (BITMAP*)get_asset(ass,"boulder");
-    sThwomp = (SAMPLE*)get_asset(ass,"thwomp");
-    sTransf = (SAMPLE*)get_asset(ass,"transf");
-    sPush = (SAMPLE*)get_asset(ass,"push");
-}
-
-
 // Create a new boulder
 BOULDER boulder_create(int x, int y)
 {
     BOULDER b;
 
+    b.type = OBJ_BOULDER;
     b.x = x;
     b.y = y;
     b.vpos = vec2(x*16.0f,y*16.0f);
     b.spr = create_sprite(16,16);
-    b.onDraw = boulder_draw;
     b.onUpdate = boulder_update;
     b.onPlayerCollision = boulder_player_collision;
     b.onReset = boulder_reset;
+    b.onIsIdle = boulder_is_idle;
     b.exist = true;
     b.moving = false;
     b.falling = false;
@@ -5,7 +5,6 @@
 #define __BOULDER__
 
 #include "../engine/sprite.h"
-#include "../engine/assets.h"
 
 #include "obase.h"
 
@@ -23,10 +22,6 @@ EXTENDS_GAME_OBJECT
 
 AS ( BOULDER );
 
-/// Initialize boulders
-/// < ass Assets
-void boulder_init(ASSET_PACK* ass);
-
 /// Create a new boulder
 /// < x X coordinate (in grid)
 /// < y Y coordinate (in grid)
@@ -5,7 +5,6 @@
 #define __COIN__
 
 #include "../engine/sprite.h"
-#include "../engine/assets.h"
 
 #include "obase.h"
 
@@ -15,14 +14,10 @@ EXTENDS_GAME_OBJECT
     // Member variables
     float floatTimer;
     bool dying;
-    int type;
+    int coinType;
 
 AS ( COIN );
 
-/// Initialize coins
-/// < ass Assets
-void coin_init(ASSET_PACK* ass);
-
 /// Create a new coin
 /// < x X coordinate (in grid)
 /// < y Y coordinate (in grid)
@@ -3,13 +3,8 @@
 
 #include "enemy.h"
 
-#include "../engine/graphics.h"
-
-#include "../vpad.h"
-
 #include "stage.h"
 #include "player.h"
-#include "status.h"
 
 #include "stdio.h"
 #include "math.h"
@@ -17,10 +12,6 @@
 // Global enemy constants
 static float ENEMY_SPEED_DEFAULT = 0.80f;
 
-// Enemy bitmap
-static BITMAP* bmpEnemy;
-
-
 
 // Get gravity
 static void enemy_get_gravity(ENEMY* e)
@@ -262,14 +253,16 @@ static void enemy_update(void* o, float tm)
 }
 
 
-// Draw enemy
-static void enemy_draw(void* o)
+// Is the enemy idle
+static bool enemy_is_idle(void* o, void* p)
 {
+    PLAYER* pl = (PLAYER*)p;
     ENEMY* e = (ENEMY*)o;
-    if(e->exist == false) return;
 
-    spr_draw(&e->spr,bmpEnemy,e->vpos.x-4,e->vpos.y-4 +1,e->sprDir);
-    
+    if(!e->exist) return true;
+
+    return !e->moving && !e->falling && !pl->startedMoving
+        && !((e->id == 0 || e->id == 1) && !stage_is_solid(e->x,e->y+1));
 }
 
 
@@ -285,28 +278,22 @@ static void enemy_reset(void* o)
 }
 
 
-// Initialize
-void enemy_init(ASSET_PACK* ass)
-{
-    bmpEnemy = (BITMAP*)get_asset(ass,"enemy");
-}
-
-
 // Create a new enemy
 ENEMY enemy_create(int x, int y, int id)
 {
     ENEMY b;
 
+    b.type = OBJ_ENEMY;
     b.x = x;
     b.y = y;
     b.id = id;
     b.vpos = vec2(x*16.0f,y*16.0f);
     b.spr = create_sprite(24,24);
     b.spr.row = id;
-    b.onDraw = enemy_draw;
     b.onUpdate = enemy_update;
     b.onPlayerCollision = enemy_player_collision;
     b.onReset = enemy_reset;
+    b.onIsIdle = enemy_is_idle;
     b.exist = true;
     b.preventMovement = false;
     b.moving = false;
@@ -5,7 +5,6 @@
 #define __ENEMY__
 
 #include "../engine/sprite.h"
-#include "../engine/assets.h"
 
 #include "obase.h"
 
@@ -24,10 +23,6 @@ EXTENDS_GAME_OBJECT
 
 AS ( ENEMY );
 
-/// Initialize enemies
-/// < ass Assets
-void enemy_init(ASSET_PACK* ass);
-
 /// Create a new enemy
 /// < x X coordinate (in grid)
 /// < y Y coordinate (in grid)
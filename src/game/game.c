@@ -10,20 +10,29 @@
 #include "../engine/assets.h"
 #include "../engine/music.h"
 #include "../engine/sample.h"
+#include "../engine/hotreload.h"
 
 #include "../vpad.h"
 #include "../global.h"
 #include "../transition.h"
+#include "../asset_ids.h"
 
 #include "../menu/menu.h"
 
 #include "stage.h"
+#include "stagedraw.h"
 #include "objects.h"
+#include "objdraw.h"
+#include "progress.h"
 #include "status.h"
 #include "pause.h"
+#include "tiles.h"
+#include "hooks.h"
+#include "undo.h"
 
 #include "stdio.h"
 #include "stdlib.h"
+#include "string.h"
 #include "math.h"
 #include "time.h"
 
@@ -35,6 +44,14 @@ static MUSIC* mFinal;
 // Sound effects
 static SAMPLE* sPause;
 static SAMPLE* sRestart;
+static SAMPLE* sJump;
+static SAMPLE* sDie;
+static SAMPLE* sPush;
+static SAMPLE* sThwomp;
+static SAMPLE* sTransf;
+static SAMPLE* sKey;
+static SAMPLE* sOpen;
+static SAMPLE* sCoin;
 
 // Bitmaps
 static BITMAP* bmpHelp;
@@ -46,6 +63,42 @@ static float helpPos;
 // Help screen phase
 static int helpPhase;
 
+// Assets preloaded when the scene starts
+static const int GAME_ASSETS[] = {
+    ASSET_ID_PLAYER, ASSET_ID_TILES1, ASSET_ID_SKY1, ASSET_ID_SKY3, ASSET_ID_CLOUDS1,
+    ASSET_ID_CLOUDS2, ASSET_ID_BOULDER, ASSET_ID_KEY, ASSET_ID_STAR, ASSET_ID_LOCK,
+    ASSET_ID_COMPL, ASSET_ID_ENEMY, ASSET_ID_BIG_STAR, ASSET_ID_COIN, ASSET_ID_ELECTRICITY,
+    ASSET_ID_HELP, ASSET_ID_THEME, ASSET_ID_FINAL, ASSET_ID_CLEAR, ASSET_ID_JUMP,
+    ASSET_ID_DIE, ASSET_ID_THWOMP, ASSET_ID_TRANSF, ASSET_ID_GET_KEY, ASSET_ID_OPEN_LOCK,
+    ASSET_ID_PUSH, ASSET_ID_RESTART, ASSET_ID_GET_COIN,
+};
+
+// Stage preparation states
+enum
+{
+    PREPARE_NONE = 0,
+    PREPARE_LOADING = 1,
+    PREPARE_READY = 2,
+};
+
+// Stage being prepared
+static STAGE_INFO nextStage;
+// Stage preparation state
+static int prepareState;
+// Scene assets and the stage being prepared
+static int prepareSet[sizeof(GAME_ASSETS) / sizeof(int) + 1];
+
+
+// Get the virtual pad button state
+static int get_vpad_button(int id)
+{
+    return vpad_get_button((Uint8)id);
+}
+
+
+// The game is controlled with the virtual pad
+static const GAME_INPUT VPAD_INPUT = {vpad_get_stick, get_vpad_button};
+
 
 // Draw the help screen
 static void draw_help()
@@ -87,13 +140,110 @@ static void update_help(float tm)
 }
 
 
+// Reset game components
+static void reset_components()
+{
+    stage_reset(true);
+    progress_reset();
+    status_reset(true);
+    obj_reset();
+    undo_reset();
+}
+
+
+// Play the music of the stage
+static void play_stage_music()
+{
+    play_music(status_get_if_final() ? mFinal : mTheme,0.70f,-1);
+}
+
+
+// Play the sounds & effects of the game events
+static void on_game_event(int event)
+{
+    switch(event)
+    {
+    case EVENT_JUMP:
+        play_sample(sJump,0.40f);
+        break;
+    case EVENT_DYING:
+        fade_out_music(500);
+        break;
+    case EVENT_DIE:
+        stage_set_shake_timer(60.0f);
+        play_sample(sDie,0.40f);
+        break;
+    case EVENT_DEAD:
+        trn_set(FADE_IN,BLACK_VERTICAL,1.0f,game_reset);
+        break;
+    case EVENT_PUSH:
+        play_sample(sPush,0.60f);
+        break;
+    case EVENT_THWOMP:
+        play_sample(sThwomp,0.60f);
+        break;
+    case EVENT_TRANSFORM:
+        play_sample(sTransf,0.50f);
+        break;
+    case EVENT_KEY:
+        play_sample(sKey,0.50f);
+        break;
+    case EVENT_LOCK:
+        play_sample(sOpen,0.60f);
+        break;
+    case EVENT_COIN:
+        play_sample(sCoin,0.50f);
+        break;
+    case EVENT_VICTORY:
+        status_activate_victory();
+        break;
+    default:
+        break;
+    }
+}
+
+
+// Set the stage and create its objects
+static void set_stage(STAGE_INFO info)
+{
+    // Clear objects
+    obj_clear();
+
+    // Set map
+    stage_set_main_stage(info.assetName);
+
+    // Set stage name
+    status_set_stage_name(info.name);
+    // Set stage turn target
+    status_set_turn_target(info.turnCount);
+
+    // Create objects
+    stage_reset(false);
+
+    // Reset
+    reset_components();
+}
+
+
+// Restart the stage if its file was reloaded
+static void on_asset_reload(int id)
+{
+    if(!stage_on_reload(id)) return;
+
+    obj_clear();
+    stage_reset(false);
+    reset_components();
+}
+
+
 // Init game
 static int game_init()
 {
     ASSET_PACK* ass = get_global_assets();
 
     // Initialize game components
-    obj_init(ass);
+    obj_init();
+    obj_draw_init(ass);
     stage_init(ass);
     status_init(ass);
     pause_init(ass);
@@ -104,6 +254,14 @@ static int game_init()
 
     sPause = (SAMPLE*)get_asset(ass,"pause");
     sRestart = (SAMPLE*)get_asset(ass,"restart");
+    sJump = (SAMPLE*)get_asset(ass,"jump");
+    sDie = (SAMPLE*)get_asset(ass,"die");
+    sPush = (SAMPLE*)get_asset(ass,"push");
+    sThwomp = (SAMPLE*)get_asset(ass,"thwomp");
+    sTransf = (SAMPLE*)get_asset(ass,"transf");
+    sKey = (SAMPLE*)get_asset(ass,"getKey");
+    sOpen = (SAMPLE*)get_asset(ass,"openLock");
+    sCoin = (SAMPLE*)get_asset(ass,"getCoin");
 
     bmpHelp = (BITMAP*)get_asset(ass,"help");
 
@@ -111,6 +269,18 @@ static int game_init()
     helpShown = false;
     helpPos = -bmpHelp->w/2;
     helpPhase = 0;
+    prepareState = PREPARE_NONE;
+    progress_reset();
+
+    // The rules read the virtual pad, and their
+    // events are heard and seen here
+    set_game_input(&VPAD_INPUT);
+    set_event_callback(on_game_event);
+
+    // Stages are compiled from their maps
+    // in the development mode
+    watch_stage_sources("assets/maps/",is_spawn_tile);
+    set_reload_callback(on_asset_reload);
 
     return 0;
 }
@@ -142,6 +312,32 @@ static void game_update(float tm)
     obj_update(tm);
     status_update(tm);
 
+    // Record the turns once they have settled. Only
+    // then can they be taken back and again. There is
+    // no undo sample, so the pause sound is played
+    if(obj_get_player()->dying)
+    {
+        // The fatal turn was never recorded, but it can
+        // be taken back before the stage is reset
+        if(vpad_get_button(4) == PRESSED)
+        {
+            undo_discard();
+            stage_set_shake_timer(0.0f);
+            play_sample(sPause,0.30f);
+            play_stage_music();
+        }
+    }
+    else if(obj_have_settled() && !status_is_victory())
+    {
+        undo_record();
+
+        if((vpad_get_button(4) == PRESSED && undo_step_back())
+         || (vpad_get_button(5) == PRESSED && undo_step_forward()))
+        {
+            play_sample(sPause,0.30f);
+        }
+    }
+
     // Reset if the reset button is pressed
     if(vpad_get_button(2) == PRESSED)
     {
@@ -162,9 +358,11 @@ static void game_update(float tm)
 static void game_draw()
 {
     // Draw game components
+    set_draw_layer(LAYER_STAGE,false);
     stage_draw();
     obj_draw();
     status_draw();
+    set_draw_layer(LAYER_PAUSE,false);
     pause_draw();
 
     // Draw help
@@ -186,7 +384,17 @@ static void game_destroy()
 // Scene swapped
 static void game_on_swap()
 {
+    preload_asset_set(get_global_assets(),GAME_ASSETS,sizeof(GAME_ASSETS) / sizeof(int));
+
     pause_disable();
+
+    // A prepared stage is already reset
+    if(prepareState == PREPARE_READY)
+    {
+        prepareState = PREPARE_NONE;
+        play_stage_music();
+        return;
+    }
     game_reset();
 }
 
@@ -194,22 +402,37 @@ static void game_on_swap()
 // Set stage
 void game_set_stage(STAGE_INFO info)
 {
-    // Clear objects
-    obj_clear();
+    prepareState = PREPARE_NONE;
+    set_stage(info);
+}
 
-    // Set map
-    stage_set_main_stage(info.assetName);
 
-    // Set stage name
-    status_set_stage_name(info.name);
-    // Set stage turn target
-    status_set_turn_target(info.turnCount);
+// Prepare stage
+void game_prepare_stage(STAGE_INFO info)
+{
+    ASSET_PACK* ass = get_global_assets();
+    int count = sizeof(GAME_ASSETS) / sizeof(int);
 
-    // Create objects
-    stage_reset(false);
+    // The stage is loaded with the scene assets
+    memcpy(prepareSet,GAME_ASSETS,sizeof(GAME_ASSETS));
+    prepareSet[count] = get_asset_id(ass,info.assetName);
+    preload_asset_set_async(ass,prepareSet,count +1);
 
-    // Reset
-    game_reset();
+    nextStage = info;
+    prepareState = PREPARE_LOADING;
+}
+
+
+// Is the stage prepared
+bool game_is_stage_prepared()
+{
+    // The objects are created once the assets are loaded
+    if(prepareState == PREPARE_LOADING && !is_asset_set_loading(get_global_assets()))
+    {
+        set_stage(nextStage);
+        prepareState = PREPARE_READY;
+    }
+    return prepareState == PREPARE_READY;
 }
 
 
@@ -217,12 +440,10 @@ void game_set_stage(STAGE_INFO info)
 void game_reset()
 {
     // Reset components
-    stage_reset(true);
-    status_reset(true);
-    obj_reset();
+    reset_components();
 
     // Reset music
-    play_music(status_get_if_final() ? mFinal : mTheme,0.70f,-1);
+    play_stage_music();
 }
 
 
@@ -237,7 +458,7 @@ void swap_to_stage_menu()
 SCENE get_game_scene()
 {
     // Set scene functions
-    SCENE s = (SCENE){game_init,game_update,game_draw,game_destroy,game_on_swap};
+    SCENE s = (SCENE){game_init,game_update,game_draw,game_destroy,game_on_swap,stage_update_layer};
 
     // Set scene name
     set_scene_name(&s,"game");
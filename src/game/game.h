@@ -8,10 +8,33 @@
 
 #include "../menu/info.h"
 
+#include "stdbool.h"
+
+/// Draw layers of the game scene
+enum
+{
+    LAYER_STAGE = 0,
+    LAYER_OBJECTS = 1,
+    LAYER_PLAYER = 2,
+    LAYER_HUD = 3,
+    LAYER_PAUSE = 4,
+};
+
 /// Set game stage
 /// < info Stage info
 void game_set_stage(STAGE_INFO info);
 
+/// Start preparing a stage in the background, while
+/// the previous scene is still shown
+/// < info Stage info
+void game_prepare_stage(STAGE_INFO info);
+
+/// Check the stage preparation. The stage is set once its
+/// assets are loaded, and only the music is started when
+/// the scene is swapped
+/// > True, if the stage is ready
+bool game_is_stage_prepared();
+
 /// Reset game
 void game_reset();
 
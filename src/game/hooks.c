@@ -0,0 +1,85 @@
+/// Game hooks (source)
+/// (c) 2018 Jani Nykänen
+
+#include "hooks.h"
+
+#include "../engine/controls.h"
+
+#include "stdlib.h"
+
+// Input source
+static RULE_STATE const GAME_INPUT* input = NULL;
+// Event callback
+static RULE_STATE EVENT_CALLBACK onEvent = NULL;
+// Is a dry run going on
+static RULE_STATE bool dryRun = false;
+// Changes counted in the dry run
+static RULE_STATE int dryChanges = 0;
+
+
+// Set input
+void set_game_input(const GAME_INPUT* in)
+{
+    input = in;
+}
+
+
+// Set event callback
+void set_event_callback(EVENT_CALLBACK cb)
+{
+    onEvent = cb;
+}
+
+
+// Get stick
+VEC2 input_get_stick()
+{
+    if(input == NULL) return vec2(0.0f,0.0f);
+
+    return input->get_stick();
+}
+
+
+// Get button
+int input_get_button(int id)
+{
+    if(input == NULL) return UP;
+
+    return input->get_button(id);
+}
+
+
+// Raise event
+void raise_event(int event)
+{
+    if(dry_run_change()) return;
+
+    if(onEvent != NULL)
+        onEvent(event);
+}
+
+
+// Set dry run
+void set_dry_run(bool state)
+{
+    dryRun = state;
+    if(state)
+        dryChanges = 0;
+}
+
+
+// Count a dry run change
+bool dry_run_change()
+{
+    if(!dryRun) return false;
+
+    ++ dryChanges;
+    return true;
+}
+
+
+// Get dry run changes
+int get_dry_run_changes()
+{
+    return dryChanges;
+}
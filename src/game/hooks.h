@@ -0,0 +1,83 @@
+/// Game hooks (header)
+/// (c) 2018 Jani Nykänen
+///
+/// The game rules read the input and report their sound
+/// and visual effects through these hooks, so that they can
+/// be run without a window, e.g. by the headless simulation
+
+#ifndef __GAME_HOOKS__
+#define __GAME_HOOKS__
+
+#include "../engine/vector.h"
+
+#include "stdbool.h"
+
+/// Storage class of the rule state. Each thread has a state of
+/// its own, so that several simulations can run at the same time
+#define RULE_STATE _Thread_local
+
+/// Game events, raised by the rules
+enum
+{
+    EVENT_JUMP = 0, /// The player jumped
+    EVENT_DYING = 1, /// The player was hurt
+    EVENT_DIE = 2, /// The death animation reached its peak
+    EVENT_DEAD = 3, /// The death animation ended
+    EVENT_PUSH = 4, /// A boulder was pushed
+    EVENT_THWOMP = 5, /// A boulder landed
+    EVENT_TRANSFORM = 6, /// A boulder fell to lava
+    EVENT_KEY = 7, /// A key was picked up
+    EVENT_LOCK = 8, /// A lock was opened
+    EVENT_COIN = 9, /// A coin was picked up
+    EVENT_VICTORY = 10, /// The star was reached
+};
+
+/// Input source
+typedef struct
+{
+    VEC2 (*get_stick) (); /// Stick position, components in range -1-1
+    int (*get_button) (int id); /// Button state, see STATE in controls.h
+}
+GAME_INPUT;
+
+/// Event callback
+typedef void (*EVENT_CALLBACK)(int event);
+
+/// Set the input source
+/// < input Input source, NULL for no input. Must stay valid
+void set_game_input(const GAME_INPUT* input);
+
+/// Set the event callback
+/// < cb Callback, may be NULL
+void set_event_callback(EVENT_CALLBACK cb);
+
+/// Get the stick position
+/// > Stick position, zero if there is no input
+VEC2 input_get_stick();
+
+/// Get a button state
+/// < id Button index
+/// > Button state, UP if there is no input
+int input_get_button(int id);
+
+/// Raise a game event. In a dry run the event is only counted
+/// < event Event
+void raise_event(int event);
+
+/// Start or stop a dry run. In a dry run the rules may be
+/// updated on copies of the objects to see what they would do:
+/// the stage and the progress are not changed, and the changes
+/// and events are counted instead
+/// < state True to start, false to stop
+void set_dry_run(bool state);
+
+/// Count a change in a dry run. Called by the functions that change
+/// the stage or the progress, before they change anything
+/// > True, if in a dry run and the change must not be made
+bool dry_run_change();
+
+/// Get the amount of changes and events counted in the last dry run
+/// > Change count
+int get_dry_run_changes();
+
+#endif // __GAME_HOOKS__
@@ -3,22 +3,14 @@
 
 #include "key.h"
 
-#include "../engine/graphics.h"
-#include "../engine/sample.h"
-
 #include "player.h"
-#include "status.h"
+#include "progress.h"
+#include "hooks.h"
 
 #include "stdio.h"
 #include "stdlib.h"
 #include "math.h"
 
-// Key bitmap
-static BITMAP* bmpKey;
-
-// Sound effects
-static SAMPLE* sKey;
-
 
 // Key-player collision
 static void key_player_collision(void* o, void* p)
@@ -34,7 +26,7 @@ static void key_player_collision(void* o, void* p)
     {
         k->flying = true;
         k->preventMovement = true;
-        play_sample(sKey,0.50f);
+        raise_event(EVENT_KEY);
     }
 }
 
@@ -45,7 +37,7 @@ static void key_fly(KEY* k, float tm)
     const float ACC = 0.4f;
     const float MAX_SPEED = 6.0f;
 
-    float targetX = 2.0f + status_get_key_count()*13.0f;
+    float targetX = 2.0f + progress_get_key_count()*13.0f;
     float targetY = 4.0f;
 
     k->spr.frame = 0;
@@ -68,7 +60,7 @@ static void key_fly(KEY* k, float tm)
     if(hypot(targetX-k->vpos.x,targetY-k->vpos.y) < 1.0f+k->speedMul)
     {
         k->exist = false;
-        status_add_key();
+        progress_add_key();
     }
 }
 
@@ -99,14 +91,16 @@ static void key_update(void* o, float tm)
 }
 
 
-// Draw key
-static void key_draw(void* o)
+// Is the key idle
+static bool key_is_idle(void* o, void* p)
 {
+    const float DIST = 8.0f;
+
+    PLAYER* pl = (PLAYER*)p;
     KEY* k = (KEY*)o;
-    if(!k->exist) return;
 
-    spr_draw(&k->spr,bmpKey,
-        (int)round(k->vpos.x),(int)round(k->vpos.y + sin(k->floatTimer)),0);
+    return !k->exist || (!k->flying
+        && !(fabs(pl->vpos.x-k->vpos.x) < DIST && fabs(pl->vpos.y-k->vpos.y) < DIST));
 }
 
 
@@ -119,28 +113,20 @@ static void key_reset(void* o)
 }
 
 
-// Initialize
-void key_init(ASSET_PACK* ass)
-{
-    // Get assets
-    bmpKey = (BITMAP*)get_asset(ass,"key");
-    sKey = (SAMPLE*)get_asset(ass,"getKey");
-}
-
-
 // Create a new key
 KEY key_create(int x, int y)
 {
     KEY k;
 
+    k.type = OBJ_KEY;
     k.x = x;
     k.y = y;
     k.vpos = vec2(x*16.0f,y*16.0f);
     k.spr = create_sprite(16,16);
-    k.onDraw = key_draw;
     k.onUpdate = key_update;
     k.onPlayerCollision = key_player_collision;
     k.onReset = key_reset;
+    k.onIsIdle = key_is_idle;
     k.exist = true;
     k.flying = false;
     k.preventMovement = false;
@@ -5,7 +5,6 @@
 #define __KEY__
 
 #include "../engine/sprite.h"
-#include "../engine/assets.h"
 
 #include "obase.h"
 
@@ -19,10 +18,6 @@ EXTENDS_GAME_OBJECT
 
 AS ( KEY );
 
-/// Initialize keys
-/// < ass Assets
-void key_init(ASSET_PACK* ass);
-
 /// Create a new key
 /// < x X coordinate (in grid)
 /// < y Y coordinate (in grid)
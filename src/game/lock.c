@@ -3,24 +3,15 @@
 
 #include "lock.h"
 
-#include "../engine/graphics.h"
-#include "../engine/sample.h"
-
-#include "../vpad.h"
-
 #include "stage.h"
 #include "player.h"
-#include "status.h"
+#include "progress.h"
+#include "hooks.h"
 
 #include "stdio.h"
+#include "stdlib.h"
 #include "math.h"
 
-// Lock bitmap
-static BITMAP* bmpLock;
-
-// Sound effects
-static SAMPLE* sOpen;
-
 
 // Update lock location to collision map
 static void lock_update_location(LOCK* lock)
@@ -40,19 +31,19 @@ static void lock_player_collision(void* o, void* p)
 
     if(lock->opening || !lock->exist) return;
    
-    VEC2 stick = vpad_get_stick();
+    VEC2 stick = input_get_stick();
 
     if(!pl->moving && pl->y == lock->y && abs(pl->x-lock->x) == 1 
        && fabs(stick.x) > DELTA)
     {
-        if(status_get_key_count() > 0)
+        if(progress_get_key_count() > 0)
         {
-            status_remove_key();
+            progress_remove_key();
             lock->opening = true;
             lock->preventMovement = true; 
             stage_set_tile(lock->x,lock->y,0);
 
-            play_sample(sOpen,0.60f);
+            raise_event(EVENT_LOCK);
         }
     }
 }
@@ -81,16 +72,13 @@ static void lock_update(void* o, float tm)
 }
 
 
-// Draw lock
-static void lock_draw(void* o)
+// Is the lock idle. It is opened
+// only when the stick is pushed
+static bool lock_is_idle(void* o, void* p)
 {
     LOCK* lock = (LOCK*)o;
-    if(lock->exist == false) return;
 
-    if(lock->opening)
-    {
-        spr_draw(&lock->spr,bmpLock,lock->vpos.x,lock->vpos.y,0);
-    }
+    return !lock->exist || !lock->opening;
 }
 
 
@@ -104,28 +92,20 @@ static void lock_reset(void* o)
 }
 
 
-// Initialize
-void lock_init(ASSET_PACK* ass)
-{
-    // Get assets
-    bmpLock = (BITMAP*)get_asset(ass,"lock");
-    sOpen = (SAMPLE*)get_asset(ass,"openLock");
-}
-
-
 // Create a new lock
 LOCK lock_create(int x, int y)
 {
     LOCK b;
 
+    b.type = OBJ_LOCK;
     b.x = x;
     b.y = y;
     b.vpos = vec2(x*16.0f,y*16.0f);
     b.spr = create_sprite(16,16);
-    b.onDraw = lock_draw;
     b.onUpdate = lock_update;
     b.onPlayerCollision = lock_player_collision;
     b.onReset = lock_reset;
+    b.onIsIdle = lock_is_idle;
     b.exist = true;
     b.opening = false;
     b.preventMovement = false;
@@ -5,7 +5,6 @@
 #define __LOCK__
 
 #include "../engine/sprite.h"
-#include "../engine/assets.h"
 
 #include "obase.h"
 
@@ -17,10 +16,6 @@ EXTENDS_GAME_OBJECT
 
 AS ( LOCK );
 
-/// Initialize locks
-/// < ass Assets
-void lock_init(ASSET_PACK* ass);
-
 /// Create a new lock
 /// < x X coordinate (in grid)
 /// < y Y coordinate (in grid)
@@ -3,6 +3,8 @@
 
 #include "obase.h"
 
+#include "stdlib.h"
+
 
 // Update object
 void object_update(OBJECT* o, float tm)
@@ -22,15 +24,6 @@ void object_player_collision(OBJECT* o, OBJECT* p)
 }
 
 
-// Draw object
-void object_draw(OBJECT* o)
-{
-    if(o == NULL || o->onDraw == NULL) return;
-
-    o->onDraw((void*)o);
-}
-
-
 // Reset
 void object_reset(OBJECT* o)
 {
@@ -38,10 +31,21 @@ void object_reset(OBJECT* o)
     o->y = o->startPos.y;
     o->vpos.x = o->x * 16.0f;
     o->vpos.y = o->y * 16.0f;
+    o->prevPos = o->vpos;
     o->exist = true;
 
     if(o->onReset != NULL)
     {
         o->onReset(o);
     }
+}
+
+
+// Is idle
+bool object_is_idle(OBJECT* o, OBJECT* p)
+{
+    // The update clears the movement prevention
+    if(o->onIsIdle == NULL || o->preventMovement) return false;
+
+    return o->onIsIdle((void*)o,(void*)p);
 }
\ No newline at end of file
@@ -9,19 +9,33 @@
 
 #include "stdbool.h"
 
+/// Object types
+enum
+{
+    OBJ_PLAYER = 0,
+    OBJ_BOULDER = 1,
+    OBJ_KEY = 2,
+    OBJ_STAR = 3,
+    OBJ_LOCK = 4,
+    OBJ_ENEMY = 5,
+    OBJ_COIN = 6,
+};
+
 #define EXTENDS_GAME_OBJECT typedef struct\
 {\
+int type;\
 int x;\
 int y;\
 POINT startPos;\
 VEC2 vpos;\
+VEC2 prevPos;\
 SPRITE spr;\
 bool exist;\
 bool preventMovement;\
 void (*onUpdate) (void*,float);\
-void (*onDraw) (void*);\
 void (*onPlayerCollision)(void*,void*);\
 void (*onReset)(void*);\
+bool (*onIsIdle)(void*,void*);\
 
 #define AS(name) }name;
 
@@ -37,12 +51,15 @@ void object_update(OBJECT* o, float tm);
 /// < p Player
 void object_player_collision(OBJECT* o, OBJECT* p);
 
-/// Draw object
-/// < o Object
-void object_draw(OBJECT* o);
-
 /// Reset object
 /// < o Object to reset
 void object_reset(OBJECT* o);
 
+/// Is the object idle: updating it in the next frame
+/// would change nothing but its animation
+/// < o Object
+/// < p Player
+/// > True, if idle
+bool object_is_idle(OBJECT* o, OBJECT* p);
+
 #endif // __GOBJ_BASE__
\ No newline at end of file
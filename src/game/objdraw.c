@@ -0,0 +1,153 @@
+/// Object drawing (source)
+/// (c) 2018 Jani Nykänen
+
+#include "objdraw.h"
+
+#include "../engine/graphics.h"
+#include "../engine/app.h"
+
+#include "objects.h"
+#include "boulder.h"
+#include "key.h"
+#include "star.h"
+#include "lock.h"
+#include "enemy.h"
+#include "coin.h"
+#include "status.h"
+#include "game.h"
+
+#include "math.h"
+
+// Bitmaps
+static BITMAP* bmpPlayer;
+static BITMAP* bmpBoulder;
+static BITMAP* bmpEnemy;
+static BITMAP* bmpKey;
+static BITMAP* bmpLock;
+static BITMAP* bmpCoin;
+static BITMAP* bmpStar;
+
+
+// Get the position to draw an object in, interpolated
+// between the last two updates
+static VEC2 get_draw_pos(OBJECT* o)
+{
+    float t = app_get_interpolation();
+
+    return vec2(o->prevPos.x + (o->vpos.x-o->prevPos.x) * t,
+        o->prevPos.y + (o->vpos.y-o->prevPos.y) * t);
+}
+
+
+// Draw player
+static void pl_draw(PLAYER* pl)
+{
+    VEC2 p = get_draw_pos((OBJECT*)pl);
+    spr_draw(&pl->spr,bmpPlayer,(int)round(p.x) - 4,(int)round(p.y) -4 + 1,pl->dir);
+}
+
+
+// Draw boulder
+static void boulder_draw(BOULDER* b)
+{
+    if(b->exist == false) return;
+
+    VEC2 p = get_draw_pos((OBJECT*)b);
+    spr_draw(&b->spr,bmpBoulder,(int)round(p.x),(int)round(p.y) +1,0);
+}
+
+
+// Draw enemy
+static void enemy_draw(ENEMY* e)
+{
+    if(e->exist == false) return;
+
+    VEC2 p = get_draw_pos((OBJECT*)e);
+    spr_draw(&e->spr,bmpEnemy,p.x-4,p.y-4 +1,e->sprDir);
+}
+
+
+// Draw key
+static void key_draw(KEY* k)
+{
+    if(!k->exist) return;
+
+    VEC2 p = get_draw_pos((OBJECT*)k);
+    spr_draw(&k->spr,bmpKey,
+        (int)round(p.x),(int)round(p.y + sin(k->floatTimer)),0);
+}
+
+
+// Draw lock
+static void lock_draw(LOCK* lock)
+{
+    if(lock->exist == false) return;
+
+    if(lock->opening)
+    {
+        spr_draw(&lock->spr,bmpLock,lock->vpos.x,lock->vpos.y,0);
+    }
+}
+
+
+// Draw coin
+static void coin_draw(COIN* c)
+{
+    if(!c->exist) return;
+
+    spr_draw(&c->spr,bmpCoin,
+        (int)round(c->vpos.x),(int)round(c->vpos.y + sin(c->floatTimer)),0);
+}
+
+
+// Draw star
+static void star_draw(STAR* s)
+{
+    // The row tells if the turn target was reached
+    spr_draw_frame(&s->spr,bmpStar,s->spr.frame,status_star_type(),
+        (int)round(s->vpos.x),(int)round(s->vpos.y + cos(s->floatTimer)),0);
+}
+
+
+// Initialize object drawing
+void obj_draw_init(ASSET_PACK* ass)
+{
+    // Get assets
+    bmpPlayer = (BITMAP*)get_asset(ass,"player");
+    bmpBoulder = (BITMAP*)get_asset(ass,"boulder");
+    bmpEnemy = (BITMAP*)get_asset(ass,"enemy");
+    bmpKey = (BITMAP*)get_asset(ass,"key");
+    bmpLock = (BITMAP*)get_asset(ass,"lock");
+    bmpCoin = (BITMAP*)get_asset(ass,"coin");
+    bmpStar = (BITMAP*)get_asset(ass,"star");
+}
+
+
+// Draw objects
+void obj_draw()
+{
+    // Draw game objects. A moving object overlaps
+    // the others, so the drawing order is kept
+    set_draw_layer(LAYER_OBJECTS,false);
+
+    OBJECT* o;
+    int i = 0;
+    for(; i < obj_count(); ++ i)
+    {
+        o = obj_get(i);
+        switch(o->type)
+        {
+        case OBJ_BOULDER: boulder_draw((BOULDER*)o); break;
+        case OBJ_ENEMY: enemy_draw((ENEMY*)o); break;
+        case OBJ_KEY: key_draw((KEY*)o); break;
+        case OBJ_LOCK: lock_draw((LOCK*)o); break;
+        case OBJ_COIN: coin_draw((COIN*)o); break;
+        case OBJ_STAR: star_draw((STAR*)o); break;
+        default: break;
+        }
+    }
+
+    // Draw player
+    set_draw_layer(LAYER_PLAYER,false);
+    pl_draw(obj_get_player());
+}
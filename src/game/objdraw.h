@@ -0,0 +1,18 @@
+/// Object drawing (header)
+/// (c) 2018 Jani Nykänen
+///
+/// Draws the objects of the rules in objects.h
+
+#ifndef __OBJECT_DRAW__
+#define __OBJECT_DRAW__
+
+#include "../engine/assets.h"
+
+/// Initialize object drawing
+/// < ass Asset pack
+void obj_draw_init(ASSET_PACK* ass);
+
+/// Draw objects
+void obj_draw();
+
+#endif // __OBJECT_DRAW__
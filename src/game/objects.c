@@ -3,31 +3,110 @@
 
 #include "objects.h"
 
-#include "../engine/graphics.h"
-#include "../engine/app.h"
-
 #include "boulder.h"
 #include "key.h"
 #include "star.h"
-#include "player.h"
 #include "lock.h"
 #include "enemy.h"
 #include "coin.h"
 #include "stage.h"
+#include "hooks.h"
+#include "zobrist.h"
+
+#include "stdio.h"
+#include "string.h"
 
-// Max amount of objects
-#define MAX_OBJ 64
+// Storage for any type of object
+typedef union
+{
+    OBJECT base;
+    BOULDER boulder;
+    KEY key;
+    STAR star;
+    LOCK lock;
+    ENEMY enemy;
+    COIN coin;
+}
+OBJECT_SLOT;
 
-// Objects
-static OBJECT* objects[MAX_OBJ];
+// Objects, stored in place so that loading
+// a stage allocates nothing
+static RULE_STATE OBJECT_SLOT slots[MAX_OBJ];
 // Object count
-static int objCount =0;
+static RULE_STATE int objCount =0;
 
 // Player object
-static PLAYER player;
+static RULE_STATE PLAYER player;
 
 // Can move
-static bool canMove;
+static RULE_STATE bool canMove;
+
+// The moving objects and the player before the
+// current quiet frame, restored if it is not quiet
+static RULE_STATE OBJECT_SLOT saved[MAX_OBJ];
+static RULE_STATE PLAYER savedPlayer;
+
+// The hashed words of the objects, the player last
+static RULE_STATE Uint32 words[MAX_OBJ+1];
+// Hash of the words
+static RULE_STATE Uint64 objHash;
+
+
+// Get the word of an object: its cell, whether
+// it exists and the direction it faces
+static Uint32 object_word(const OBJECT* o)
+{
+    Uint32 w = (Uint32)(o->x & 0xFF) | (Uint32)(o->y & 0xFF) << 8;
+
+    if(o->type == OBJ_PLAYER)
+        return w | (Uint32)(((const PLAYER*)o)->dir != 0) << 16;
+
+    w |= (Uint32)o->exist << 16;
+    if(o->type == OBJ_ENEMY)
+    {
+        const ENEMY* e = (const ENEMY*)o;
+        w |= (Uint32)(e->dir > 0) << 17 | (Uint32)(e->spcDir != 0) << 18;
+    }
+    return w;
+}
+
+
+// Get the key of a word. The player can jump either way
+// whichever way it faces, so the facing is not hashed
+static Uint64 word_key(int i, Uint32 w)
+{
+    if(i == MAX_OBJ)
+        w &= 0xFFFF;
+
+    return zobrist_key(ZOBRIST_OBJECTS + i,w);
+}
+
+
+// Update the word of an object and the hash
+static void update_word(int i, const OBJECT* o)
+{
+    Uint32 w = object_word(o);
+    if(w == words[i]) return;
+
+    objHash ^= word_key(i,words[i]) ^ word_key(i,w);
+    words[i] = w;
+}
+
+
+// Compute the words and the hash from scratch
+static void rehash()
+{
+    objHash = 0;
+
+    int i = 0;
+    for(; i < objCount; ++ i)
+    {
+        words[i] = object_word(&slots[i].base);
+        objHash ^= word_key(i,words[i]);
+    }
+    words[MAX_OBJ] = object_word((OBJECT*)&player);
+    objHash ^= word_key(MAX_OBJ,words[MAX_OBJ]);
+}
 
 
 // Reset
@@ -36,24 +115,16 @@ void obj_reset()
     int i = 0;
     for(; i < objCount; ++ i)
     {
-        object_reset(objects[i]);
+        object_reset(&slots[i].base);
     }
     pl_reset(&player);
+    rehash();
 }
 
 
 // Initialize objects
-void obj_init(ASSET_PACK* ass)
+void obj_init()
 {
-    // Initialize game object types
-    boulder_init(ass);
-    key_init(ass);
-    star_init(ass);
-    lock_init(ass);
-    pl_init(ass);
-    enemy_init(ass);
-    coin_init(ass);
-
     // Set default values
     objCount = 0;
     canMove = true;
@@ -66,122 +137,475 @@ void obj_update(float tm)
     // Update game objects
     int i = 0;
     canMove = true;
-    
+
+    // Store positions for interpolation
     for(; i < objCount; ++ i)
     {
-        object_update(objects[i],tm);
-        object_player_collision(objects[i],(OBJECT*)&player);
+        slots[i].base.prevPos = slots[i].base.vpos;
+    }
+    player.prevPos = player.vpos;
+
+    for(i = 0; i < objCount; ++ i)
+    {
+        object_update(&slots[i].base,tm);
+        object_player_collision(&slots[i].base,(OBJECT*)&player);
 
-        if(objects[i]->preventMovement)
+        if(slots[i].base.preventMovement)
             canMove = false;
+
+        update_word(i,&slots[i].base);
     }
 
     // Update player
     pl_update(&player,tm);
     stage_player_elec_collision((void*)&player);
+    update_word(MAX_OBJ,(OBJECT*)&player);
+}
+
+
+// Add an object
+void obj_add(int id, int x, int y)
+{
+    if(id == 7)
+    {
+        player = pl_create(x,y);
+        rehash();
+        return;
+    }
+
+    if(objCount == MAX_OBJ)
+    {
+        printf("Too many objects, ignoring the object in %d,%d.\n",x,y);
+        return;
+    }
+    OBJECT_SLOT* o = &slots[objCount];
+
+    if(id == 19 || id == 26)
+        o->coin = coin_create(x,y,id == 26 ? 1 : 0);
+    else if(id >= 11 && id <= 16)
+        o->enemy = enemy_create(x,y,id-11);
+    else if(id == 10)
+        o->boulder = boulder_create(x,y);
+    else if(id == 9)
+        o->star = star_create(x,y);
+    else if(id == 8)
+        o->key = key_create(x,y);
+    else if(id == 6)
+        o->lock = lock_create(x,y);
+    else
+        return;
+
+    // Set start position
+    o->base.startPos = point(x,y);
+    o->base.prevPos = o->base.vpos;
+    ++ objCount;
+    rehash();
 }
 
 
-// Draw objects
-void obj_draw()
+// Can move
+bool obj_can_move()
+{
+    return canMove;
+}
+
+
+// Are the objects idle
+bool obj_are_idle()
 {
-    // Draw game objects
     int i = 0;
     for(; i < objCount; ++ i)
     {
-        object_draw(objects[i]);
+        if(!object_is_idle(&slots[i].base,(OBJECT*)&player))
+            return false;
     }
+    return true;
+}
+
 
-    // Draw player
-    pl_draw(&player);
+// Have the player and the objects settled
+bool obj_have_settled()
+{
+    return canMove && !player.moving && !player.jumping
+        && !player.bouncing && !player.checkGravity && obj_are_idle();
 }
 
 
-// Add an object
-void obj_add(int id, int x, int y)
+// Clear objects
+void obj_clear()
 {
-    int oldCount = objCount;
+    objCount = 0;
+    rehash();
+}
 
-    bool err = false;
 
-    // TODO: Error checking
-    if(id == 19 || id == 26)
-    {
-        objects[objCount ++] = (OBJECT*) malloc(sizeof(COIN));
-        *((COIN*)objects[objCount -1]) = coin_create(x,y,id == 26 ? 1 : 0);
+// Get object count
+int obj_count()
+{
+    return objCount;
+}
 
-        if(objects[objCount -1] == NULL) err = true;
-    }
-    else if(id >= 11 && id <= 16)
-    {
-        objects[objCount ++] = (OBJECT*) malloc(sizeof(ENEMY));
-        *((ENEMY*)objects[objCount -1]) = enemy_create(x,y,id-11);
 
-        if(objects[objCount -1] == NULL) err = true;
-    }
-    else if(id == 10)
+// Get object
+OBJECT* obj_get(int i)
+{
+    return &slots[i].base;
+}
+
+
+// Get player
+PLAYER* obj_get_player()
+{
+    return &player;
+}
+
+
+// Get state size
+size_t obj_get_state_size()
+{
+    return sizeof(OBJECT_SLOT)*objCount + sizeof(PLAYER) + 1;
+}
+
+
+// Save state
+void obj_save_state(void* buf)
+{
+    Uint8* p = (Uint8*)buf;
+    size_t size = sizeof(OBJECT_SLOT)*objCount;
+
+    memcpy(p,slots,size);
+    memcpy(p + size,&player,sizeof(PLAYER));
+    p[size + sizeof(PLAYER)] = canMove;
+}
+
+
+// Load state
+void obj_load_state(const void* buf)
+{
+    const Uint8* p = (const Uint8*)buf;
+    size_t size = sizeof(OBJECT_SLOT)*objCount;
+
+    memcpy(slots,p,size);
+    memcpy(&player,p + size,sizeof(PLAYER));
+    canMove = p[size + sizeof(PLAYER)] != 0;
+    rehash();
+}
+
+
+// Run a quiet frame for the moving objects and the player
+// in a dry run
+// > True, if nothing but their movement changed
+static bool run_quiet_frame(const int* moving, int count, bool idle)
+{
+    bool oldCanMove = canMove;
+    OBJECT* o;
+    int i = 0;
+
+    set_dry_run(true);
+
+    canMove = true;
+    for(; i < count; ++ i)
     {
-        objects[objCount ++] = (OBJECT*) malloc(sizeof(BOULDER));
-        *((BOULDER*)objects[objCount -1]) = boulder_create(x,y);
+        o = &slots[moving[i]].base;
+        object_update(o,1.0f);
+        object_player_collision(o,(OBJECT*)&player);
 
-        if(objects[objCount -1] == NULL) err = true;
+        if(o->preventMovement)
+            canMove = false;
     }
-    else if(id == 9)
-    {
-        objects[objCount ++] = (OBJECT*) malloc(sizeof(STAR));
-        *((STAR*)objects[objCount -1]) = star_create(x,y);
 
-        if(objects[objCount -1] == NULL) err = true;
+    if(!idle)
+    {
+        pl_update(&player,1.0f);
+        stage_player_elec_collision((void*)&player);
     }
-    else if(id == 8)
+
+    set_dry_run(false);
+
+    if(get_dry_run_changes() > 0 || canMove != oldCanMove
+     || !pl_same_state(&player,&savedPlayer))
+        return false;
+
+    for(i = 0; i < count; ++ i)
     {
-        objects[objCount ++] = (OBJECT*) malloc(sizeof(KEY));
-        *((KEY*)objects[objCount -1]) = key_create(x,y);
+        o = &slots[moving[i]].base;
+        if(o->preventMovement != saved[i].base.preventMovement
+         || o->exist != saved[i].base.exist)
+            return false;
+    }
+    return true;
+}
 
-        if(objects[objCount -1] == NULL) err = true;
+
+// Are the objects that were idle still idle
+static bool still_idle(const bool* idle)
+{
+    int i = 0;
+    for(; i < objCount; ++ i)
+    {
+        if(idle[i] && !object_is_idle(&slots[i].base,(OBJECT*)&player))
+            return false;
     }
-    else if(id == 7)
+    return true;
+}
+
+
+// Skip quiet frames
+int obj_skip_quiet_frames(int max)
+{
+    bool idle[MAX_OBJ];
+    int moving[MAX_OBJ];
+    int count = 0;
+    int i = 0;
+
+    // Updating an idle object would only animate it
+    for(; i < objCount; ++ i)
     {
-        player = pl_create(x,y);
+        idle[i] = object_is_idle(&slots[i].base,(OBJECT*)&player);
+        if(!idle[i])
+            moving[count ++] = i;
     }
-    else if(id == 6)
+    bool plIdle = pl_is_idle(&player);
+
+    if(count == 0 && plIdle)
+        return max;
+
+    bool oldCanMove = canMove;
+    int frames = 0;
+    for(; frames < max; ++ frames)
     {
-        objects[objCount ++] = (OBJECT*) malloc(sizeof(LOCK));
-        *((LOCK*)objects[objCount -1]) = lock_create(x,y);
+        for(i = 0; i < count; ++ i)
+        {
+            saved[i] = slots[moving[i]];
+        }
+        savedPlayer = player;
+
+        // The first frame that is not quiet is undone,
+        // to be run with the rest of the rules
+        if(!run_quiet_frame(moving,count,plIdle) || !still_idle(idle))
+        {
+            for(i = 0; i < count; ++ i)
+            {
+                slots[moving[i]] = saved[i];
+            }
+            player = savedPlayer;
+            canMove = oldCanMove;
+            break;
+        }
+    }
 
-        if(objects[objCount -1] == NULL) err = true;
+    // A quiet frame may turn an enemy around
+    for(i = 0; i < count; ++ i)
+    {
+        update_word(moving[i],&slots[moving[i]].base);
     }
+    update_word(MAX_OBJ,(OBJECT*)&player);
+
+    return frames;
+}
+
+
+// Get hash
+Uint64 obj_get_hash()
+{
+    return objHash;
+}
+
+
+// Get the bits of a cell index
+static int cell_bits()
+{
+    POINT size = stage_get_map_size();
+    return bits_needed(size.x*size.y - 1);
+}
+
 
-    // Show error
-    if(err)
+// Get packed bits
+size_t obj_get_packed_bits()
+{
+    int bits = cell_bits();
+    return objCount * (bits + 3) + bits + 1;
+}
+
+
+// Pack the cell of an object
+static void pack_cell(BIT_STREAM* s, const OBJECT* o, int bits)
+{
+    bits_write(s,o->y * stage_get_map_size().x + o->x,bits);
+}
+
+
+// Unpack the cell of an object
+static void unpack_cell(BIT_STREAM* s, OBJECT* o, int bits)
+{
+    int cell = (int)bits_read(s,bits);
+    int w = stage_get_map_size().x;
+
+    o->x = cell % w;
+    o->y = cell / w;
+}
+
+
+// Pack
+void obj_pack(BIT_STREAM* s)
+{
+    int bits = cell_bits();
+    OBJECT* o;
+    int i = 0;
+    for(; i < objCount; ++ i)
     {
-        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!\n",NULL);
-        app_terminate();
+        o = &slots[i].base;
+        bits_write(s,o->exist,1);
+
+        // The others stay in place
+        if(o->type == OBJ_BOULDER)
+        {
+            pack_cell(s,o,bits);
+        }
+        else if(o->type == OBJ_ENEMY)
+        {
+            pack_cell(s,o,bits);
+            bits_write(s,slots[i].enemy.dir > 0,1);
+            bits_write(s,slots[i].enemy.spcDir != 0,1);
+        }
     }
 
-    // If new object was created, set start position
-    if(oldCount < objCount)
+    pack_cell(s,(OBJECT*)&player,bits);
+    bits_write(s,player.dir != 0,1);
+}
+
+
+// Put an object at rest in its cell. Its cell, whether
+// it exists and the direction of an enemy are kept
+static void place_object(OBJECT_SLOT* o)
+{
+    o->base.preventMovement = false;
+
+    switch(o->base.type)
     {
-        objects[objCount -1]->startPos = point(x,y);
+    case OBJ_BOULDER:
+        o->boulder.moving = false;
+        o->boulder.falling = false;
+        o->boulder.changing = false;
+        o->boulder.gravity = 0.0f;
+        o->boulder.oldx = o->base.x;
+        o->base.spr.frame = 0;
+        o->base.spr.count = 0;
+        break;
+
+    case OBJ_ENEMY:
+        o->enemy.moving = false;
+        o->enemy.falling = false;
+        o->enemy.gravity = 0.0f;
+        o->enemy.sprDir = o->enemy.dir == 1 ? 1 : 0;
+        break;
+
+    case OBJ_KEY:
+        o->key.flying = false;
+        o->key.speedMul = 0.0f;
+        break;
+
+    case OBJ_LOCK:
+        o->lock.opening = false;
+        o->base.spr.frame = 0;
+        break;
+
+    case OBJ_COIN:
+        o->coin.dying = false;
+        break;
+
+    case OBJ_STAR:
+        o->star.collected = false;
+        break;
+
+    default:
+        break;
     }
 
+    o->base.vpos = vec2(o->base.x*16.0f,o->base.y*16.0f);
+    o->base.prevPos = o->base.vpos;
 }
 
 
-// Can move
-bool obj_can_move()
+// Put the player at rest in a cell
+static void place_player(int x, int y, int dir)
 {
-    return canMove;
+    pl_reset(&player);
+    player.x = x;
+    player.y = y;
+    player.dir = dir;
+    player.falling = false;
+    player.checkGravity = false;
+    player.gravity = 0.0f;
+    player.vpos = vec2(player.x*16.0f,player.y*16.0f);
+    player.prevPos = player.vpos;
 }
 
 
-// Clear objects
-void obj_clear()
+// Unpack
+void obj_unpack(BIT_STREAM* s)
 {
+    int bits = cell_bits();
+    OBJECT_SLOT* o;
     int i = 0;
     for(; i < objCount; ++ i)
     {
-        free(objects[i]);
+        o = &slots[i];
+        o->base.exist = bits_read(s,1) != 0;
+
+        if(o->base.type == OBJ_BOULDER)
+        {
+            unpack_cell(s,&o->base,bits);
+        }
+        else if(o->base.type == OBJ_ENEMY)
+        {
+            unpack_cell(s,&o->base,bits);
+            o->enemy.dir = bits_read(s,1) ? 1 : -1;
+            o->enemy.spcDir = (int)bits_read(s,1);
+        }
+        place_object(o);
     }
-    objCount = 0;
-}
\ No newline at end of file
+
+    // The player is reset and moved to its cell
+    OBJECT cell;
+    unpack_cell(s,&cell,bits);
+    place_player(cell.x,cell.y,(int)bits_read(s,1));
+
+    canMove = true;
+    rehash();
+}
+
+
+// Get word
+Uint32 obj_get_word(int i)
+{
+    return words[i];
+}
+
+
+// Set word
+void obj_set_word(int i, Uint32 w)
+{
+    int x = (int)(w & 0xFF);
+    int y = (int)(w >> 8 & 0xFF);
+
+    canMove = true;
+    if(i == MAX_OBJ)
+    {
+        place_player(x,y,(int)(w >> 16 & 1));
+        update_word(i,(OBJECT*)&player);
+        return;
+    }
+
+    OBJECT_SLOT* o = &slots[i];
+    o->base.x = x;
+    o->base.y = y;
+    o->base.exist = (w >> 16 & 1) != 0;
+    if(o->base.type == OBJ_ENEMY)
+    {
+        o->enemy.dir = (w >> 17 & 1) ? 1 : -1;
+        o->enemy.spcDir = (int)(w >> 18 & 1);
+    }
+    place_object(o);
+    update_word(i,&o->base);
+}
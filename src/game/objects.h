@@ -4,24 +4,27 @@
 #ifndef __GAME_OBJECTS__
 #define __GAME_OBJECTS__
 
-#include "../engine/assets.h"
+#include "obase.h"
+#include "player.h"
+
+#include "../lib/bitstream.h"
 
 #include "stdbool.h"
+#include "stddef.h"
+
+/// Maximum amount of objects, the player excluded
+#define MAX_OBJ 64
 
 /// Reset game objects
 void obj_reset();
 
 /// Initialize objects
-/// < ass Asset pack
-void obj_init(ASSET_PACK* ass);
+void obj_init();
 
 /// Update objects
 /// < tm Time mul.
 void obj_update(float tm);
 
-/// Draw objects
-void obj_draw();
-
 /// Add an object
 /// < id Type identifier
 /// < x X coordinate (in grid)
@@ -32,7 +35,80 @@ void obj_add(int id, int x, int y);
 /// > True or false
 bool obj_can_move();
 
+/// Get if all the objects are idle, see object_is_idle. A pushed
+/// boulder still slides when the player can already move
+/// > True or false
+bool obj_are_idle();
+
+/// Get if the player and the objects have settled
+/// after a turn, and nothing moves
+/// > True or false
+bool obj_have_settled();
+
 /// Clear objects from the memory
 void obj_clear();
 
+/// Get the amount of objects
+/// > Object count, the player excluded
+int obj_count();
+
+/// Get an object
+/// < i Index, less than obj_count()
+/// > Object
+OBJECT* obj_get(int i);
+
+/// Get the player
+/// > Player
+PLAYER* obj_get_player();
+
+/// Skip the quiet frames before the next change: only the objects
+/// that move and the player are updated, in a dry run, and the
+/// frame where something else would change is undone
+/// < max Maximum frames to skip
+/// > Frames skipped, 0 if the next frame changes something
+int obj_skip_quiet_frames(int max);
+
+/// Get the size of the object state
+/// > Size in bytes
+size_t obj_get_state_size();
+
+/// Save the object state: the objects and the player
+/// < buf Buffer, obj_get_state_size() bytes
+void obj_save_state(void* buf);
+
+/// Load a saved object state of the same stage
+/// < buf Buffer
+void obj_load_state(const void* buf);
+
+/// Get the hash of the objects and the player: whether
+/// they exist, their cells and the directions of the
+/// enemies. It is updated as they change
+/// > Hash
+Uint64 obj_get_hash();
+
+/// Get the maximum size of packed objects
+/// > Size in bits
+size_t obj_get_packed_bits();
+
+/// Pack the objects and the player. Only what the rules
+/// read between the turns is packed, when nothing moves
+/// < s Stream to write to
+void obj_pack(BIT_STREAM* s);
+
+/// Unpack objects packed from the same stage. The
+/// objects are placed at rest
+/// < s Stream to read from
+void obj_unpack(BIT_STREAM* s);
+
+/// Get the word of an object: its cell, whether
+/// it exists and its direction
+/// < i Index, less than obj_count(), or MAX_OBJ for the player
+/// > Word, up to date between the updates
+Uint32 obj_get_word(int i);
+
+/// Put an object at rest as described by a word
+/// < i Index, less than obj_count(), or MAX_OBJ for the player
+/// < w Word, see obj_get_word
+void obj_set_word(int i, Uint32 w);
+
 #endif // __GAME_OBJECTS__
\ No newline at end of file
@@ -3,17 +3,12 @@
 
 #include "player.h"
 
-#include "../engine/graphics.h"
-#include "../engine/music.h"
-#include "../engine/sample.h"
-
-#include "../vpad.h"
-#include "../transition.h"
+#include "../engine/controls.h"
 
 #include "stage.h"
 #include "objects.h"
-#include "status.h"
-#include "game.h"
+#include "progress.h"
+#include "hooks.h"
 
 #include "math.h"
 #include "stdio.h"
@@ -25,13 +20,6 @@ static float PL_GRAVITY_MAX = 4.0f;
 static float PL_GRAVITY_DELTA = 0.1f;
 static const float STICK_DELTA = 0.1f;
 
-// Player bitmap
-static BITMAP* bmpPlayer;
-
-// Sound effects
-static SAMPLE* sJump;
-static SAMPLE* sDie;
-
 
 // Death check
 static void pl_death_check(PLAYER* pl)
@@ -42,7 +30,7 @@ static void pl_death_check(PLAYER* pl)
         pl->dying = true;
         pl->deathMode = harm;
 
-        fade_out_music(500);
+        raise_event(EVENT_DYING);
     }
 }
 
@@ -94,7 +82,7 @@ static bool pl_get_gravity(PLAYER* pl)
 // Bounce
 static void pl_bounce(PLAYER* pl)
 {
-    VEC2 stick = vpad_get_stick();
+    VEC2 stick = input_get_stick();
 
     // Direction
     if(fabs(stick.x) > STICK_DELTA)
@@ -103,7 +91,7 @@ static void pl_bounce(PLAYER* pl)
     }
 
     // If jump button released, start jumping
-    if(pl->spr.frame >= 2 && (vpad_get_button(0) == RELEASED || vpad_get_button(0) == UP))
+    if(pl->spr.frame >= 2 && (input_get_button(0) == RELEASED || input_get_button(0) == UP))
     {
         int d = pl->dir == 0 ? 1 : -1;
 
@@ -172,9 +160,9 @@ static void pl_bounce(PLAYER* pl)
         
         stage_set_collision_tile(oldx,oldy,0);
         stage_set_collision_tile(pl->x,pl->y,1);
-        status_add_turn();
+        progress_add_turn();
 
-        play_sample(sJump,0.40f);
+        raise_event(EVENT_JUMP);
         
         pl->oldPos = point(oldx,oldy);
     }
@@ -190,13 +178,13 @@ static void pl_control(PLAYER* pl)
     pl->falling = false;
     pl->gravity = 0.0f;
 
-    VEC2 stick = vpad_get_stick();
+    VEC2 stick = input_get_stick();
     int oldx = pl->x;
     int oldy = pl->y;
     int d = 0;
 
     // Jump button pressed
-    if(!pl->bouncing && vpad_get_button(0) == PRESSED)
+    if(!pl->bouncing && input_get_button(0) == PRESSED)
     {   
         pl->bouncing = true;
         pl->spr.count = 0.0f;
@@ -249,7 +237,7 @@ static void pl_control(PLAYER* pl)
 
             stage_set_collision_tile(oldx,oldy,0);
             stage_set_collision_tile(pl->x,pl->y,1);
-            status_add_turn();
+            progress_add_turn();
         }
     }
 }
@@ -339,12 +327,11 @@ static void pl_animate(PLAYER* pl, float tm)
         spr_animate(&pl->spr,4 +pl->deathMode,0,7,pl->spr.frame == 0 ? 20 : 6,tm);
         if(oldframe == 0 && pl->spr.frame > 0)
         {
-            stage_set_shake_timer(60.0f);
-            play_sample(sDie,0.40f);
+            raise_event(EVENT_DIE);
         }
         if(pl->spr.frame == 7)
         {
-            trn_set(FADE_IN,BLACK_VERTICAL,1.0f,game_reset);
+            raise_event(EVENT_DEAD);
         }
     }
     // Bouncing
@@ -399,16 +386,6 @@ static void pl_animate(PLAYER* pl, float tm)
 }
 
 
-// Initialize player
-void pl_init(ASSET_PACK* ass)
-{
-    // Set assets
-    bmpPlayer = (BITMAP*)get_asset(ass,"player");
-    sJump = (SAMPLE*)get_asset(ass,"jump");
-    sDie = (SAMPLE*)get_asset(ass,"die");
-}
-
-
 // Reset player
 void pl_reset(PLAYER* pl)
 {
@@ -430,6 +407,7 @@ void pl_reset(PLAYER* pl)
 
     pl->vpos.x = 16.0f*pl->x;
     pl->vpos.y = 16.0f*pl->y;
+    pl->prevPos = pl->vpos;
 }
 
 
@@ -437,11 +415,13 @@ void pl_reset(PLAYER* pl)
 PLAYER pl_create(int x, int y)
 {
     PLAYER pl;
+    pl.type = OBJ_PLAYER;
     pl.x = x;
     pl.y = y;
     pl.startPos = point(x,y);
     pl.vpos.x = 16.0f*x;
     pl.vpos.y = 16.0f*y;
+    pl.prevPos = pl.vpos;
     pl.spr = create_sprite(24,24);
 
     pl.moving = false;
@@ -487,13 +467,6 @@ void pl_update(PLAYER* pl, float tm)
 }
 
 
-// Draw player
-void pl_draw(PLAYER* pl)
-{
-    spr_draw(&pl->spr,bmpPlayer,(int)round(pl->vpos.x) - 4,(int)round(pl->vpos.y) -4 + 1,pl->dir);
-}
-
-
 // Hurt player
 void pl_hurt(PLAYER* pl)
 {
@@ -502,5 +475,29 @@ void pl_hurt(PLAYER* pl)
     pl->jumping = false;
     pl->falling = false;
 
-    fade_out_music(500);
-}
\ No newline at end of file
+    raise_event(EVENT_DYING);
+}
+
+
+// Is idle
+bool pl_is_idle(const PLAYER* pl)
+{
+    return !pl->moving && !pl->jumping && !pl->bouncing && !pl->falling
+        && !pl->checkGravity && !pl->startedMoving && !pl->dying
+        && !pl->victorous && stage_is_harmful(pl->x,pl->y) == 0;
+}
+
+
+// Compare rule states
+bool pl_same_state(const PLAYER* a, const PLAYER* b)
+{
+    return a->x == b->x && a->y == b->y && a->dir == b->dir
+        && a->moving == b->moving && a->checkGravity == b->checkGravity
+        && a->falling == b->falling && a->climbing == b->climbing
+        && a->jumping == b->jumping && a->bouncing == b->bouncing
+        && a->pushing == b->pushing && a->startedMoving == b->startedMoving
+        && a->dying == b->dying && a->victorous == b->victorous
+        && a->canMove == b->canMove && a->deathMode == b->deathMode
+        && a->oldPos.x == b->oldPos.x && a->oldPos.y == b->oldPos.y
+        && a->target.x == b->target.x && a->target.y == b->target.y;
+}
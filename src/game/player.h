@@ -5,7 +5,6 @@
 #define __PLAYER__
 
 #include "../engine/sprite.h"
-#include "../engine/assets.h"
 
 #include "obase.h"
 
@@ -39,10 +38,6 @@ EXTENDS_GAME_OBJECT
 
 AS ( PLAYER );
 
-/// Initialize player
-/// < ass Assets
-void pl_init(ASSET_PACK* ass);
-
 /// Reset player
 /// < pl Player to reset
 void pl_reset(PLAYER* pl);
@@ -58,12 +53,21 @@ PLAYER pl_create(int x, int y);
 /// < tm Time multiplier
 void pl_update(PLAYER* pl, float tm);
 
-/// Draw player
-/// < pl Player object
-void pl_draw(PLAYER* pl);
-
 /// Hurt player
 /// < pl Player to hurt
 void pl_hurt(PLAYER* pl);
 
+/// Is the player idle: until the stage or the input changes,
+/// updating it changes nothing but its animation
+/// < pl Player
+/// > True, if idle
+bool pl_is_idle(const PLAYER* pl);
+
+/// Compare the rule state of two players. The position on the
+/// screen, the speed and the animation are not compared
+/// < a Player
+/// < b Player
+/// > True, if the rule states are equal
+bool pl_same_state(const PLAYER* a, const PLAYER* b);
+
 #endif // __PLAYER__
\ No newline at end of file
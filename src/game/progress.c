@@ -0,0 +1,80 @@
+/// Stage progress (source)
+/// (c) 2018 Jani Nykänen
+
+#include "progress.h"
+
+#include "stage.h"
+#include "hooks.h"
+
+// Key count
+static RULE_STATE int keyCount;
+// Turn count
+static RULE_STATE int turnCount;
+
+
+// Reset progress
+void progress_reset()
+{
+    keyCount = 0;
+    turnCount = 0;
+}
+
+
+// Add key
+void progress_add_key()
+{
+    if(dry_run_change()) return;
+
+    ++ keyCount;
+}
+
+
+// Remove key
+void progress_remove_key()
+{
+    if(dry_run_change()) return;
+
+    if(keyCount > 0)
+        -- keyCount;
+}
+
+
+// Get key count
+int progress_get_key_count()
+{
+    return keyCount;
+}
+
+
+// Add turn
+void progress_add_turn()
+{
+    if(dry_run_change()) return;
+
+    ++ turnCount;
+    stage_toggle_electricity();
+}
+
+
+// Get turn count
+int progress_get_turn_count()
+{
+    return turnCount;
+}
+
+
+
+// Save state
+void progress_save_state(PROGRESS_STATE* st)
+{
+    st->keys = keyCount;
+    st->turns = turnCount;
+}
+
+
+// Load state
+void progress_load_state(const PROGRESS_STATE* st)
+{
+    keyCount = st->keys;
+    turnCount = st->turns;
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+/// Stage progress (header)
+/// (c) 2018 Jani Nykänen
+///
+/// The counters of the game rules. The status bar only
+/// shows them
+
+#ifndef __PROGRESS__
+#define __PROGRESS__
+
+/// Saved progress
+typedef struct
+{
+    int keys;
+    int turns;
+}
+PROGRESS_STATE;
+
+/// Reset progress
+void progress_reset();
+
+/// Add key
+void progress_add_key();
+
+/// Remove key
+void progress_remove_key();
+
+/// Get amount of keys
+/// > Key count
+int progress_get_key_count();
+
+/// Add turn, toggles the electricity
+void progress_add_turn();
+
+/// Get amount of turns
+/// > Turn count
+int progress_get_turn_count();
+
+/// Save the progress
+/// < st Where to save
+void progress_save_state(PROGRESS_STATE* st);
+
+/// Load saved progress
+/// < st Saved progress
+void progress_load_state(const PROGRESS_STATE* st);
+
+#endif // __PROGRESS__
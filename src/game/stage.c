@@ -3,592 +3,190 @@
 
 #include "stage.h"
 
-#include "../engine/graphics.h"
-#include "../engine/sprite.h"
-#include "../lib/tmxc.h"
-
 #include "objects.h"
 #include "player.h"
-#include "status.h"
-
-#include "../global.h"
+#include "tiles.h"
+#include "hooks.h"
+#include "zobrist.h"
 
-#include "math.h"
 #include "stdlib.h"
-
-// Default map size in tiles
-#define DEFAULT_MAP_SIZE 16*12
-
-// Bitmaps
-static BITMAP* bmpSky;
-static BITMAP* bmpSky3;
-static BITMAP* bmpClouds;
-static BITMAP* bmpClouds2;
-static BITMAP* bmpTiles;
-static BITMAP* bmpElectricity;
+#include "string.h"
+#include "math.h"
 
 // Map
-static TILEMAP* mapMain;
+static RULE_STATE const STAGE* mapMain = NULL;
 // Collision map
-static int colMap[DEFAULT_MAP_SIZE];
+static RULE_STATE Uint8 colMap[STAGE_MAX_SIZE];
 // Layer data
-static int layerData[DEFAULT_MAP_SIZE];
-
-// Cloud position
-static float cloudPos;
-// Lava position
-static float lavaPos;
-// Shake timer
-static float shakeTimer;
+static RULE_STATE Uint8 layerData[STAGE_MAX_SIZE];
 
 // Is electricity on
-static bool elecOn;
-// Electricity sprite
-static SPRITE sprElec;
-
-
-// Is the tile in (x+dx,y+dy) same as in (x,y)
-static bool is_same_tile(TILEMAP* t, int id, int x, int y, int dx, int dy)
-{
-    if(x+dx < 0 || y +dy < 0 || x+dx >= t->width || y+dy >= t->height)
-        return true;
-
-    return id == layerData[(y+dy)*t->width + x + dx];
-}
-
-
-// Draw a piece of tile
-static void draw_tile_piece(int tx, int ty, int x, int y)
-{
-    draw_bitmap_region(bmpTiles,tx*8,ty*8,8,8,x,y,0);
-}
-
-
-// Draw soil tile
-static void draw_tile_soil(TILEMAP* t, int x, int y)
-{
-    POINT t11, t12, t21, t22;
-
-    bool leftGreen = false;
-    bool rightGreen = false;
-
-    t11 = point(2,0);
-    t12 = point(0,1);
-    t21 = point(3,0);
-    t22 = point(1,1);
-
-    // Bottom tile is different
-    if(!is_same_tile(t,1,x,y,0,1))
-    {
-        t12 = point(10,0);
-        t22 = point(11,0);
-    }
-
-    // Right tile is different
-    if(!is_same_tile(t,1,x,y,1,0))
-    {
-        t21 = point(5,0);
-        t22 = point(5,1);
-
-        // Bottom
-        if(!is_same_tile(t,1,x,y,0,1))
-        {
-            t22 = point(3,1);
-        }
-    }
-
-    // Left tile is different
-    if(!is_same_tile(t,1,x,y,-1,0))
-    {
-        t11 = point(4,0);
-        t12 = point(4,1);
+static RULE_STATE bool elecOn;
 
-        // Bottom
-        if(!is_same_tile(t,1,x,y,0,1))
-        {
-            t12 = point(2,1);
-        }
-    }
+// Tiles and collision tiles at the start of the stage
+static RULE_STATE Uint8 startLayer[STAGE_MAX_SIZE];
+static RULE_STATE Uint8 startCol[STAGE_MAX_SIZE];
+// Hash of the start
+static RULE_STATE Uint64 startHash;
+// Hash of the tiles, the collision map and the electricity
+static RULE_STATE Uint64 tileHash;
 
-    // Upper tile is different
-    if(!is_same_tile(t,1,x,y,0,-1))
-    {
-        t11 = point(0,0);
-        t21 = point(1,0);
+// Tile change callback
+static RULE_STATE TILE_CALLBACK onTileChange = NULL;
 
-        // Right
-        if(!is_same_tile(t,1,x,y,1,0))
-        {
-            t21 = point(9,1);
-            rightGreen = true;
-        }
 
-        // Left
-        if(!is_same_tile(t,1,x,y,-1,0))
-        {
-            t11 = point(8,1);
-            leftGreen = true;
-        }
-    }
-
-    // Bottom-right corner
-    if(!is_same_tile(t,1,x,y,1,1) && is_same_tile(t,1,x,y,1,0) 
-        && is_same_tile(t,1,x,y,0,1))
-    {
-        t22 = point(8,0);
-    }
-
-    // Bottom-left corner
-    if(!is_same_tile(t,1,x,y,-1,1) && is_same_tile(t,1,x,y,-1,0) 
-        && is_same_tile(t,1,x,y,0,1))
-    {
-        t12 = point(9,0);
-    }
-
-    // Top-right corner
-    if(!is_same_tile(t,1,x,y,1,-1) && is_same_tile(t,1,x,y,1,0) 
-        && is_same_tile(t,1,x,y,0,-1))
-    {
-        t21 = point(6,1);
-    }
-
-    // Top-left corner
-    if(!is_same_tile(t,1,x,y,-1,-1) && is_same_tile(t,1,x,y,-1,0) 
-        && is_same_tile(t,1,x,y,0,-1))
-    {
-        t11 = point(7,1);
-    }
-
-    // Draw tile pieces
-    draw_tile_piece(t11.x,t11.y,x*16,y*16);
-    draw_tile_piece(t21.x,t21.y,x*16 + 8,y*16);
-    draw_tile_piece(t12.x,t12.y,x*16,y*16 + 8);
-    draw_tile_piece(t22.x,t22.y,x*16 + 8,y*16 + 8);
-
-    if(leftGreen)
-        draw_tile_piece(6,0,x*16 - 8,y*16);
-    if(rightGreen)
-        draw_tile_piece(7,0,x*16 +16,y*16);
-}
-
-
-// Draw vine
-static void draw_vine(TILEMAP* t, int x, int y)
+// Tell that a tile has changed
+static void tile_changed(int x, int y)
 {
-    int sx1 = 96;
-    int sx2 = 96;
-    int sy1 = 0;
-    int sy2 = 8;
-
-    // Above
-    if(!is_same_tile(t,2,x,y,0,-1) && !is_same_tile(t,1,x,y,0,-1))
-    {
-        sx1 += 16;
-    }
-
-    // Below
-    if(!is_same_tile(t,2,x,y,0,1) && !is_same_tile(t,1,x,y,0,1))
-    {
-        sx2 += 16;
-    }
-
-    // Upper part
-    draw_bitmap_region(bmpTiles,sx1,sy1,16,8,x*16,y*16,0);
-    // Bottom part
-    draw_bitmap_region(bmpTiles,sx2,sy2,16,8,x*16,y*16 + 8,0);
+    if(onTileChange != NULL)
+        onTileChange(x,y);
 }
 
 
-// Draw spikes
-static void draw_spikes(TILEMAP* t, int x, int y)
+// Compute the hash from scratch
+static Uint64 compute_hash()
 {
-    draw_bitmap_region(bmpTiles,144,0,16,8,x*16,y*16,0);
+    Uint64 h = zobrist_key(ZOBRIST_ELECTRICITY,elecOn);
+    if(mapMain == NULL) return h;
 
-    // Left
-    if(!is_same_tile(t,4,x,y,-1,0) && !is_same_tile(t,1,x,y,-1,0))
-    {
-        draw_bitmap_region(bmpTiles,144,8,8,8,x*16,y*16 + 8,0);
-    }
-    else
-    {
-        if(is_same_tile(t,4,x,y,-1,0))
-            draw_bitmap_region(bmpTiles,144,8,8,8,x*16,y*16 + 8,0);
-        else
-            draw_bitmap_region(bmpTiles,160,0,8,8,x*16,y*16 + 8,0);
-    }
-
-    // Right
-    if(!is_same_tile(t,4,x,y,1,0) && !is_same_tile(t,1,x,y,1,0))
-    {
-        draw_bitmap_region(bmpTiles,152,8,8,8,x*16 + 8,y*16 + 8,0);
-    }
-    else
-    {
-        draw_bitmap_region(bmpTiles,168,8,8,8,x*16+8,y*16 + 8,0);
-    }
-}
-
-
-// Draw lava
-static void draw_lava(TILEMAP* t, int x, int y, int type)
-{
     int i = 0;
-
-    int lpos = (int)round(lavaPos) % 16;
-    int lposy = (int)round(sin(lavaPos / 2.0f) * 1.0f) +1;
-
-    draw_bitmap_region(bmpTiles,128+112*type,8,16,8,x*16, y*16+8, 0);
-    if(!is_same_tile(t,3 +type*17,x,y,0,-1))
-    {
-        for(; i < 2; ++ i)
-        {
-            draw_bitmap_region(bmpTiles,128+112*type,0,16,8,x*16 + lpos + i*16, y*16 + lposy, 0);
-        }
-    }
-    else
+    for(; i < mapMain->width*mapMain->height; ++ i)
     {
-        draw_bitmap_region(bmpTiles,128+112*type,8,16,8,x*16, y*16, 0);
+        h ^= zobrist_key(ZOBRIST_LAYER + i,layerData[i])
+           ^ zobrist_key(ZOBRIST_COLLISION + i,colMap[i]);
     }
+    return h;
 }
 
 
-// Draw an "other kind of" solid object, like lock
-static void draw_other_solid(TILEMAP* t,int id, int x, int y, int dx, int dy)
+// Set a layer tile by index, the hash is updated
+static void set_layer_tile(int i, Uint8 id)
 {
-    POINT t11, t12, t21, t22;
-
-    t11 = point(6+dx,dy);
-    t12 = point(6+dx,dy+1);
-    t21 = point(6+dx+1,dy);
-    t22 = point(6+dx+1,dy+1);
-
-    // Free directions
-    bool bottom = (!is_same_tile(t,1,x,y,0,1) && !is_same_tile(t,id,x,y,0,1));
-    bool top = (!is_same_tile(t,1,x,y,0,-1) && !is_same_tile(t,id,x,y,0,-1));
-    bool left = (!is_same_tile(t,1,x,y,-1,0) && !is_same_tile(t,id,x,y,-1,0));
-    bool right = (!is_same_tile(t,1,x,y,1,0) && !is_same_tile(t,id,x,y,1,0));
-
-    // Bottom
-    if(bottom)
-    {
-        if(left)
-            t12 = point(dx,dy+1);
-        else
-            t12 = point(dx+4,dy+1);
-
-        if(right)
-            t22 = point(dx+1,dy+1);
-        else
-            t22 = point(dx+5,dy+1);
-    }
-    else
-    {
-        if(left)
-            t12 = point(dx+2,dy+1);
-
-        if(right)
-            t22 = point(dx+3,dy+1);
-    }
-
-    // Top
-    if(top)
-    {
-        if(left)
-            t11 = point(dx,dy);
-        else
-            t11 = point(dx+4,dy);
-
-        if(right)
-            t21 = point(dx+1,dy);
-        else
-            t21 = point(dx+5,dy);
-    }
-    else
-    {
-        if(left)
-            t11 = point(dx+2,dy);
-
-        if(right)
-            t21 = point(dx+3,dy);
-    }
-
-    // Draw tile pieces
-    draw_tile_piece(t11.x,t11.y,x*16,y*16);
-    draw_tile_piece(t21.x,t21.y,x*16 + 8,y*16);
-    draw_tile_piece(t12.x,t12.y,x*16,y*16 + 8);
-    draw_tile_piece(t22.x,t22.y,x*16 + 8,y*16 + 8);
+    tileHash ^= zobrist_key(ZOBRIST_LAYER + i,layerData[i])
+              ^ zobrist_key(ZOBRIST_LAYER + i,id);
+    layerData[i] = id;
 }
 
 
-// Draw electricity
-static void draw_electricity(TILEMAP* t, int x, int y, bool horizontal, bool cond)
+// Set a collision tile by index, the hash is updated
+static void set_col_tile(int i, Uint8 id)
 {
-    if(!cond) return;
-
-    int frame = sprElec.frame;
-    int row = horizontal ? 1 : 0;
-    
-    draw_bitmap_region(bmpElectricity,frame*16,row*16,16,16,x*16,y*16,0);
+    tileHash ^= zobrist_key(ZOBRIST_COLLISION + i,colMap[i])
+              ^ zobrist_key(ZOBRIST_COLLISION + i,id);
+    colMap[i] = id;
 }
 
 
-// Draw map
-static void draw_map(TILEMAP* t)
+// Reset stage
+void stage_reset(bool soft)
 {
-    int x = 0;
-    int y = 0;
-    int id = 0;
-
-    // Draw only lava
-    for(y=0; y < t->height; ++ y)
-    {
-        for(x=0; x < t->width; ++ x)
-        {
-            id = layerData[y*t->width + x];
-            if(id != 3 && id != 20) continue;
-            draw_lava(t, x,y, id == 3 ? 0 : 1);
-        }
-    }
+    elecOn = true;
 
-    // Draw the rest of tiles
-    for(y=0; y < t->height; ++ y)
+    if(mapMain == NULL)
     {
-        for(x=0; x < t->width; ++ x)
-        {
-            id = layerData[y*t->width + x];
-            if(id == 0) continue;
-
-            // TODO: Add 'switch'
-            if(id == 1)
-            {
-                draw_tile_soil(t, x,y);
-            }
-            else if(id == 2)
-            {
-                draw_vine(t, x,y);
-            }
-            else if(id == 4)
-            {
-                draw_spikes(t,x,y);
-            }
-            else if(id == 5)
-            {
-                draw_other_solid(t,5,x,y,0,2);
-            }
-            else if(id == 6)
-            {
-                draw_other_solid(t,6,x,y,22,0);
-            }
-            else if(id == 17)
-            {
-                draw_other_solid(t,17,x,y,8,2);
-            }
-            else if(id == 18)
-            {
-                draw_bitmap_region(bmpTiles,128,16,16,16,x*16,y*16,0);
-            }
-            else if(id == 21)
-            {
-                draw_other_solid(t,21,x,y,18,2);
-            }
-            else if(id == 22 || id == 23)
-            {
-                draw_electricity(t,x,y,id == 23,elecOn);
-            }
-            else if(id == 24 || id == 25)
-            {
-                draw_electricity(t,x,y,id == 25,!elecOn);
-            }
-        }
+        tileHash = compute_hash();
+        tile_changed(-1,-1);
+        return;
     }
-}
-
 
-// Draw stage background
-static void draw_background()
-{
-    BITMAP* bsky = status_get_if_final() ? bmpSky3 : bmpSky;
-    BITMAP* bclouds = status_get_if_final() ? bmpClouds2 : bmpClouds;
+    // Copy layer data. On a soft reset objects are not
+    // created, so their tiles stay in the collision map
+    int size = mapMain->width*mapMain->height;
+    memcpy(layerData,mapMain->tiles,size);
+    memcpy(colMap,soft ? mapMain->tiles : mapMain->collision,size);
 
+    // Create objects
+    const STAGE_SPAWN* sp;
     int i = 0;
-
-    draw_bitmap(bsky,0,0,0);
-    for(; i < 2; ++ i)
+    for(; i < mapMain->spawnCount && !soft; ++ i)
     {
-        draw_bitmap(bclouds,(int)round(cloudPos + i * 256),192 - bclouds->h,0);
+        sp = &mapMain->spawns[i];
+        obj_add(sp->id,SDL_SwapLE16(sp->x),SDL_SwapLE16(sp->y));
     }
+
+    tileHash = compute_hash();
+    tile_changed(-1,-1);
 }
 
 
-// Parse map and create objects and define collision map
-static void parse_map(TILEMAP* t, bool colOnly)
+// Set map
+int stage_set_map(const STAGE* s)
 {
-    int x = 0;
-    int y = 0;
-    int id = 0;
+    mapMain = s;
 
-    // Draw only lava
-    for(y=0; y < t->height; ++ y)
+    // The stage buffers have a fixed size
+    if(s != NULL && s->width*s->height > STAGE_MAX_SIZE)
     {
-        for(x=0; x < t->width; ++ x)
-        {
-            id = layerData[y*t->width + x];
-            if( ( (id >= 6  && id < 16) || id == 19 || id == 26) && !colOnly)
-            {
-                obj_add(id,x,y);
-            }
-            else if(id > 0)
-            {
-                colMap[y*t->width + x] = id;
-            }
-        }
+        mapMain = NULL;
+        return 1;
     }
+    return 0;
 }
 
 
-// Reset stage
-void stage_reset(bool soft)
+// Get map
+const STAGE* stage_get_map()
 {
-    // Set variables to their default values
-    cloudPos = 0.0f;
-    lavaPos = 0.0f;
-    shakeTimer = 0.0f;
-    elecOn = true;
-
-    if(mapMain == NULL) return;
-
-    // Clear collision map & copy layer data
-    int i = 0;
-    for(; i < mapMain->width*mapMain->height; ++ i)
-    {
-        layerData[i] = mapMain->layers[0] [i];
-        colMap[i] = 0;
-    }
-
-    // Create objects
-    parse_map(mapMain,soft);
+    return mapMain;
 }
 
 
-// Initialize stage
-void stage_init(ASSET_PACK* ass)
+// Get layer data
+const Uint8* stage_get_layer_data()
 {
-    // Get assets
-    bmpSky = (BITMAP*)get_asset(ass,"sky1");
-    bmpSky3 = (BITMAP*)get_asset(ass,"sky3");
-    bmpClouds = (BITMAP*)get_asset(ass,"clouds1");
-    bmpClouds2 = (BITMAP*)get_asset(ass,"clouds2");
-    bmpTiles = (BITMAP*)get_asset(ass,"tiles1");
-    bmpElectricity = (BITMAP*)get_asset(ass,"electricity");
-
-    // Create components
-    sprElec = create_sprite(16,16);
-
-    mapMain = NULL;
-    // Reset values
-    stage_reset(true);
+    return layerData;
 }
 
 
-// Update stage
-void stage_update(float tm)
+// Set tile callback
+void stage_set_tile_callback(TILE_CALLBACK cb)
 {
-    const float CLOUD_SPEED = 0.5f;
-    const float LAVA_SPEED = 0.125f;
-
-    // Update cloud position
-    cloudPos -= CLOUD_SPEED * tm;
-    if(cloudPos <= -bmpClouds->w)
-    {
-        cloudPos += bmpClouds->w;
-    }
-
-    // Update lava position
-    lavaPos -= LAVA_SPEED * tm;
-    if(lavaPos <= -M_PI*2 * 16.0f)
-    {
-        lavaPos += M_PI*2 * 16.0f;
-    }
-
-    // Update shake timer
-    if(shakeTimer > 0.0f)
-    {
-        shakeTimer -= 1.0f * tm;
-    }
-
-    // Update electricity sprite
-    spr_animate(&sprElec,0,0,2,5,tm);
+    onTileChange = cb;
 }
 
 
-// Draw stage
-void stage_draw()
+// Is the wire tile on
+static bool is_live_wire(int id, int onId, int offId)
 {
-    if(shakeTimer > 0.0f)
-    {
-        int shakex = rand() % 7 - 3;
-        int shakey = rand() % 7 - 3;
-
-        translate(shakex,shakey);
-    }
-    else
-    {
-        translate(0,0);
-    }
-
-    draw_background();
-    draw_map(mapMain);
-
-    translate(0,0);
+    return (id == onId && elecOn) || (id == offId && !elecOn);
 }
 
 
-// Player electricity collision
+// Player electricity collision. Only the wire the player
+// jumps over and the one it falls through can hurt
 void stage_player_elec_collision(void* p)
 {
-    
-    int x = 0;
-    int y = 0;
-
     PLAYER* pl = (PLAYER*)p;
+    int x,y;
 
-    int id;
+    // Jumping over a horizontal wire
+    if(pl->jumping && pl->y >= 0 && pl->y < mapMain->height
+       && abs(pl->x - pl->oldPos.x) == 2)
+    {
+        x = (pl->x + pl->oldPos.x) / 2;
+        if(x >= 0 && x < mapMain->width
+           && is_live_wire(layerData[pl->y*mapMain->width + x],22,24)
+           && !stage_is_harmful(pl->oldPos.x,pl->oldPos.y))
+        {
+            pl_hurt(pl);
+        }
+    }
 
-    for(; y < mapMain->height; ++ y)
+    // Falling through a vertical wire
+    if(pl->falling && pl->x >= 0 && pl->x < mapMain->width)
     {
-        for(x = 0; x < mapMain->width; ++ x)
+        y = (int)floorf(pl->vpos.y / 16.0f);
+        if(y >= 0 && y < mapMain->height && pl->vpos.y > y*16.0f
+           && is_live_wire(layerData[y*mapMain->width + pl->x],23,25))
         {
-            id = layerData[y*mapMain->width + x];
-            bool cond1 = (id == 22 && elecOn) || (id == 24 && !elecOn );
-            bool cond2 = (id == 23 && elecOn) || (id == 25 && !elecOn );
-            if(!cond1 && !cond2)
-                continue;
-
-            if(cond1)
-            {
-                if(pl->jumping && (!stage_is_harmful(pl->oldPos.x,pl->oldPos.y) && pl->y == y && (  (pl->x == x-1 && pl->oldPos.x == x+1) ||
-                    (pl->x == x+1 && pl->oldPos.x == x-1) ) ) )
-                {
-                    pl_hurt(pl);
-                }
-            }
-
-            if(cond2)
-            {
-                
-                if(pl->falling && pl->x == x && pl->vpos.y > y*16.0f && pl->vpos.y < y*16.0f+16.0f)
-                {
-                    
-                    pl_hurt(pl);
-                }
-            }
+            pl_hurt(pl);
         }
     }
 }
 
 
 // Get collision map
-int* stage_get_collision_map()
+Uint8* stage_get_collision_map()
 {
     return colMap;
 }
@@ -607,9 +205,7 @@ bool stage_is_solid(int x, int y)
     if(x < 0 || y < 0 || x >= mapMain->width || y >= mapMain->height)
         return true;
 
-    int id = colMap[y * mapMain->width + x];
-
-    return (id == 1 || (id >= 4 && id <= 6) || id == 17 || id == 21);
+    return (tile_properties(colMap[y * mapMain->width + x]) & TILE_SOLID) != 0;
 }
 
 
@@ -619,7 +215,7 @@ bool stage_is_vine(int x, int y)
     if(x < 0 || y < 0 || x >= mapMain->width || y >= mapMain->height)
         return false;
 
-    return layerData [y * mapMain->width + x] == 2;
+    return (tile_properties(layerData[y * mapMain->width + x]) & TILE_VINE) != 0;
 }
 
 
@@ -629,14 +225,20 @@ void stage_set_collision_tile(int x, int y, int id)
     if(x < 0 || y < 0 || x >= mapMain->width || y >= mapMain->height)
         return;
 
-    colMap[y * mapMain->width + x] = id;
+    // Objects keep writing their own tile, that is not a change
+    if(colMap[y * mapMain->width + x] == id || dry_run_change()) return;
+
+    set_col_tile(y * mapMain->width + x,id);
 }
 
 
 // Set tile
 void stage_set_tile(int x, int y, int id)
 {
-    layerData [y*mapMain->width + x] = id;
+    if(layerData [y*mapMain->width + x] == id || dry_run_change()) return;
+
+    set_layer_tile(y*mapMain->width + x,id);
+    tile_changed(x,y);
 }
 
 
@@ -646,8 +248,7 @@ bool stage_is_lava(int x, int y)
     if(x < 0 || y < 0 || x >= mapMain->width || y >= mapMain->height)
         return false;
 
-    int id = layerData[y * mapMain->width + x];
-    return id == 3 || id == 20;
+    return (tile_properties(layerData[y * mapMain->width + x]) & TILE_LAVA) != 0;
 }
 
 
@@ -668,24 +269,11 @@ int stage_is_harmful(int x, int y)
 }
 
 
-// Set shake timer value
-void stage_set_shake_timer(float s)
-{
-    shakeTimer = s;
-}
-
-
-// Set stage name
-void stage_set_main_stage(const char* name)
-{
-    ASSET_PACK* ass = get_global_assets();
-    mapMain = (TILEMAP*)get_asset(ass,name);
-}
-
-
-/// Toggle purple blocks
+// Toggle purple blocks
 void stage_toggle_purple_blocks()
 {
+    if(dry_run_change()) return;
+
     int i = 0;
     int id = 0;
     for(; i < mapMain->width*mapMain->height; ++ i)
@@ -693,24 +281,30 @@ void stage_toggle_purple_blocks()
         id = layerData[i];
         if(id == 18)
         {
-            layerData[i] = 17;
-            colMap[i] = 1;
+            set_layer_tile(i,17);
+            set_col_tile(i,1);
         }
         else if(id == 17)
         {
-            layerData[i] = 18;
-            colMap[i] = 0;
+            set_layer_tile(i,18);
+            set_col_tile(i,0);
         }
         else if(id == 20)
         {
-            layerData[i] = 21;
-            colMap[i] = 1;
+            set_layer_tile(i,21);
+            set_col_tile(i,1);
         }
         else if(id == 21)
         {
-            layerData[i] = 20;
-            colMap[i] = 0;
+            set_layer_tile(i,20);
+            set_col_tile(i,0);
         }
+        else
+        {
+            continue;
+        }
+
+        tile_changed(i % mapMain->width,i / mapMain->width);
     }
 }
 
@@ -718,13 +312,45 @@ void stage_toggle_purple_blocks()
 // Toggle electricity
 void stage_toggle_electricity()
 {
+    if(dry_run_change()) return;
+
+    tileHash ^= zobrist_key(ZOBRIST_ELECTRICITY,0)
+              ^ zobrist_key(ZOBRIST_ELECTRICITY,1);
     elecOn = !elecOn;
 }
 
 
+// Set electricity
+void stage_set_electricity(bool state)
+{
+    if(state != elecOn)
+        stage_toggle_electricity();
+}
+
+
+// Is electricity on
+bool stage_is_electricity_on()
+{
+    return elecOn;
+}
+
+
+// Set a cell
+void stage_set_cell(int i, int id, int col)
+{
+    if(dry_run_change()) return;
+
+    set_layer_tile(i,(Uint8)id);
+    set_col_tile(i,(Uint8)col);
+    tile_changed(i % mapMain->width,i / mapMain->width);
+}
+
+
 // Mutate the stage
 void stage_mutate()
 {
+    if(dry_run_change()) return;
+
     int i = 0;
     int id = 0;
     for(; i < mapMain->width*mapMain->height; ++ i)
@@ -732,12 +358,150 @@ void stage_mutate()
         id = layerData[i];
         switch(id)
         {
-        case 1: layerData[i] = 5; break;
-        case 5: layerData[i] = 17; break;
-        case 18: layerData[i] = 1; colMap[i] = 1; break;
-        case 2: layerData[i] = 22; break;
-        case 22: layerData[i] = 2; break;
-        default: break;
+        case 1: set_layer_tile(i,5); break;
+        case 5: set_layer_tile(i,17); break;
+        case 18: set_layer_tile(i,1); set_col_tile(i,1); break;
+        case 2: set_layer_tile(i,22); break;
+        case 22: set_layer_tile(i,2); break;
+        default: continue;
         }
+
+        tile_changed(i % mapMain->width,i / mapMain->width);
     }
+}
+
+
+// Get state size
+size_t stage_get_state_size()
+{
+    if(mapMain == NULL) return 1;
+
+    return mapMain->width*mapMain->height*2 + 1;
+}
+
+
+// Save state
+void stage_save_state(void* buf)
+{
+    Uint8* p = (Uint8*)buf;
+    int size = stage_get_state_size() / 2;
+
+    memcpy(p,layerData,size);
+    memcpy(p + size,colMap,size);
+    p[size*2] = elecOn;
+}
+
+
+// Load state
+void stage_load_state(const void* buf)
+{
+    const Uint8* p = (const Uint8*)buf;
+    int size = stage_get_state_size() / 2;
+
+    memcpy(layerData,p,size);
+    memcpy(colMap,p + size,size);
+    elecOn = p[size*2] != 0;
+
+    tileHash = compute_hash();
+    tile_changed(-1,-1);
+}
+
+
+// Set start
+void stage_set_start()
+{
+    if(mapMain == NULL) return;
+
+    int size = mapMain->width*mapMain->height;
+    memcpy(startLayer,layerData,size);
+    memcpy(startCol,colMap,size);
+
+    // The electricity is not a part of the start
+    startHash = compute_hash() ^ zobrist_key(ZOBRIST_ELECTRICITY,elecOn);
+}
+
+
+// Get hash
+Uint64 stage_get_hash()
+{
+    return tileHash;
+}
+
+
+// Get the bits of a cell index
+static int cell_bits()
+{
+    return bits_needed(mapMain->width*mapMain->height - 1);
+}
+
+
+// Get packed bits
+size_t stage_get_packed_bits()
+{
+    if(mapMain == NULL) return 1;
+
+    int size = mapMain->width*mapMain->height;
+    return 1 + bits_needed(size) + size * (cell_bits() + TILE_ID_BITS*2);
+}
+
+
+// Pack
+void stage_pack(BIT_STREAM* s)
+{
+    bits_write(s,elecOn,1);
+    if(mapMain == NULL) return;
+
+    int size = mapMain->width*mapMain->height;
+    int bits = cell_bits();
+    int count = 0;
+    int i = 0;
+    for(; i < size; ++ i)
+    {
+        if(layerData[i] != startLayer[i] || colMap[i] != startCol[i])
+            ++ count;
+    }
+
+    // The changed cells in order
+    bits_write(s,count,bits_needed(size));
+    for(i = 0; i < size && count > 0; ++ i)
+    {
+        if(layerData[i] == startLayer[i] && colMap[i] == startCol[i])
+            continue;
+
+        bits_write(s,i,bits);
+        bits_write(s,layerData[i],TILE_ID_BITS);
+        bits_write(s,colMap[i],TILE_ID_BITS);
+        -- count;
+    }
+}
+
+
+// Unpack
+void stage_unpack(BIT_STREAM* s)
+{
+    elecOn = bits_read(s,1) != 0;
+    if(mapMain == NULL)
+    {
+        tileHash = compute_hash();
+        tile_changed(-1,-1);
+        return;
+    }
+
+    int size = mapMain->width*mapMain->height;
+    memcpy(layerData,startLayer,size);
+    memcpy(colMap,startCol,size);
+    tileHash = startHash ^ zobrist_key(ZOBRIST_ELECTRICITY,elecOn);
+
+    // Only the changed cells are hashed again
+    int bits = cell_bits();
+    int count = (int)bits_read(s,bits_needed(size));
+    int i;
+    for(; count > 0; -- count)
+    {
+        i = (int)bits_read(s,bits);
+        set_layer_tile(i,(Uint8)bits_read(s,TILE_ID_BITS));
+        set_col_tile(i,(Uint8)bits_read(s,TILE_ID_BITS));
+    }
+
+    tile_changed(-1,-1);
 }
\ No newline at end of file
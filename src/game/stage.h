@@ -1,28 +1,50 @@
 /// Stage (header)
 /// (c) 2018 Jani Nykänen
+///
+/// The tiles of the stage being played, and the rules
+/// that concern them. Drawing is in stagedraw.h
 
 #ifndef __STAGE__
 #define __STAGE__
 
-#include "../engine/assets.h"
+#include "SDL2/SDL.h"
+
 #include "../engine/vector.h"
+#include "../lib/stagefile.h"
+#include "../lib/bitstream.h"
 
 #include "stdbool.h"
+#include "stddef.h"
+
+/// Maximum stage size in tiles
+#define STAGE_MAX_SIZE 16*12
+// The undo history stores the cell indices in a byte
+_Static_assert(STAGE_MAX_SIZE <= 256,"Stage cell indices must fit in a byte");
+
+/// Tile change callback, x and y are -1 when the
+/// whole stage was reset
+typedef void (*TILE_CALLBACK)(int x, int y);
 
 /// Reset stage
 /// < soft Is a soft reset
 void stage_reset(bool soft);
 
-/// Initialize stage
-/// < ass Asset pack
-void stage_init(ASSET_PACK* ass);
+/// Set the stage being played. It is used until reset
+/// < s Stage, must stay valid while it is used
+/// > 0 on success, 1 if the stage is too big
+int stage_set_map(const STAGE* s);
 
-/// Update stage
-/// < tm Time mul.
-void stage_update(float tm);
+/// Get the stage being played
+/// > Stage, NULL if none
+const STAGE* stage_get_map();
 
-/// Draw stage
-void stage_draw();
+/// Get the current tile IDs
+/// > Layer data, a tile per byte in row-major order
+const Uint8* stage_get_layer_data();
+
+/// Set the tile change callback
+/// < cb Callback, may be NULL
+void stage_set_tile_callback(TILE_CALLBACK cb);
 
 /// Player electricity collision, special cases
 /// < p Player
@@ -30,7 +52,7 @@ void stage_player_elec_collision(void* p);
 
 /// Get collision map
 /// > Collision map
-int* stage_get_collision_map();
+Uint8* stage_get_collision_map();
 
 /// Get current map dimensions
 /// > Dimensions
@@ -72,21 +94,62 @@ bool stage_is_lava(int x, int y);
 /// > True or false
 int stage_is_harmful(int x, int y);
 
-/// Set shake timer
-/// < s Shake value
-void stage_set_shake_timer(float s);
-
-/// Set main stage
-/// < name Stage asset name
-void stage_set_main_stage(const char* name);
-
 /// Toggle purple blocks
 void stage_toggle_purple_blocks();
 
 /// Toggle electricity
 void stage_toggle_electricity();
 
+/// Set electricity
+/// < state True, if the on-state electricity tiles are harmful
+void stage_set_electricity(bool state);
+
+/// Is electricity on
+/// > True, if the on-state electricity tiles are harmful
+bool stage_is_electricity_on();
+
+/// Set the tile and the collision tile of a cell
+/// < i Cell index, in row-major order
+/// < id Tile ID
+/// < col Collision tile
+void stage_set_cell(int i, int id, int col);
+
 /// Mutate the stage
 void stage_mutate();
 
+/// Get the size of the stage state
+/// > Size in bytes
+size_t stage_get_state_size();
+
+/// Save the stage state: the tiles, the collision
+/// map and the electricity
+/// < buf Buffer, stage_get_state_size() bytes
+void stage_save_state(void* buf);
+
+/// Load a saved stage state of the same stage
+/// < buf Buffer
+void stage_load_state(const void* buf);
+
+/// Store the current tiles as the start of the stage,
+/// packed states store the tiles that differ from it
+void stage_set_start();
+
+/// Get the hash of the tiles, the collision map and the
+/// electricity. It is updated as they change
+/// > Hash
+Uint64 stage_get_hash();
+
+/// Get the maximum size of a packed stage state
+/// > Size in bits
+size_t stage_get_packed_bits();
+
+/// Pack the stage state: the electricity and the tiles
+/// and collision tiles that differ from the start
+/// < s Stream to write to
+void stage_pack(BIT_STREAM* s);
+
+/// Unpack a stage state packed from the same stage
+/// < s Stream to read from
+void stage_unpack(BIT_STREAM* s);
+
 #endif // __STAGE__
\ No newline at end of file
@@ -0,0 +1,790 @@
+/// Stage drawing (source)
+/// (c) 2018 Jani Nykänen
+
+#include "stagedraw.h"
+
+#include "../engine/graphics.h"
+#include "../engine/sprite.h"
+#include "../lib/stagefile.h"
+
+#include "stage.h"
+#include "status.h"
+
+#include "../global.h"
+
+#include "math.h"
+#include "stdlib.h"
+#include "string.h"
+
+// Maximum amount of baked pieces per tile
+#define MAX_TILE_PIECES 6
+
+// Tile piece kinds
+enum
+{
+    PIECE_STATIC = 0,
+    PIECE_LAVA = 1,
+    PIECE_LAVA_SURFACE = 2,
+    PIECE_ELEC_ON = 3,
+    PIECE_ELEC_OFF = 4,
+};
+
+// A baked piece of a tile (source rect & destination)
+typedef struct
+{
+    Uint8 kind;
+    short sx, sy, sw, sh;
+    short dx, dy;
+}
+TILE_PIECE;
+
+// Bitmaps
+static BITMAP* bmpSky;
+static BITMAP* bmpSky3;
+static BITMAP* bmpClouds;
+static BITMAP* bmpClouds2;
+static BITMAP* bmpTiles;
+static BITMAP* bmpElectricity;
+
+// Stage asset ID, the stage is pinned while it is played
+static int mapId = -1;
+// Layer data of the stage rules
+static const Uint8* layerData;
+// Baked tile pieces, rebuilt only when the layer data changes
+static TILE_PIECE pieces[STAGE_MAX_SIZE][MAX_TILE_PIECES];
+// Piece count per tile
+static Uint8 pieceCount[STAGE_MAX_SIZE];
+
+// Static tile layer, rendered once & patched per cell
+static BITMAP* bmpLayer;
+// Cells of the static layer that need to be redrawn
+static bool cellDirty[STAGE_MAX_SIZE];
+// Does the whole static layer need to be redrawn
+static bool layerDirty;
+// Render target losses when the layer was created
+static Uint32 layerLosses;
+
+// Cloud position
+static float cloudPos;
+// Lava position
+static float lavaPos;
+// Shake timer
+static float shakeTimer;
+
+// Electricity sprite
+static SPRITE sprElec;
+
+
+// Is the tile in (x+dx,y+dy) same as in (x,y)
+static bool is_same_tile(const STAGE* t, int id, int x, int y, int dx, int dy)
+{
+    if(x+dx < 0 || y +dy < 0 || x+dx >= t->width || y+dy >= t->height)
+        return true;
+
+    return id == layerData[(y+dy)*t->width + x + dx];
+}
+
+
+// Add a piece to the tile in x,y
+static void add_piece(const STAGE* t, int x, int y, int kind, int sx, int sy, int sw, int sh, int dx, int dy)
+{
+    int i = y*t->width + x;
+    if(pieceCount[i] >= MAX_TILE_PIECES) return;
+
+    pieces[i][pieceCount[i] ++] = (TILE_PIECE){kind,sx,sy,sw,sh,dx,dy};
+}
+
+
+// Add a 8x8 piece of tile
+static void add_tile_piece(const STAGE* t, int x, int y, int tx, int ty, int dx, int dy)
+{
+    add_piece(t,x,y,PIECE_STATIC,tx*8,ty*8,8,8,dx,dy);
+}
+
+
+// Bake soil tile
+static void bake_tile_soil(const STAGE* t, int x, int y)
+{
+    POINT t11, t12, t21, t22;
+
+    bool leftGreen = false;
+    bool rightGreen = false;
+
+    t11 = point(2,0);
+    t12 = point(0,1);
+    t21 = point(3,0);
+    t22 = point(1,1);
+
+    // Bottom tile is different
+    if(!is_same_tile(t,1,x,y,0,1))
+    {
+        t12 = point(10,0);
+        t22 = point(11,0);
+    }
+
+    // Right tile is different
+    if(!is_same_tile(t,1,x,y,1,0))
+    {
+        t21 = point(5,0);
+        t22 = point(5,1);
+
+        // Bottom
+        if(!is_same_tile(t,1,x,y,0,1))
+        {
+            t22 = point(3,1);
+        }
+    }
+
+    // Left tile is different
+    if(!is_same_tile(t,1,x,y,-1,0))
+    {
+        t11 = point(4,0);
+        t12 = point(4,1);
+
+        // Bottom
+        if(!is_same_tile(t,1,x,y,0,1))
+        {
+            t12 = point(2,1);
+        }
+    }
+
+    // Upper tile is different
+    if(!is_same_tile(t,1,x,y,0,-1))
+    {
+        t11 = point(0,0);
+        t21 = point(1,0);
+
+        // Right
+        if(!is_same_tile(t,1,x,y,1,0))
+        {
+            t21 = point(9,1);
+            rightGreen = true;
+        }
+
+        // Left
+        if(!is_same_tile(t,1,x,y,-1,0))
+        {
+            t11 = point(8,1);
+            leftGreen = true;
+        }
+    }
+
+    // Bottom-right corner
+    if(!is_same_tile(t,1,x,y,1,1) && is_same_tile(t,1,x,y,1,0) 
+        && is_same_tile(t,1,x,y,0,1))
+    {
+        t22 = point(8,0);
+    }
+
+    // Bottom-left corner
+    if(!is_same_tile(t,1,x,y,-1,1) && is_same_tile(t,1,x,y,-1,0) 
+        && is_same_tile(t,1,x,y,0,1))
+    {
+        t12 = point(9,0);
+    }
+
+    // Top-right corner
+    if(!is_same_tile(t,1,x,y,1,-1) && is_same_tile(t,1,x,y,1,0) 
+        && is_same_tile(t,1,x,y,0,-1))
+    {
+        t21 = point(6,1);
+    }
+
+    // Top-left corner
+    if(!is_same_tile(t,1,x,y,-1,-1) && is_same_tile(t,1,x,y,-1,0) 
+        && is_same_tile(t,1,x,y,0,-1))
+    {
+        t11 = point(7,1);
+    }
+
+    // Store tile pieces
+    add_tile_piece(t,x,y,t11.x,t11.y,x*16,y*16);
+    add_tile_piece(t,x,y,t21.x,t21.y,x*16 + 8,y*16);
+    add_tile_piece(t,x,y,t12.x,t12.y,x*16,y*16 + 8);
+    add_tile_piece(t,x,y,t22.x,t22.y,x*16 + 8,y*16 + 8);
+
+    if(leftGreen)
+        add_tile_piece(t,x,y,6,0,x*16 - 8,y*16);
+    if(rightGreen)
+        add_tile_piece(t,x,y,7,0,x*16 +16,y*16);
+}
+
+
+// Bake vine
+static void bake_vine(const STAGE* t, int x, int y)
+{
+    int sx1 = 96;
+    int sx2 = 96;
+    int sy1 = 0;
+    int sy2 = 8;
+
+    // Above
+    if(!is_same_tile(t,2,x,y,0,-1) && !is_same_tile(t,1,x,y,0,-1))
+    {
+        sx1 += 16;
+    }
+
+    // Below
+    if(!is_same_tile(t,2,x,y,0,1) && !is_same_tile(t,1,x,y,0,1))
+    {
+        sx2 += 16;
+    }
+
+    // Upper part
+    add_piece(t,x,y,PIECE_STATIC,sx1,sy1,16,8,x*16,y*16);
+    // Bottom part
+    add_piece(t,x,y,PIECE_STATIC,sx2,sy2,16,8,x*16,y*16 + 8);
+}
+
+
+// Bake spikes
+static void bake_spikes(const STAGE* t, int x, int y)
+{
+    add_piece(t,x,y,PIECE_STATIC,144,0,16,8,x*16,y*16);
+
+    // Left
+    if(!is_same_tile(t,4,x,y,-1,0) && !is_same_tile(t,1,x,y,-1,0))
+    {
+        add_piece(t,x,y,PIECE_STATIC,144,8,8,8,x*16,y*16 + 8);
+    }
+    else
+    {
+        if(is_same_tile(t,4,x,y,-1,0))
+            add_piece(t,x,y,PIECE_STATIC,144,8,8,8,x*16,y*16 + 8);
+        else
+            add_piece(t,x,y,PIECE_STATIC,160,0,8,8,x*16,y*16 + 8);
+    }
+
+    // Right
+    if(!is_same_tile(t,4,x,y,1,0) && !is_same_tile(t,1,x,y,1,0))
+    {
+        add_piece(t,x,y,PIECE_STATIC,152,8,8,8,x*16 + 8,y*16 + 8);
+    }
+    else
+    {
+        add_piece(t,x,y,PIECE_STATIC,168,8,8,8,x*16+8,y*16 + 8);
+    }
+}
+
+
+// Bake lava
+static void bake_lava(const STAGE* t, int x, int y, int type)
+{
+    int i = 0;
+
+    add_piece(t,x,y,PIECE_LAVA,128+112*type,8,16,8,x*16, y*16+8);
+    if(!is_same_tile(t,3 +type*17,x,y,0,-1))
+    {
+        // The surface is moved by the lava position when drawn
+        for(; i < 2; ++ i)
+        {
+            add_piece(t,x,y,PIECE_LAVA_SURFACE,128+112*type,0,16,8,x*16 + i*16, y*16);
+        }
+    }
+    else
+    {
+        add_piece(t,x,y,PIECE_LAVA,128+112*type,8,16,8,x*16, y*16);
+    }
+}
+
+
+// Bake an "other kind of" solid object, like lock
+static void bake_other_solid(const STAGE* t,int id, int x, int y, int dx, int dy)
+{
+    POINT t11, t12, t21, t22;
+
+    t11 = point(6+dx,dy);
+    t12 = point(6+dx,dy+1);
+    t21 = point(6+dx+1,dy);
+    t22 = point(6+dx+1,dy+1);
+
+    // Free directions
+    bool bottom = (!is_same_tile(t,1,x,y,0,1) && !is_same_tile(t,id,x,y,0,1));
+    bool top = (!is_same_tile(t,1,x,y,0,-1) && !is_same_tile(t,id,x,y,0,-1));
+    bool left = (!is_same_tile(t,1,x,y,-1,0) && !is_same_tile(t,id,x,y,-1,0));
+    bool right = (!is_same_tile(t,1,x,y,1,0) && !is_same_tile(t,id,x,y,1,0));
+
+    // Bottom
+    if(bottom)
+    {
+        if(left)
+            t12 = point(dx,dy+1);
+        else
+            t12 = point(dx+4,dy+1);
+
+        if(right)
+            t22 = point(dx+1,dy+1);
+        else
+            t22 = point(dx+5,dy+1);
+    }
+    else
+    {
+        if(left)
+            t12 = point(dx+2,dy+1);
+
+        if(right)
+            t22 = point(dx+3,dy+1);
+    }
+
+    // Top
+    if(top)
+    {
+        if(left)
+            t11 = point(dx,dy);
+        else
+            t11 = point(dx+4,dy);
+
+        if(right)
+            t21 = point(dx+1,dy);
+        else
+            t21 = point(dx+5,dy);
+    }
+    else
+    {
+        if(left)
+            t11 = point(dx+2,dy);
+
+        if(right)
+            t21 = point(dx+3,dy);
+    }
+
+    // Store tile pieces
+    add_tile_piece(t,x,y,t11.x,t11.y,x*16,y*16);
+    add_tile_piece(t,x,y,t21.x,t21.y,x*16 + 8,y*16);
+    add_tile_piece(t,x,y,t12.x,t12.y,x*16,y*16 + 8);
+    add_tile_piece(t,x,y,t22.x,t22.y,x*16 + 8,y*16 + 8);
+}
+
+
+// Bake a single tile
+static void bake_tile(const STAGE* t, int x, int y)
+{
+    int id = layerData[y*t->width + x];
+    pieceCount[y*t->width + x] = 0;
+
+    // Pieces may hang over to the horizontal neighbours
+    int i = x-1;
+    for(; i <= x+1; ++ i)
+    {
+        if(i >= 0 && i < t->width)
+            cellDirty[y*t->width + i] = true;
+    }
+
+    switch(id)
+    {
+    case 1:
+        bake_tile_soil(t,x,y);
+        break;
+    case 2:
+        bake_vine(t,x,y);
+        break;
+    case 3:
+    case 20:
+        bake_lava(t,x,y,id == 3 ? 0 : 1);
+        break;
+    case 4:
+        bake_spikes(t,x,y);
+        break;
+    case 5:
+        bake_other_solid(t,5,x,y,0,2);
+        break;
+    case 6:
+        bake_other_solid(t,6,x,y,22,0);
+        break;
+    case 17:
+        bake_other_solid(t,17,x,y,8,2);
+        break;
+    case 18:
+        add_piece(t,x,y,PIECE_STATIC,128,16,16,16,x*16,y*16);
+        break;
+    case 21:
+        bake_other_solid(t,21,x,y,18,2);
+        break;
+
+    // Electricity frame & visibility are resolved when drawn
+    case 22:
+    case 23:
+        add_piece(t,x,y,PIECE_ELEC_ON,0,(id == 23)*16,16,16,x*16,y*16);
+        break;
+    case 24:
+    case 25:
+        add_piece(t,x,y,PIECE_ELEC_OFF,0,(id == 25)*16,16,16,x*16,y*16);
+        break;
+
+    default:
+        break;
+    }
+}
+
+
+// Bake the whole map
+static void bake_map(const STAGE* t)
+{
+    int x = 0;
+    int y = 0;
+
+    for(y=0; y < t->height; ++ y)
+    {
+        for(x=0; x < t->width; ++ x)
+        {
+            bake_tile(t,x,y);
+        }
+    }
+}
+
+
+// Re-bake the tile in x,y and its neighbours
+static void bake_neighbourhood(const STAGE* t, int x, int y)
+{
+    int dx = 0;
+    int dy = 0;
+
+    for(dy = y-1; dy <= y+1; ++ dy)
+    {
+        for(dx = x-1; dx <= x+1; ++ dx)
+        {
+            if(dx < 0 || dy < 0 || dx >= t->width || dy >= t->height)
+                continue;
+
+            bake_tile(t,dx,dy);
+        }
+    }
+}
+
+
+// Draw a baked piece
+static void draw_piece(TILE_PIECE* p, int lpos, int lposy)
+{
+    switch(p->kind)
+    {
+    case PIECE_LAVA_SURFACE:
+        draw_bitmap_region(bmpTiles,p->sx,p->sy,p->sw,p->sh,p->dx + lpos,p->dy + lposy,0);
+        break;
+
+    case PIECE_ELEC_ON:
+    case PIECE_ELEC_OFF:
+        if(stage_is_electricity_on() != (p->kind == PIECE_ELEC_ON)) break;
+        draw_bitmap_region(bmpElectricity,p->sx + sprElec.frame*16,p->sy,p->sw,p->sh,p->dx,p->dy,0);
+        break;
+
+    default:
+        draw_bitmap_region(bmpTiles,p->sx,p->sy,p->sw,p->sh,p->dx,p->dy,0);
+        break;
+    }
+}
+
+
+// Draw the static pieces inside the cell x,y
+static void draw_layer_cell(const STAGE* t, int x, int y)
+{
+    int i = x-1;
+    int j = 0;
+    TILE_PIECE* p;
+
+    for(; i <= x+1; ++ i)
+    {
+        if(i < 0 || i >= t->width) continue;
+
+        for(j = 0; j < pieceCount[y*t->width + i]; ++ j)
+        {
+            p = &pieces[y*t->width + i][j];
+            if(p->kind == PIECE_STATIC 
+                && p->dx >= x*16 && p->dx < x*16 + 16)
+            {
+                draw_piece(p,0,0);
+            }
+        }
+    }
+}
+
+
+// Does the cell have electricity pieces
+static bool has_elec(int cell)
+{
+    int j = 0;
+    for(; j < pieceCount[cell]; ++ j)
+    {
+        if(pieces[cell][j].kind == PIECE_ELEC_ON || pieces[cell][j].kind == PIECE_ELEC_OFF)
+            return true;
+    }
+    return false;
+}
+
+
+// Draw the animated tiles below the static layer
+static void draw_lava_overlay(const STAGE* t)
+{
+    int i = 0;
+    int j = 0;
+    int count = t->width * t->height;
+    TILE_PIECE* p;
+
+    int lpos = (int)round(lavaPos) % 16;
+    int lposy = (int)round(sin(lavaPos / 2.0f) * 1.0f) +1;
+
+    for(i = 0; i < count; ++ i)
+    {
+        for(j = 0; j < pieceCount[i]; ++ j)
+        {
+            p = &pieces[i][j];
+            if(p->kind == PIECE_LAVA || p->kind == PIECE_LAVA_SURFACE)
+                draw_piece(p,lpos,lposy);
+        }
+    }
+}
+
+
+// Draw the animated tiles above the static layer
+static void draw_elec_overlay(const STAGE* t)
+{
+    int i = 0;
+    int j = 0;
+    int count = t->width * t->height;
+    TILE_PIECE* p;
+
+    // The electricity cells do not overlap, so they are
+    // drawn first and batched together
+    for(i = 0; i < count; ++ i)
+    {
+        for(j = 0; j < pieceCount[i]; ++ j)
+        {
+            p = &pieces[i][j];
+            if(p->kind == PIECE_ELEC_ON || p->kind == PIECE_ELEC_OFF)
+                draw_piece(p,0,0);
+        }
+    }
+
+    // The grass of the tile on the right of an electricity
+    // cell overhangs it, and stays inside it
+    for(i = 0; i < count; ++ i)
+    {
+        if((i+1) % t->width == 0 || !has_elec(i)) continue;
+
+        for(j = 0; j < pieceCount[i+1]; ++ j)
+        {
+            p = &pieces[i+1][j];
+            if(p->kind == PIECE_STATIC && p->dx < (i % t->width + 1) * 16)
+                draw_piece(p,0,0);
+        }
+    }
+}
+
+
+// Draw stage background
+static void draw_background()
+{
+    BITMAP* bsky = status_get_if_final() ? bmpSky3 : bmpSky;
+    BITMAP* bclouds = status_get_if_final() ? bmpClouds2 : bmpClouds;
+
+    int i = 0;
+
+    draw_bitmap(bsky,0,0,0);
+    for(; i < 2; ++ i)
+    {
+        draw_bitmap(bclouds,(int)round(cloudPos + i * 256),192 - bclouds->h,0);
+    }
+}
+
+
+// Tiles changed
+static void on_tile_change(int x, int y)
+{
+    const STAGE* t = stage_get_map();
+
+    // The whole stage is reset
+    if(x < 0)
+    {
+        cloudPos = 0.0f;
+        lavaPos = 0.0f;
+        shakeTimer = 0.0f;
+
+        if(t == NULL) return;
+
+        bake_map(t);
+        layerDirty = true;
+        return;
+    }
+
+    bake_neighbourhood(t,x,y);
+}
+
+
+// Initialize stage
+void stage_init(ASSET_PACK* ass)
+{
+    // Get assets
+    bmpSky = (BITMAP*)get_asset(ass,"sky1");
+    bmpSky3 = (BITMAP*)get_asset(ass,"sky3");
+    bmpClouds = (BITMAP*)get_asset(ass,"clouds1");
+    bmpClouds2 = (BITMAP*)get_asset(ass,"clouds2");
+    bmpTiles = (BITMAP*)get_asset(ass,"tiles1");
+    bmpElectricity = (BITMAP*)get_asset(ass,"electricity");
+
+    // Create components
+    sprElec = create_sprite(16,16);
+
+    layerData = stage_get_layer_data();
+    bmpLayer = NULL;
+    layerDirty = true;
+    layerLosses = get_render_target_losses();
+
+    // Rebake when the rules change the tiles
+    stage_set_tile_callback(on_tile_change);
+    // Reset values
+    stage_set_map(NULL);
+    stage_reset(true);
+}
+
+
+// Update stage
+void stage_update(float tm)
+{
+    const float CLOUD_SPEED = 0.5f;
+    const float LAVA_SPEED = 0.125f;
+
+    // Update cloud position
+    cloudPos -= CLOUD_SPEED * tm;
+    if(cloudPos <= -bmpClouds->w)
+    {
+        cloudPos += bmpClouds->w;
+    }
+
+    // Update lava position
+    lavaPos -= LAVA_SPEED * tm;
+    if(lavaPos <= -M_PI*2 * 16.0f)
+    {
+        lavaPos += M_PI*2 * 16.0f;
+    }
+
+    // Update shake timer
+    if(shakeTimer > 0.0f)
+    {
+        shakeTimer -= 1.0f * tm;
+    }
+
+    // Update electricity sprite
+    spr_animate(&sprElec,0,0,2,5,tm);
+}
+
+
+// Update layer
+void stage_update_layer()
+{
+    const STAGE* t = stage_get_map();
+    if(t == NULL) return;
+
+    // The cells stay dirty until the tiles are loaded
+    if(bmpTiles->asset != NULL && !use_asset(bmpTiles->asset)) return;
+
+    int x = 0;
+    int y = 0;
+
+    // (Re)create the layer if the map size changed, or if
+    // the render targets lost their contents
+    if(bmpLayer == NULL || bmpLayer->w != t->pwidth || bmpLayer->h != t->pheight
+     || layerLosses != get_render_target_losses())
+    {
+        layerLosses = get_render_target_losses();
+        destroy_bitmap(bmpLayer);
+        bmpLayer = create_target_bitmap(t->pwidth,t->pheight);
+        if(bmpLayer == NULL) return;
+
+        layerDirty = true;
+    }
+
+    set_render_target(bmpLayer);
+    translate(0,0);
+
+    if(layerDirty)
+    {
+        clear_region(0,0,bmpLayer->w,bmpLayer->h);
+    }
+
+    for(y=0; y < t->height; ++ y)
+    {
+        for(x=0; x < t->width; ++ x)
+        {
+            if(!layerDirty && !cellDirty[y*t->width + x])
+                continue;
+
+            if(!layerDirty)
+                clear_region(x*16,y*16,16,16);
+
+            draw_layer_cell(t,x,y);
+            cellDirty[y*t->width + x] = false;
+        }
+    }
+    layerDirty = false;
+
+    set_render_target(NULL);
+}
+
+
+// Draw stage
+void stage_draw()
+{
+    const STAGE* t = stage_get_map();
+    if(t == NULL) return;
+
+    if(shakeTimer > 0.0f)
+    {
+        int shakex = rand() % 7 - 3;
+        int shakey = rand() % 7 - 3;
+
+        translate(shakex,shakey);
+    }
+    else
+    {
+        translate(0,0);
+    }
+
+    draw_background();
+    draw_lava_overlay(t);
+    if(bmpLayer != NULL)
+        draw_bitmap(bmpLayer,0,0,0);
+    draw_elec_overlay(t);
+
+    translate(0,0);
+}
+
+
+// Set shake timer value
+void stage_set_shake_timer(float s)
+{
+    shakeTimer = s;
+}
+
+
+// Get the main stage asset
+static void get_main_stage(ASSET_PACK* ass)
+{
+    // The stage buffers have a fixed size
+    if(stage_set_map((STAGE*)get_asset_by_id(ass,mapId)) != 0)
+    {
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Stage is too big!\n",NULL);
+    }
+}
+
+
+// Set stage name
+void stage_set_main_stage(const char* name)
+{
+    ASSET_PACK* ass = get_global_assets();
+    unpin_assets(ass,&mapId,1);
+    mapId = get_asset_id(ass,name);
+    pin_assets(ass,&mapId,1);
+    get_main_stage(ass);
+}
+
+
+// Asset reloaded
+bool stage_on_reload(int id)
+{
+    // Tiles are drawn again in any case,
+    // their bitmap might have changed
+    layerDirty = true;
+    if(mapId < 0 || id != mapId) return false;
+
+    get_main_stage(get_global_assets());
+    return stage_get_map() != NULL;
+}
@@ -0,0 +1,42 @@
+/// Stage drawing (header)
+/// (c) 2018 Jani Nykänen
+///
+/// Draws the stage of the rules in stage.h, and
+/// sets it from the stage assets
+
+#ifndef __STAGE_DRAW__
+#define __STAGE_DRAW__
+
+#include "../engine/assets.h"
+
+#include "stdbool.h"
+
+/// Initialize stage drawing
+/// < ass Asset pack
+void stage_init(ASSET_PACK* ass);
+
+/// Update stage animations
+/// < tm Time mul.
+void stage_update(float tm);
+
+/// Redraw the changed parts of the static tile layer, before
+/// the frame is drawn. It is a render target of its own
+void stage_update_layer();
+
+/// Draw stage
+void stage_draw();
+
+/// Set shake timer
+/// < s Shake value
+void stage_set_shake_timer(float s);
+
+/// Set main stage
+/// < name Stage asset name
+void stage_set_main_stage(const char* name);
+
+/// Called when an asset is reloaded in the development mode
+/// < id Asset ID
+/// > True, if the main stage changed and must be reset
+bool stage_on_reload(int id);
+
+#endif // __STAGE_DRAW__
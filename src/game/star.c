@@ -3,18 +3,13 @@
 
 #include "star.h"
 
-#include "../engine/graphics.h"
-
 #include "player.h"
-#include "status.h"
+#include "hooks.h"
 
 #include "stdio.h"
 #include "stdlib.h"
 #include "math.h"
 
-// Star bitmap
-static BITMAP* bmpStar;
-
 
 // Player collision
 static void star_player_collision(void * o, void * p)
@@ -36,7 +31,7 @@ static void star_player_collision(void * o, void * p)
         pl->vpos.x = pl->x*16.0f;
         pl->vpos.y = pl->y*16.0f;
 
-        status_activate_victory();
+        raise_event(EVENT_VICTORY);
 
     }
 }
@@ -53,18 +48,18 @@ static void star_update(void* o, float tm)
     if(s->floatTimer > 2 * M_PI)
         s->floatTimer -= 2 * M_PI;
 
-    // Animate
-    spr_animate(&s->spr,status_star_type(),11,0,4,tm);
+    // Animate, the row is picked when drawn
+    spr_animate(&s->spr,0,11,0,4,tm);
 }
 
 
-// Draw Star
-static void star_draw(void* o)
+// Is the star idle
+static bool star_is_idle(void* o, void* p)
 {
     STAR* s = (STAR*)o;
+    PLAYER* pl = (PLAYER*)p;
 
-    spr_draw(&s->spr,bmpStar,
-        (int)round(s->vpos.x),(int)round(s->vpos.y + cos(s->floatTimer)),0);
+    return s->collected || !s->exist || pl->x != s->x || pl->y != s->y;
 }
 
 
@@ -76,26 +71,20 @@ static void star_reset(void* o)
     s->floatTimer = 0.0f;
 }
 
-// Initialize
-void star_init(ASSET_PACK* ass)
-{
-    bmpStar = (BITMAP*)get_asset(ass,"star");
-}
-
-
 // Create a new Star
 STAR star_create(int x, int y)
 {
     STAR s;
 
+    s.type = OBJ_STAR;
     s.x = x;
     s.y = y;
     s.vpos = vec2(x*16.0f,y*16.0f);
     s.spr = create_sprite(16,16);
-    s.onDraw = star_draw;
     s.onUpdate = star_update;
     s.onPlayerCollision = star_player_collision;
     s.onReset = star_reset;
+    s.onIsIdle = star_is_idle;
     s.preventMovement = false;
     s.exist = true;
     s.collected = false;
@@ -5,7 +5,6 @@
 #define __STAR__
 
 #include "../engine/sprite.h"
-#include "../engine/assets.h"
 
 #include "obase.h"
 
@@ -18,10 +17,6 @@ EXTENDS_GAME_OBJECT
 
 AS ( STAR );
 
-/// Initialize stars
-/// < ass Assets
-void star_init(ASSET_PACK* ass);
-
 /// Create a new star
 /// < x X coordinate (in grid)
 /// < y Y coordinate (in grid)
@@ -12,7 +12,7 @@
 #include "../savedata.h"
 
 #include "game.h"
-#include "stage.h"
+#include "progress.h"
 
 #include "stdlib.h"
 #include "math.h"
@@ -44,8 +44,6 @@ static MUSIC* mClear;
 static SAMPLE* sAccept;
 static SAMPLE* sSelect;
 
-// Key count
-static int keyCount;
 // Previous key count
 static int prevKeyCount;
 // Key remove pos
@@ -53,8 +51,6 @@ static float keyRemovePos;
 // Is removing a key
 static bool removingKey;
 
-// Turn count
-static int turnCount;
 // Target turns
 static int turnTarget;
 // Turn string
@@ -141,27 +137,10 @@ static void draw_menu(int tx, int ty)
     fill_rect(menux +1,menuy +1,menuw-2,menuh-2,rgb(0,0,0));
     fill_rect(menux +2,menuy +2,menuw-4,menuh-4,rgb(85,85,85));
 
-    // Draw black outlines
-    int x = 0;
-    int y = 0;
-    set_bitmap_color(bmpFont,rgb(0,0,0));
-    for(y = -1; y <= 1; ++ y)
-    {
-        for(x = -1; x <= 1; ++ x)
-        {
-            
-            if(x == y && x == 0) continue;
-
-            draw_text(bmpFont,(Uint8*)"Stage Selection",-1,tx+x,ty+y,-1,0,false);
-            draw_text(bmpFont,(Uint8*)"Play Again",-1,tx+x,ty+y + YOFF,-1,0,false);
-        }
-    }
-
+    // Draw text
     set_bitmap_color(bmpFont,rgb(255,255,255));
-
-    // Draw white text
-    draw_text(bmpFont,(Uint8*)"Stage Selection",-1,tx,ty,-1,0,false);
-    draw_text(bmpFont,(Uint8*)"Play Again",-1,tx,ty + YOFF,-1,0,false);
+    draw_text_with_borders(bmpFont,(Uint8*)"Stage Selection",-1,tx,ty,-1,0,false);
+    draw_text_with_borders(bmpFont,(Uint8*)"Play Again",-1,tx,ty + YOFF,-1,0,false);
 
     // Draw cursor
     draw_bitmap_region(bmpIcons,16,0,16,16, tx-18 + (int)round(sin(cursorWave)),ty-5 + cursorPos*(YOFF +1),0);
@@ -171,7 +150,7 @@ static void draw_menu(int tx, int ty)
 // Draw victory
 static void draw_victory()
 {
-    int starType = (turnCount <= turnTarget) ? 1 : 0;
+    int starType = (progress_get_turn_count() <= turnTarget) ? 1 : 0;
 
     float t = 1.0f;
     if(vicPhase == 0)
@@ -221,14 +200,12 @@ void status_init(ASSET_PACK* ass)
 void status_reset(bool soft)
 {
     // Set default values
-    keyCount = 0;
     prevKeyCount = 0;
     removingKey = false;
     keyRemovePos = 0.0f;
     vicTimer = 0.0f;
     vicPhase = 0;
     victory = false;
-    turnCount = 0;
     cursorPos = 0;
     cursorWave = 0.0f;
 
@@ -239,7 +216,10 @@ void status_reset(bool soft)
     }
     else
     {
-        snprintf(turnString,TURN_STRING_SIZE,"%d/%d",turnCount,turnTarget);
+        snprintf(turnString,TURN_STRING_SIZE,"%d/%d",progress_get_turn_count(),turnTarget);
+
+        // Decoded ahead, so the victory is heard on time
+        prefetch_music(mClear,1);
     }
 }
 
@@ -249,6 +229,8 @@ void status_update(float tm)
 {
     const float REMOVE_SPEED = 1.0f;
 
+    int keyCount = progress_get_key_count();
+
     // If victory, no need to update the status, just update
     // the victory screen
     if(victory)
@@ -273,7 +255,7 @@ void status_update(float tm)
 
     prevKeyCount = keyCount;
 
-    snprintf(turnString,TURN_STRING_SIZE,"%d/%d",turnCount,turnTarget);
+    snprintf(turnString,TURN_STRING_SIZE,"%d/%d",progress_get_turn_count(),turnTarget);
     
 }
 
@@ -283,11 +265,15 @@ void status_draw()
 {
     int i = 0;
 
+    // The items of the status row do not overlap,
+    // so they can be grouped by texture
+    set_draw_layer(LAYER_HUD,true);
+
     // Draw stage name
     draw_text_with_borders(bmpFont,(Uint8*)stageName,-1,128,4,0,0,true);
 
     // Draw keys
-    for(; i < keyCount; ++ i)
+    for(; i < progress_get_key_count(); ++ i)
     {
         draw_bitmap_region(bmpKey,0,0,16,16,2 + i*13,4,0);
     }
@@ -300,14 +286,16 @@ void status_draw()
     draw_bitmap_region(bmpIcons,0,0,16,16,192,0,0);
 
     // If turn count pass turn target
-    if(turnCount > turnTarget)
+    if(progress_get_turn_count() > turnTarget)
         set_bitmap_color(bmpFont,rgb(255,0,0));
         
     draw_text_with_borders(bmpFont,(Uint8*)turnString,-1,210,5,-1,0,false);
 
     set_bitmap_color(bmpFont,rgb(255,255,255));
 
-    // Draw victory, if victorous
+    // Draw victory, if victorous. It slides over
+    // the stage, so the order is kept
+    set_draw_layer(LAYER_HUD,false);
     if(victory)
     {
         draw_victory();
@@ -315,28 +303,6 @@ void status_draw()
 }
 
 
-// Add key
-void status_add_key()
-{
-    ++ keyCount;
-}
-
-
-// Remove key
-void status_remove_key()
-{
-    if(keyCount > 0)
-        -- keyCount;
-}
-
-
-// Get key count
-int status_get_key_count()
-{
-    return keyCount;
-}
-
-
 // Set name
 void status_set_stage_name(const char* name)
 {
@@ -344,14 +310,6 @@ void status_set_stage_name(const char* name)
 }
 
 
-// Add turn
-void status_add_turn()
-{
-    ++ turnCount;
-    stage_toggle_electricity();
-}
-
-
 // Set turn target
 void status_set_turn_target(int target)
 {
@@ -366,13 +324,13 @@ void status_activate_victory()
     vicTimer = 0.0f;
     vicPhase = 0;
 
-    stop_music();
+    // Crossfades from the stage music
     play_music(mClear,0.60f,1);
 
     // Set stage completion state to the save data
     SAVEDATA* sd = get_global_save_data();
     int s = sd->stages[stageIndex];
-    int t = turnCount <= turnTarget ? 2 : 1;
+    int t = progress_get_turn_count() <= turnTarget ? 2 : 1;
     if(t > s) sd->stages[stageIndex] = t;
 }
 
@@ -387,7 +345,7 @@ bool status_is_victory()
 // Get the start type
 int status_star_type()
 {
-    return (turnCount <= turnTarget) ? 0 : 1;
+    return (progress_get_turn_count() <= turnTarget) ? 0 : 1;
 }
 
 
@@ -0,0 +1,53 @@
+/// Tile properties (source)
+/// (c) 2018 Jani Nykänen
+
+#include "tiles.h"
+
+// Property flags per tile ID
+static const unsigned char properties[] =
+{
+    0,                          // 0 empty
+    TILE_SOLID,                 // 1 soil
+    TILE_VINE,                  // 2 vine
+    TILE_LAVA,                  // 3 lava
+    TILE_SOLID,                 // 4 spikes
+    TILE_SOLID,                 // 5
+    TILE_SOLID | TILE_SPAWN,    // 6
+    TILE_SPAWN,                 // 7
+    TILE_SPAWN,                 // 8
+    TILE_SPAWN,                 // 9
+    TILE_SPAWN,                 // 10
+    TILE_SPAWN,                 // 11
+    TILE_SPAWN,                 // 12
+    TILE_SPAWN,                 // 13
+    TILE_SPAWN,                 // 14
+    TILE_SPAWN,                 // 15
+    0,                          // 16
+    TILE_SOLID,                 // 17 purple block
+    0,                          // 18 purple block, passable
+    TILE_SPAWN,                 // 19
+    TILE_LAVA,                  // 20 lava, toggles with 21
+    TILE_SOLID,                 // 21
+    0,                          // 22 electricity
+    0,                          // 23
+    0,                          // 24
+    0,                          // 25
+    TILE_SPAWN,                 // 26
+};
+
+
+// Get tile properties
+int tile_properties(int id)
+{
+    if(id < 0 || id >= (int)sizeof(properties))
+        return 0;
+
+    return properties[id];
+}
+
+
+// Is a tile an object spawn
+bool is_spawn_tile(int id)
+{
+    return (tile_properties(id) & TILE_SPAWN) != 0;
+}
@@ -0,0 +1,31 @@
+/// Tile properties (header)
+/// (c) 2018 Jani Nykänen
+
+#ifndef __TILES__
+#define __TILES__
+
+#include "stdbool.h"
+
+/// Tile property flags
+enum
+{
+    TILE_SOLID = 1,
+    TILE_VINE = 2,
+    TILE_LAVA = 4,
+    TILE_SPAWN = 8,
+};
+
+/// Bits needed for a tile ID, the IDs are below 32
+#define TILE_ID_BITS 5
+
+/// Get tile properties
+/// < id Tile ID
+/// > Property flags
+int tile_properties(int id);
+
+/// Is a tile an object spawn
+/// < id Tile ID
+/// > True, if the tile is replaced with an object
+bool is_spawn_tile(int id);
+
+#endif // __TILES__
@@ -0,0 +1,287 @@
+/// Undo history (source)
+/// (c) 2018 Jani Nykänen
+
+#include "undo.h"
+
+#include "stage.h"
+#include "objects.h"
+#include "progress.h"
+
+#include "string.h"
+
+// Maximum amount of turns remembered
+#define UNDO_TURNS 512
+// Size of the arena of the changes, enough
+// for hundreds of turns
+#define UNDO_ARENA_SIZE 16384
+
+// A changed cell, before and after the turn. The
+// cell indices fit in a byte
+typedef struct
+{
+    Uint8 cell;
+    Uint8 id[2];
+    Uint8 col[2];
+}
+CELL_CHANGE;
+
+// A changed object, before and after the turn
+typedef struct
+{
+    Uint32 word[2];
+    Uint8 index;
+}
+OBJ_CHANGE;
+
+// A recorded turn. Its changed objects and
+// cells are stored in the arena
+typedef struct
+{
+    size_t pos;
+    size_t size;
+    int objCount;
+    int cellCount;
+    PROGRESS_STATE progress[2];
+    bool elecOn[2];
+}
+TURN;
+
+// Turns, a ring buffer
+static TURN turns[UNDO_TURNS];
+// The oldest turn
+static int first;
+// Turns recorded
+static int count;
+// Turns not taken back
+static int cursor;
+// Changes, a ring buffer
+static Uint8 arena[UNDO_ARENA_SIZE];
+
+// The state after the last turn not taken back
+static Uint8 layer[STAGE_MAX_SIZE];
+static Uint8 col[STAGE_MAX_SIZE];
+static Uint32 words[MAX_OBJ+1];
+static PROGRESS_STATE progress;
+static bool elecOn;
+
+
+// Get a turn, 0 is the oldest
+static TURN* get_turn(int i)
+{
+    return &turns[(first + i) % UNDO_TURNS];
+}
+
+
+// Forget the oldest turn
+static void drop_oldest()
+{
+    first = (first + 1) % UNDO_TURNS;
+    -- count;
+    -- cursor;
+}
+
+
+// Store the current state as the state after the last turn
+static void store_current()
+{
+    POINT dim = stage_get_map_size();
+    int size = dim.x*dim.y;
+    memcpy(layer,stage_get_layer_data(),size);
+    memcpy(col,stage_get_collision_map(),size);
+
+    int i = 0;
+    for(; i < obj_count(); ++ i)
+    {
+        words[i] = obj_get_word(i);
+    }
+    words[MAX_OBJ] = obj_get_word(MAX_OBJ);
+
+    progress_save_state(&progress);
+    elecOn = stage_is_electricity_on();
+}
+
+
+// Find room for the changes of a turn. The oldest
+// turns are forgotten if they are in the way
+static size_t reserve(size_t size)
+{
+    TURN* t;
+    size_t pos = 0;
+    if(count > 0)
+    {
+        t = get_turn(count-1);
+        pos = t->pos + t->size;
+    }
+    if(pos + size > UNDO_ARENA_SIZE)
+        pos = 0;
+
+    while(count > 0)
+    {
+        t = get_turn(0);
+        if(t->pos >= pos + size || pos >= t->pos + t->size)
+            break;
+
+        drop_oldest();
+    }
+    return pos;
+}
+
+
+// Put back the state before (0) or after (1) a turn. Only
+// the changes are applied
+static void apply(const TURN* t, int side)
+{
+    const Uint8* p = arena + t->pos;
+    OBJ_CHANGE o;
+    CELL_CHANGE c;
+
+    int i = 0;
+    for(; i < t->objCount; ++ i)
+    {
+        memcpy(&o,p,sizeof(OBJ_CHANGE));
+        p += sizeof(OBJ_CHANGE);
+
+        obj_set_word(o.index,o.word[side]);
+        words[o.index] = o.word[side];
+    }
+
+    for(i = 0; i < t->cellCount; ++ i)
+    {
+        memcpy(&c,p,sizeof(CELL_CHANGE));
+        p += sizeof(CELL_CHANGE);
+
+        stage_set_cell(c.cell,c.id[side],c.col[side]);
+        layer[c.cell] = c.id[side];
+        col[c.cell] = c.col[side];
+    }
+
+    progress = t->progress[side];
+    progress_load_state(&progress);
+    elecOn = t->elecOn[side];
+    stage_set_electricity(elecOn);
+}
+
+
+// Reset
+void undo_reset()
+{
+    first = 0;
+    count = 0;
+    cursor = 0;
+
+    store_current();
+}
+
+
+// Record
+void undo_record()
+{
+    if(progress_get_turn_count() == progress.turns)
+        return;
+
+    static OBJ_CHANGE objs[MAX_OBJ+1];
+    static CELL_CHANGE cells[STAGE_MAX_SIZE];
+    int objCount = 0;
+    int cellCount = 0;
+
+    // Compare to the state after the last turn
+    Uint32 w;
+    int i = 0;
+    for(; i <= obj_count(); ++ i)
+    {
+        int index = i < obj_count() ? i : MAX_OBJ;
+        w = obj_get_word(index);
+        if(w == words[index]) continue;
+
+        objs[objCount ++] = (OBJ_CHANGE){{words[index],w},(Uint8)index};
+    }
+
+    POINT dim = stage_get_map_size();
+    const Uint8* curLayer = stage_get_layer_data();
+    const Uint8* curCol = stage_get_collision_map();
+    for(i = 0; i < dim.x*dim.y; ++ i)
+    {
+        if(curLayer[i] == layer[i] && curCol[i] == col[i])
+            continue;
+
+        cells[cellCount ++] = (CELL_CHANGE){(Uint8)i,
+            {layer[i],curLayer[i]},{col[i],curCol[i]}};
+    }
+
+    // The turns taken back cannot be taken again
+    // after a new one
+    count = cursor;
+    if(count == UNDO_TURNS)
+        drop_oldest();
+
+    size_t objSize = objCount * sizeof(OBJ_CHANGE);
+    size_t size = objSize + cellCount * sizeof(CELL_CHANGE);
+    size_t pos = reserve(size);
+    memcpy(arena + pos,objs,objSize);
+    memcpy(arena + pos + objSize,cells,size - objSize);
+
+    TURN* t = get_turn(count);
+    t->pos = pos;
+    t->size = size;
+    t->objCount = objCount;
+    t->cellCount = cellCount;
+    t->progress[0] = progress;
+    t->elecOn[0] = elecOn;
+
+    store_current();
+    t->progress[1] = progress;
+    t->elecOn[1] = elecOn;
+
+    ++ count;
+    ++ cursor;
+}
+
+
+// Step back
+bool undo_step_back()
+{
+    if(cursor == 0)
+        return false;
+
+    -- cursor;
+    apply(get_turn(cursor),0);
+    return true;
+}
+
+
+// Discard
+void undo_discard()
+{
+    // Every object is placed, since a moving
+    // one may have kept its cell
+    int i = 0;
+    for(; i < obj_count(); ++ i)
+    {
+        obj_set_word(i,words[i]);
+    }
+    obj_set_word(MAX_OBJ,words[MAX_OBJ]);
+
+    POINT dim = stage_get_map_size();
+    const Uint8* curLayer = stage_get_layer_data();
+    const Uint8* curCol = stage_get_collision_map();
+    for(i = 0; i < dim.x*dim.y; ++ i)
+    {
+        if(curLayer[i] != layer[i] || curCol[i] != col[i])
+            stage_set_cell(i,layer[i],col[i]);
+    }
+
+    progress_load_state(&progress);
+    stage_set_electricity(elecOn);
+}
+
+
+// Step forward
+bool undo_step_forward()
+{
+    if(cursor == count)
+        return false;
+
+    apply(get_turn(cursor),1);
+    ++ cursor;
+    return true;
+}
@@ -0,0 +1,33 @@
+/// Undo history (header)
+/// (c) 2018 Jani Nykänen
+///
+/// The turns taken are recorded as the cells, the objects and
+/// the counters they changed, in a ring buffer of a fixed size.
+/// The oldest turns are forgotten when it is full
+
+#ifndef __UNDO__
+#define __UNDO__
+
+#include "stdbool.h"
+
+/// Forget the history, the current state is the start
+void undo_reset();
+
+/// Record a turn once it has settled. Nothing
+/// is recorded if no turn was taken
+void undo_record();
+
+/// Take back the last turn
+/// > True, if there was a turn to take back
+bool undo_step_back();
+
+/// Put back the state after the last recorded turn. Takes
+/// back a turn that never settled, like the one where the
+/// player died, and stops the objects moving
+void undo_discard();
+
+/// Take again the last turn taken back
+/// > True, if there was a turn to take again
+bool undo_step_forward();
+
+#endif // __UNDO__
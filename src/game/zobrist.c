@@ -0,0 +1,17 @@
+/// Zobrist keys (source)
+/// (c) 2018 Jani Nykänen
+
+#include "zobrist.h"
+
+
+// Get key. The feature and the value are mixed with the
+// SplitMix64 finalizer instead of being looked up from a
+// table of random numbers, since the values are up to 32 bits
+Uint64 zobrist_key(int feature, Uint32 value)
+{
+    Uint64 z = ((Uint64)feature << 32 | value) + 0x9E3779B97F4A7C15ULL;
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
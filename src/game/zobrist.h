@@ -0,0 +1,32 @@
+/// Zobrist keys (header)
+/// (c) 2018 Jani Nykänen
+///
+/// A state hash is the XOR of the keys of its features and
+/// their values, so when a feature changes, the hash is updated
+/// by XORing out the key of the old value and in the new one
+
+#ifndef __ZOBRIST__
+#define __ZOBRIST__
+
+#include "stage.h"
+
+#include "SDL2/SDL.h"
+
+/// Features
+enum
+{
+    ZOBRIST_LAYER = 0, /// Tile layer, a feature per cell
+    ZOBRIST_COLLISION = STAGE_MAX_SIZE, /// Collision map, a feature per cell
+    ZOBRIST_ELECTRICITY = STAGE_MAX_SIZE*2,
+    ZOBRIST_KEYS = STAGE_MAX_SIZE*2 + 1,
+    ZOBRIST_OBJECTS = STAGE_MAX_SIZE*2 + 2, /// A feature per object, the player last
+};
+
+/// Get the key of a feature value. The keys are
+/// the same on every run
+/// < feature Feature
+/// < value Value
+/// > Key
+Uint64 zobrist_key(int feature, Uint32 value);
+
+#endif // __ZOBRIST__
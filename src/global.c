@@ -9,6 +9,7 @@
 
 #include "engine/graphics.h"
 #include "engine/assets.h"
+#include "engine/hotreload.h"
 #include "engine/music.h"
 #include "engine/app.h"
 
@@ -16,14 +17,37 @@
 #include "transition.h"
 #include "savedata.h"
 #include "options.h"
+#include "asset_ids.h"
 
 #include "stdlib.h"
 #include "math.h"
 #include "stdio.h"
 
+// Global asset list
+#define ASSET_LIST_PATH "assets/global.ass"
+// Global asset archive (made with "make pack")
+#define ASSET_ARCHIVE_PATH "assets/global.pak"
+
 // Global asset pack
 static ASSET_PACK* globalAssets;
 
+// Assets used by every scene, always resident
+static const int GLOBAL_ASSETS[] = {
+    ASSET_ID_BLACK_CIRCLE, ASSET_ID_FONT, ASSET_ID_ICONS,
+    ASSET_ID_SELECT, ASSET_ID_ACCEPT, ASSET_ID_PAUSE,
+};
+
+
+// Check if a file exists
+static bool file_exists(const char* path)
+{
+    FILE* f = fopen(path,"rb");
+    if(f == NULL) return false;
+
+    fclose(f);
+    return true;
+}
+
 
 static void read_keyconfig(const char* path)
 {
@@ -35,16 +59,21 @@ static void read_keyconfig(const char* path)
         vpad_add_button(1,(int)SDL_SCANCODE_RETURN,7);
         vpad_add_button(2,(int)SDL_SCANCODE_R,3);
         vpad_add_button(3,(int)SDL_SCANCODE_ESCAPE,6);
+        vpad_add_button(4,(int)SDL_SCANCODE_Z,2);
+        vpad_add_button(5,(int)SDL_SCANCODE_X,1);
+        return;
     }
 
     int i = 0;
-    for(; i < wd->wordCount; i += 3)
+    for(; i+2 < wd->wordCount; i += 3)
     {
         vpad_add_button
             ((int)strtol(get_word(wd,i),NULL,10),
             (int)strtol(get_word(wd,i +1),NULL,10),
             (int)strtol(get_word(wd,i +2),NULL,10));
     }
+
+    destroy_word_data(wd);
 }
 
 
@@ -55,13 +84,26 @@ static int global_init()
     vpad_init();
     read_keyconfig("keyconfig.list");
 
-    // Load global assets
-    globalAssets = load_asset_pack("assets/global.ass");
+    // Load global assets, from the archive if it exists
+    globalAssets = load_asset_pack(file_exists(ASSET_ARCHIVE_PATH)
+        ? ASSET_ARCHIVE_PATH : ASSET_LIST_PATH);
     if(globalAssets == NULL)
     {
         return 1;
     }
-    
+    // IDs index the asset list directly, so they must
+    // be regenerated when the list changes
+    if(globalAssets->assetCount != ASSET_ID_COUNT)
+    {
+        printf("Asset IDs are out of date, run \"make asset_ids\".\n");
+    }
+
+    // The rest are loaded by the scenes
+    pin_assets(globalAssets,GLOBAL_ASSETS,sizeof(GLOBAL_ASSETS) / sizeof(int));
+
+    // Reload changed files in the development mode
+    watch_asset_pack(globalAssets);
+
     // Initialize global components
     trn_init(globalAssets);
 
@@ -83,6 +125,11 @@ static void global_update(float tm)
 {
     vpad_update();
     trn_update(tm);
+
+    // Nothing is drawn during the update, so changed
+    // assets can be reloaded and unused ones evicted
+    update_hot_reload();
+    update_asset_residency(globalAssets);
 }
 
 
@@ -96,6 +143,14 @@ static void global_draw()
 // Destroy global scene
 static void global_destroy()
 {
+    // Loading times of the assets loaded
+    // during the session
+    if(getenv("AQFFOS_ASSET_TIMINGS") != NULL)
+    {
+        print_asset_timings(globalAssets);
+    }
+    stop_hot_reload();
+
     // Save data
     save_data("save.dat");
 
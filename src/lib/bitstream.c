@@ -0,0 +1,78 @@
+/// Bit streams (source)
+/// (c) 2018 Jani Nykänen
+
+#include "bitstream.h"
+
+
+// Create a bit stream
+BIT_STREAM bits_create(void* data)
+{
+    BIT_STREAM s;
+    s.data = (Uint8*)data;
+    s.pos = 0;
+
+    return s;
+}
+
+
+// Write a value
+void bits_write(BIT_STREAM* s, Uint32 value, int count)
+{
+    Uint8* p;
+    int shift, n;
+    while(count > 0)
+    {
+        p = s->data + (s->pos >> 3);
+        shift = (int)(s->pos & 7);
+
+        // A new byte is cleared first
+        if(shift == 0)
+            *p = 0;
+
+        n = 8 - shift;
+        if(n > count) n = count;
+
+        *p |= (Uint8)((value & ((1u << n) - 1)) << shift);
+        value >>= n;
+        count -= n;
+        s->pos += n;
+    }
+}
+
+
+// Read a value
+Uint32 bits_read(BIT_STREAM* s, int count)
+{
+    Uint32 value = 0;
+    int shift, n;
+    int done = 0;
+    while(done < count)
+    {
+        shift = (int)(s->pos & 7);
+
+        n = 8 - shift;
+        if(n > count - done) n = count - done;
+
+        value |= (Uint32)((s->data[s->pos >> 3] >> shift) & ((1u << n) - 1)) << done;
+        done += n;
+        s->pos += n;
+    }
+    return value;
+}
+
+
+// Get size
+size_t bits_get_size(const BIT_STREAM* s)
+{
+    return (s->pos + 7) / 8;
+}
+
+
+// Get bits needed
+int bits_needed(Uint32 max)
+{
+    int n = 0;
+    for(; n < 32 && (max >> n) != 0; ++ n);
+
+    return n;
+}
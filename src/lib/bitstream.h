@@ -0,0 +1,49 @@
+/// Bit streams (header)
+/// (c) 2018 Jani Nykänen
+///
+/// Values of any width up to 32 bits, packed back
+/// to back with the lowest bits first
+
+#ifndef __BIT_STREAM__
+#define __BIT_STREAM__
+
+#include "SDL2/SDL.h"
+
+#include "stddef.h"
+
+/// Bit stream
+typedef struct
+{
+    Uint8* data;
+    size_t pos; /// Position in bits
+}
+BIT_STREAM;
+
+/// Create a bit stream
+/// < data Data to read or write. Written bytes need not be cleared
+/// > Bit stream at the start of the data
+BIT_STREAM bits_create(void* data);
+
+/// Write a value
+/// < s Stream
+/// < value Value, only the lowest bits are written
+/// < count Bit count, 0-32
+void bits_write(BIT_STREAM* s, Uint32 value, int count);
+
+/// Read a value
+/// < s Stream
+/// < count Bit count, 0-32
+/// > Value
+Uint32 bits_read(BIT_STREAM* s, int count);
+
+/// Get the amount of bytes used
+/// < s Stream
+/// > Size in bytes, the last byte may be partial
+size_t bits_get_size(const BIT_STREAM* s);
+
+/// Get the amount of bits needed for a value
+/// < max Maximum value
+/// > Bit count
+int bits_needed(Uint32 max);
+
+#endif // __BIT_STREAM__
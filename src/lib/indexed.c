@@ -0,0 +1,124 @@
+/// Indexed-colour images (source)
+/// (c) 2018 Jani Nykänen
+
+#include "indexed.h"
+
+#include "string.h"
+
+// Colour lookup table size, a power of two
+// bigger than the maximum colour count
+#define TABLE_SIZE 1024
+
+
+// Hash a colour
+static uint32_t hash_color(uint32_t c)
+{
+    c ^= c >> 16;
+    c *= 0x7feb352d;
+    c ^= c >> 15;
+    return c;
+}
+
+
+// Index pixels
+int index_pixels(const uint8_t* rgba, int count, uint8_t* indices, uint32_t* colors)
+{
+    // Open addressing, an entry is a colour index + 1
+    uint16_t table[TABLE_SIZE];
+    memset(table,0,sizeof(table));
+
+    uint32_t c;
+    uint32_t last = 0;
+    int lastIndex = -1;
+    int colorCount = 0;
+    int slot;
+    int i = 0;
+
+    for(; i < count; ++ i)
+    {
+        memcpy(&c,rgba + i*4,4);
+        if(rgba[i*4 +3] == 0)
+            c = 0;
+
+        // Neighbouring pixels are often the same
+        if(c == last && lastIndex >= 0)
+        {
+            indices[i] = (uint8_t)lastIndex;
+            continue;
+        }
+
+        slot = hash_color(c) & (TABLE_SIZE-1);
+        while(table[slot] != 0 && colors[table[slot]-1] != c)
+        {
+            slot = (slot+1) & (TABLE_SIZE-1);
+        }
+
+        if(table[slot] == 0)
+        {
+            if(colorCount >= INDEXED_MAX_COLORS)
+                return -1;
+
+            colors[colorCount ++] = c;
+            table[slot] = (uint16_t)colorCount;
+        }
+
+        last = c;
+        lastIndex = table[slot]-1;
+        indices[i] = (uint8_t)lastIndex;
+    }
+
+    return colorCount;
+}
+
+
+// Get index bits
+int get_index_bits(int colorCount)
+{
+    return colorCount <= 16 ? 4 : 8;
+}
+
+
+// Get row size
+size_t get_index_row_size(int w, int bits)
+{
+    return bits == 4 ? (size_t)(w+1) / 2 : (size_t)w;
+}
+
+
+// Pack a row
+void pack_index_row(const uint8_t* src, int w, int bits, uint8_t* out)
+{
+    if(bits != 4)
+    {
+        memcpy(out,src,w);
+        return;
+    }
+
+    int i = 0;
+    for(; i+1 < w; i += 2)
+    {
+        out[i/2] = (src[i] & 0x0f) | (uint8_t)(src[i+1] << 4);
+    }
+    if(i < w)
+        out[i/2] = src[i] & 0x0f;
+}
+
+
+// Unpack a row
+void unpack_index_row(const uint8_t* src, int w, int bits, uint8_t* out)
+{
+    if(bits != 4)
+    {
+        memcpy(out,src,w);
+        return;
+    }
+
+    int i = 0;
+    for(; i+1 < w; i += 2)
+    {
+        out[i] = src[i/2] & 0x0f;
+        out[i+1] = src[i/2] >> 4;
+    }
+    if(i < w)
+        out[i] = src[i/2] & 0x0f;
+}
@@ -0,0 +1,53 @@
+/// Indexed-colour images (header)
+/// (c) 2018 Jani Nykänen
+///
+/// Images with at most 256 colours are stored as palette
+/// indices and a colour lookup table. Indices are packed to
+/// 4 or 8 bits, and every row starts from a new byte. Colours
+/// are 32-bit values with the bytes in RGBA order
+
+#ifndef __INDEXED__
+#define __INDEXED__
+
+#include "stdint.h"
+#include "stddef.h"
+
+/// Maximum amount of colours in an indexed image
+#define INDEXED_MAX_COLORS 256
+
+/// Convert RGBA pixels to palette indices. Fully transparent
+/// pixels share one colour
+/// < rgba RGBA pixels
+/// < count Pixel count
+/// < indices Where the indices are stored, one byte per pixel
+/// < colors Where the colours are stored, INDEXED_MAX_COLORS entries
+/// > Colour count, -1 if the image has too many colours
+int index_pixels(const uint8_t* rgba, int count, uint8_t* indices, uint32_t* colors);
+
+/// Get the bits per index needed for a palette
+/// < colorCount Colour count
+/// > 4 or 8
+int get_index_bits(int colorCount);
+
+/// Get the size of a row of packed indices
+/// < w Width in pixels
+/// < bits Bits per index, 4 or 8
+/// > Size in bytes
+size_t get_index_row_size(int w, int bits);
+
+/// Pack a row of indices. With 4 bits, the first pixel
+/// is in the low nibble
+/// < src Indices, one byte per pixel
+/// < w Width in pixels
+/// < bits Bits per index, 4 or 8
+/// < out Packed row
+void pack_index_row(const uint8_t* src, int w, int bits, uint8_t* out);
+
+/// Unpack a row of indices to one byte per pixel
+/// < src Packed row
+/// < w Width in pixels
+/// < bits Bits per index, 4 or 8
+/// < out Indices
+void unpack_index_row(const uint8_t* src, int w, int bits, uint8_t* out);
+
+#endif // __INDEXED__
@@ -0,0 +1,138 @@
+/// Memory-mapped files (source)
+/// (c) 2018 Jani Nykänen
+
+#include "mapfile.h"
+
+#include "stdio.h"
+#include "stdlib.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#define USE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+// Read the whole file to memory
+static int read_file(MAPPED_FILE* f, const char* path)
+{
+    FILE* fp = fopen(path,"rb");
+    if(fp == NULL) return 1;
+
+    fseek(fp,0,SEEK_END);
+    long len = ftell(fp);
+    fseek(fp,0,SEEK_SET);
+    if(len < 0)
+    {
+        fclose(fp);
+        return 1;
+    }
+
+    unsigned char* data = (unsigned char*)malloc(len > 0 ? len : 1);
+    if(data == NULL || fread(data,1,len,fp) != (size_t)len)
+    {
+        free(data);
+        fclose(fp);
+        return 1;
+    }
+    fclose(fp);
+
+    f->data = data;
+    f->size = (size_t)len;
+    f->mapped = 0;
+
+    return 0;
+}
+
+
+// Map file
+MAPPED_FILE* map_file(const char* path)
+{
+    MAPPED_FILE* f = (MAPPED_FILE*)malloc(sizeof(MAPPED_FILE));
+    if(f == NULL) return NULL;
+
+    f->data = NULL;
+    f->size = 0;
+    f->handle = NULL;
+    f->mapped = 0;
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+    if(file != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER size;
+        HANDLE mapping = NULL;
+        if(GetFileSizeEx(file,&size) && size.QuadPart > 0)
+            mapping = CreateFileMappingA(file,NULL,PAGE_READONLY,0,0,NULL);
+        CloseHandle(file);
+
+        if(mapping != NULL)
+        {
+            f->data = (const unsigned char*)MapViewOfFile(mapping,FILE_MAP_READ,0,0,0);
+            if(f->data != NULL)
+            {
+                f->size = (size_t)size.QuadPart;
+                f->handle = (void*)mapping;
+                f->mapped = 1;
+                return f;
+            }
+            CloseHandle(mapping);
+        }
+    }
+
+#elif defined(USE_MMAP)
+    int fd = open(path,O_RDONLY);
+    if(fd >= 0)
+    {
+        struct stat st;
+        if(fstat(fd,&st) == 0 && st.st_size > 0)
+        {
+            void* p = mmap(NULL,(size_t)st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+            if(p != MAP_FAILED)
+            {
+                close(fd);
+                f->data = (const unsigned char*)p;
+                f->size = (size_t)st.st_size;
+                f->mapped = 1;
+                return f;
+            }
+        }
+        close(fd);
+    }
+#endif
+
+    // Mapping not possible, read the file instead
+    if(read_file(f,path) != 0)
+    {
+        free(f);
+        return NULL;
+    }
+
+    return f;
+}
+
+
+// Unmap file
+void unmap_file(MAPPED_FILE* f)
+{
+    if(f == NULL) return;
+
+    if(f->mapped)
+    {
+#if defined(_WIN32)
+        UnmapViewOfFile((LPCVOID)f->data);
+        CloseHandle((HANDLE)f->handle);
+#elif defined(USE_MMAP)
+        munmap((void*)f->data,f->size);
+#endif
+    }
+    else
+    {
+        free((void*)f->data);
+    }
+    free(f);
+}
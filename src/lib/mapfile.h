@@ -0,0 +1,29 @@
+/// Memory-mapped files (header)
+/// (c) 2018 Jani Nykänen
+
+#ifndef __MAPFILE__
+#define __MAPFILE__
+
+#include "stddef.h"
+
+/// Mapped file type
+typedef struct
+{
+    const unsigned char* data; /// File content
+    size_t size; /// File size
+    void* handle; /// Platform specific handle
+    int mapped; /// Is the content mapped (otherwise read to memory)
+}
+MAPPED_FILE;
+
+/// Map a file to memory (read-only). Falls back to
+/// reading the file if mapping is not available
+/// < path File path
+/// > A new mapped file, NULL on error
+MAPPED_FILE* map_file(const char* path);
+
+/// Unmap a file
+/// < f Mapped file
+void unmap_file(MAPPED_FILE* f);
+
+#endif // __MAPFILE__
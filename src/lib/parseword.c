@@ -1,12 +1,13 @@
 /**
  * libparseword library
  * Source file
- * 
+ *
  * @author Jani Nykänen
- * @version 1.0.0
+ * @version 1.1.0
  */
 
 #include "parseword.h"
+#include "mapfile.h"
 
 #include "SDL2/SDL.h"
 
@@ -14,205 +15,87 @@
 #include "stdlib.h"
 #include "stdbool.h"
 #include "string.h"
+#include "stdint.h"
 
-// File size in bytes
-static int fileSize;
-// File data (char array)
-static char* fdata;
-
-// To avoid memory overflows etc
-static const int SAVE_BYTES = 1024;
-
-// Calculate file size
-static int calculate_file_size(FILE* f)
+// Is the character a word separator
+static bool is_separator(char c)
 {
-    int length = 0;
-
-    char c;
-    while ((c = fgetc(f)) != EOF)
-        ++ length;
-
-    return length;
-}
-
-// Store byte data to a char array
-static int store_byte_data(FILE* f)
-{
-
-    rewind(f);
-
-    // Allocate memory
-    fdata = (char*)malloc((size_t)fileSize + SAVE_BYTES);
-    if(fdata == NULL)
-    {
-        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!\n",NULL);
-        return 1;
-    }
-
-    // Store characters
-    char c;
-    int index = 0;
-    while ((c = fgetc(f)) != EOF)
-    {
-        fdata[index] = c;
-        ++ index;
-    }
-
-    return 0;
+    return c == ' ' || c == '\t' || c == ',' || c == '\n' || c == '\r';
 }
 
-//  Calculate actual size & word count and/or store word positions, length and actual data
-static void read_data(int* charCount, int* wordCount, int* wordPos, int* wordLengths, char* data)
+// Tokenize the source to null-terminated words in one pass.
+// The output never needs more than size+1 characters, and
+// there are at most size/2+1 words, since every word but
+// the last one is followed by at least one other character
+static int tokenize(const char* src, int size, char* out, WORDVIEW* views)
 {
-    int size = 0;
     int words = 0;
-
-    char c;
+    int len = 0;
+    int start = 0;
     int index = 0;
-
-    bool commentStarted = false;
-    bool quote = false;
+    char c;
     char quoteType = 0;
-    int wordLength = 0;
-    bool wordStarted = false;
 
-    int cindex = 0;
-    int wstart = 0;
-
-    for(; index < fileSize; ++ index)
+    while(index < size)
     {
-        c = fdata[index];
-        
-        if(!commentStarted && c == '#')
-        {
-            commentStarted = true;
-        }
-        else if(!commentStarted && !quote && (c == 39 || c == '"'))
-        {
-            quote = true;
-            quoteType = c;
-            wordStarted = true;
-            wordLength = 0;
-            wstart = cindex;
-            continue;
-        }
+        c = src[index ++];
 
-        if(commentStarted)
+        // Comment, skip to the end of the line
+        if(c == '#')
         {
-            if(c == '\n')
-                commentStarted = false;
-            
+            while(index < size && src[index] != '\n')
+                ++ index;
             continue;
         }
+        if(is_separator(c))
+            continue;
 
-        if(quote)
-        {
-            if(c == quoteType)
-            {
-                quote = false;
-                wordStarted = false;
-
-                if(wordPos != NULL)
-                {
-                    wordPos[words] = wstart;
-                }
-
-                if(wordLength > 0)
-                    ++ words;
-
-                if(data != NULL)
-                {
-                    data[cindex] = 0;
-                    ++ cindex;
-                }
-
-                continue;
-            }
+        start = len;
 
-            if(c != '\n')
+        // Quoted word, may contain separators but
+        // line swaps are dropped
+        if(c == 39 || c == '"')
+        {
+            quoteType = c;
+            while(index < size && (c = src[index ++]) != quoteType)
             {
-                if(data != NULL)
-                {
-                    data[cindex] = c;
-                }
-                ++ size;
-                ++ cindex;
+                if(c != '\n' && c != '\r')
+                    out[len ++] = c;
             }
-
-            ++ wordLength;
         }
-        else 
+        // Plain word
+        else
         {
-            if(c != ' ' && c != '\t' && c != ',' && c != '\n')
-            {
-                if(data != NULL)
-                {
-                    data[cindex] = c;
-                }
-
-                ++ size;
-                ++ wordLength;
-                if(!wordStarted)
-                {
-                    if(wordPos != NULL)
-                    {
-                        wordPos[words] = cindex;
-                    }
-
-                    wordStarted = true;
-                    ++ words;
-                }
-                ++ cindex;
-            }
-            else
+            out[len ++] = c;
+            while(index < size)
             {
-                if(wordStarted && wordLength > 0)
-                {
-                    if(wordLengths != NULL)
-                        wordLengths[words-1] = wordLength;
+                c = src[index];
+                if(is_separator(c) || c == '#' || c == 39 || c == '"')
+                    break;
 
-                    if(data != NULL)
-                    {
-                        data[cindex] = 0;
-                        ++ cindex;
-                    }
-                }
-                wordStarted = false;
-                wordLength = 0;
+                out[len ++] = c;
+                ++ index;
             }
         }
-        
-    }
-
-    if(quote)
-    {
-        quote = false;
-        wordStarted = false;
 
-        if(wordPos != NULL)
-        {
-            wordPos[words] = wstart;
-        }
-
-        if(wordLength > 0)
-            ++ words;
+        // Empty quotes are not words
+        if(len == start)
+            continue;
 
-        if(data != NULL)
-        {
-            data[cindex] = 0;
-            ++ cindex;
-        }
+        views[words].offset = start;
+        views[words].length = len - start;
+        ++ words;
+        out[len ++] = 0;
     }
 
-    if(charCount != NULL) *charCount = size;
-    if(wordCount != NULL) *wordCount = words;
+    return words;
 }
 
 // Parse file
 WORDDATA* parse_file(const char* path)
 {
-    // Open file
-    FILE* f = fopen(path,"r");
+    // Map file
+    MAPPED_FILE* f = map_file(path);
     if(f == NULL)
     {
         char err[256];
@@ -220,55 +103,33 @@ WORDDATA* parse_file(const char* path)
         SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!",err,NULL);
         return NULL;
     }
-    // Calculate char count & store data
-    fileSize = calculate_file_size(f);
-    if(store_byte_data(f) == 1)
+    if(f->size > INT32_MAX / 8)
     {
-        fclose(f);
+        unmap_file(f);
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","File too big to be parsed!\n",NULL);
         return NULL;
     }
-    fclose(f);
+    int size = (int)f->size;
+    int maxWords = size/2 +1;
 
-    // Allocate memory
-    WORDDATA* w = malloc(sizeof(WORDDATA));
+    // The object, the views and the characters
+    // share one allocation
+    WORDDATA* w = (WORDDATA*)malloc(sizeof(WORDDATA) + sizeof(WORDVIEW) * maxWords + size +1);
     if(w == NULL)
     {
+        unmap_file(f);
         SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!\n",NULL);
         return NULL;
     }
+    w->words = (WORDVIEW*)(w + 1);
+    w->data = (char*)(w->words + maxWords);
 
-    // Calculate actual size
-    read_data(&w->size,&w->wordCount,NULL,NULL,NULL);
-    // Allocate memory for the data
-    w->data = (char*)malloc(sizeof(char) * (w->size + w->wordCount) + SAVE_BYTES );
-    if(w->data == NULL)
-    {
-        free(w);
-        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!\n",NULL);
-        return NULL;
-    }
-    w->wordPos = (int*)malloc(w->wordCount * sizeof(int));
-    if(w->data == NULL)
-    {
-        free(w->data);
-        free(w);
-        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!\n",NULL);
-        return NULL;
-    }
-    w->wordLength = (int*)malloc(w->wordCount * sizeof(int));
-    if(w->wordLength == NULL)
-    {
-        free(w->data);
-        free(w->wordPos);
-        free(w);
-        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!\n",NULL);
-        return NULL;
-    }
-    // Store word pos & length
-    read_data(NULL,NULL,w->wordPos,w->wordLength,w->data);
-    w->data[w->size + w->wordCount] = 0;
+    w->wordCount = tokenize((const char*)f->data,size,w->data,w->words);
+    w->size = w->wordCount > 0
+        ? w->words[w->wordCount-1].offset + w->words[w->wordCount-1].length
+        : 0;
 
-    free(fdata);
+    unmap_file(f);
 
     return w;
 }
@@ -276,15 +137,21 @@ WORDDATA* parse_file(const char* path)
 // Free word data
 void destroy_word_data(WORDDATA* w)
 {
-    if(w == NULL) return;
-
     free(w);
 }
 
 // Get word
 char* get_word(WORDDATA* w, int index)
 {
-    if(index >= w->wordCount) return NULL;
+    if(index < 0 || index >= w->wordCount) return NULL;
 
-    return w->data + w->wordPos[index];
-}
\ No newline at end of file
+    return w->data + w->words[index].offset;
+}
+
+// Get word length
+int get_word_length(WORDDATA* w, int index)
+{
+    if(index < 0 || index >= w->wordCount) return 0;
+
+    return w->words[index].length;
+}
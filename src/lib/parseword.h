@@ -1,21 +1,29 @@
 /**
  * libparseword library
  * Header file
- * 
+ *
  * @author Jani Nykänen
- * @version 1.0.0
+ * @version 1.1.0
  */
 
 #ifndef __LIB__PARSEWORD__
 #define __LIB__PARSEWORD__
 
-/** Word data type */
+/** Word view, a null-terminated word in the word data */
+typedef struct
+{
+    int offset;
+    int length;
+}
+WORDVIEW;
+
+/** Word data type. The views and the characters live in
+ * the same allocation as the object itself */
 typedef struct
 {
     char* data;
-    int* wordPos;
-    int* wordLength;
-    int wordCount; 
+    WORDVIEW* words;
+    int wordCount;
     int size;
 }
 WORDDATA;
@@ -37,8 +45,16 @@ void destroy_word_data(WORDDATA* w);
  * Get word in index
  * @param w Word data
  * @param index Word index
- * @return Word pointer
+ * @return Word pointer, NULL if out of range
  */
 char* get_word(WORDDATA* w, int index);
 
-#endif // __LIB__PARSEWORD__
\ No newline at end of file
+/**
+ * Get the length of the word in index
+ * @param w Word data
+ * @param index Word index
+ * @return Word length, 0 if out of range
+ */
+int get_word_length(WORDDATA* w, int index);
+
+#endif // __LIB__PARSEWORD__
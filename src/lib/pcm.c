@@ -0,0 +1,59 @@
+/// PCM audio conversion (source)
+/// (c) 2018 Jani Nykänen
+
+#include "pcm.h"
+
+#include "stdlib.h"
+#include "string.h"
+
+
+// Convert PCM
+Uint8* convert_pcm(const Uint8* data, Uint32 len,
+    const SDL_AudioSpec* from, const SDL_AudioSpec* to, Uint32* outLen)
+{
+    SDL_AudioCVT cvt;
+    int ret = SDL_BuildAudioCVT(&cvt,from->format,from->channels,from->freq,
+        to->format,to->channels,to->freq);
+    if(ret < 0) return NULL;
+
+    // The conversion is done in place, and
+    // may need more room than the result
+    size_t size = (size_t)len * (ret == 1 ? cvt.len_mult : 1);
+    Uint8* buf = (Uint8*)malloc(size > 0 ? size : 1);
+    if(buf == NULL) return NULL;
+    memcpy(buf,data,len);
+
+    if(ret == 0)
+    {
+        *outLen = len;
+        return buf;
+    }
+
+    cvt.buf = buf;
+    cvt.len = (int)len;
+    if(SDL_ConvertAudio(&cvt) != 0)
+    {
+        free(buf);
+        return NULL;
+    }
+    *outLen = (Uint32)cvt.len_cvt;
+
+    return buf;
+}
+
+
+// Decode WAV
+Uint8* decode_wav(SDL_RWops* rw, const SDL_AudioSpec* to, Uint32* outLen)
+{
+    SDL_AudioSpec spec;
+    Uint8* wav;
+    Uint32 len;
+
+    if(rw == NULL || SDL_LoadWAV_RW(rw,1,&spec,&wav,&len) == NULL)
+        return NULL;
+
+    Uint8* pcm = convert_pcm(wav,len,&spec,to,outLen);
+    SDL_FreeWAV(wav);
+
+    return pcm;
+}
@@ -0,0 +1,37 @@
+/// PCM audio conversion (header)
+/// (c) 2018 Jani Nykänen
+///
+/// Samples are converted to the output format of the audio
+/// device once, when they are loaded or packed, so the mixer
+/// can play them as they are
+
+#ifndef __PCM__
+#define __PCM__
+
+#include "SDL2/SDL.h"
+
+/// Output frequency of the audio device
+#define PCM_FREQUENCY 44100
+/// Output sample format of the audio device
+#define PCM_FORMAT AUDIO_S16SYS
+/// Output channel count of the audio device
+#define PCM_CHANNELS 2
+
+/// Convert PCM data to another format
+/// < data PCM data
+/// < len Data size in bytes
+/// < from Format of the data
+/// < to Target format, only freq, format and channels are used
+/// < outLen Where the size of the converted data is stored
+/// > Converted data, NULL on error. Free with free()
+Uint8* convert_pcm(const Uint8* data, Uint32 len,
+    const SDL_AudioSpec* from, const SDL_AudioSpec* to, Uint32* outLen);
+
+/// Decode a WAV file and convert it to another format
+/// < rw WAV file, closed by the function
+/// < to Target format
+/// < outLen Where the size of the PCM data is stored
+/// > PCM data, NULL on error. Free with free()
+Uint8* decode_wav(SDL_RWops* rw, const SDL_AudioSpec* to, Uint32* outLen);
+
+#endif // __PCM__
@@ -0,0 +1,167 @@
+/// Compiled stage files (source)
+/// (c) 2018 Jani Nykänen
+
+#include "stagefile.h"
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#include "SDL2/SDL.h"
+
+
+// Get stage size
+size_t get_stage_size(int width, int height, int spawnCount)
+{
+    return sizeof(STAGE_HEADER) + sizeof(STAGE_SPAWN) * spawnCount
+        + (size_t)width * height * 2;
+}
+
+
+// Compile stage
+uint8_t* compile_stage(const TILEMAP* t, SPAWN_CHECK is_spawn, size_t* size)
+{
+    if(t->layerCount < 1 || t->width > 0xffff || t->height > 0xffff)
+    {
+        fprintf(stderr,"Invalid tilemap\n");
+        return NULL;
+    }
+
+    LAYER layer = t->layers[0];
+    int spawnCount = 0;
+    int i = 0;
+
+    // Tile IDs must fit in a byte
+    for(; i < t->tcount; ++ i)
+    {
+        if(layer[i] < 0 || layer[i] > 255)
+        {
+            fprintf(stderr,"Tile ID %d at %d,%d does not fit in a byte\n",
+                layer[i],i % t->width,i / t->width);
+            return NULL;
+        }
+        if(is_spawn(layer[i]))
+            ++ spawnCount;
+    }
+
+    *size = get_stage_size(t->width,t->height,spawnCount);
+    uint8_t* data = (uint8_t*)calloc(1,*size);
+    if(data == NULL)
+    {
+        fprintf(stderr,"Memory allocation error!\n");
+        return NULL;
+    }
+
+    STAGE_HEADER* h = (STAGE_HEADER*)data;
+    memcpy(h->magic,STAGE_MAGIC,4);
+    h->version = SDL_SwapLE16(STAGE_VERSION);
+    h->spawnCount = SDL_SwapLE16(spawnCount);
+    h->width = SDL_SwapLE16(t->width);
+    h->height = SDL_SwapLE16(t->height);
+    h->tileW = SDL_SwapLE16(t->tileW);
+    h->tileH = SDL_SwapLE16(t->tileH);
+
+    STAGE_SPAWN* spawns = (STAGE_SPAWN*)(h + 1);
+    uint8_t* tiles = (uint8_t*)(spawns + spawnCount);
+    uint8_t* collision = tiles + t->tcount;
+
+    // Objects are spawned in row-major order, and
+    // their tiles are not a part of the collision map
+    int n = 0;
+    for(i = 0; i < t->tcount; ++ i)
+    {
+        tiles[i] = (uint8_t)layer[i];
+        if(is_spawn(layer[i]))
+        {
+            spawns[n].id = (uint8_t)layer[i];
+            spawns[n].x = SDL_SwapLE16(i % t->width);
+            spawns[n].y = SDL_SwapLE16(i / t->width);
+            ++ n;
+        }
+        else
+        {
+            collision[i] = (uint8_t)layer[i];
+        }
+    }
+
+    return data;
+}
+
+
+// Open stage
+STAGE* open_stage(const void* data, size_t size)
+{
+    const STAGE_HEADER* h = (const STAGE_HEADER*)data;
+
+    if(size < sizeof(STAGE_HEADER) || memcmp(h->magic,STAGE_MAGIC,4) != 0
+     || SDL_SwapLE16(h->version) != STAGE_VERSION)
+    {
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Invalid stage data!\n",NULL);
+        return NULL;
+    }
+
+    int width = SDL_SwapLE16(h->width);
+    int height = SDL_SwapLE16(h->height);
+    int spawnCount = SDL_SwapLE16(h->spawnCount);
+    if(size < get_stage_size(width,height,spawnCount))
+    {
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Invalid stage data!\n",NULL);
+        return NULL;
+    }
+
+    STAGE* s = (STAGE*)malloc(sizeof(STAGE));
+    if(s == NULL)
+    {
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!\n",NULL);
+        return NULL;
+    }
+
+    s->width = width;
+    s->height = height;
+    s->tileW = SDL_SwapLE16(h->tileW);
+    s->tileH = SDL_SwapLE16(h->tileH);
+    s->pwidth = s->width * s->tileW;
+    s->pheight = s->height * s->tileH;
+    s->spawnCount = spawnCount;
+    s->spawns = (const STAGE_SPAWN*)(h + 1);
+    s->tiles = (const uint8_t*)(s->spawns + spawnCount);
+    s->collision = s->tiles + width*height;
+    s->file = NULL;
+
+    return s;
+}
+
+
+// Load stage
+STAGE* load_stage(const char* path)
+{
+    MAPPED_FILE* f = map_file(path);
+    if(f == NULL)
+    {
+        char err[256];
+        snprintf(err,256,"Failed to load a stage in %s!",path);
+
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!",err,NULL);
+        return NULL;
+    }
+
+    STAGE* s = open_stage(f->data,f->size);
+    if(s == NULL)
+    {
+        unmap_file(f);
+        return NULL;
+    }
+    s->file = f;
+
+    return s;
+}
+
+
+// Destroy stage
+void destroy_stage(STAGE* s)
+{
+    if(s == NULL) return;
+
+    unmap_file(s->file);
+    free(s);
+}
@@ -0,0 +1,98 @@
+/// Compiled stage files (header)
+/// (c) 2018 Jani Nykänen
+///
+/// Stages are compiled from TMX files with tools/stagec,
+/// or in the development mode when the TMX file changes.
+/// The file is a STAGE_HEADER, followed by the spawn list,
+/// the tile IDs and the collision tile IDs. The stage is
+/// used straight from the file data, nothing is converted
+
+#ifndef __STAGE_FILE__
+#define __STAGE_FILE__
+
+#include "stdint.h"
+#include "stddef.h"
+#include "stdbool.h"
+
+#include "mapfile.h"
+#include "tmxc.h"
+
+/// Stage magic
+#define STAGE_MAGIC "AQST"
+/// Stage version
+#define STAGE_VERSION 1
+
+/// Stage file header. All the values are little endian
+typedef struct
+{
+    char magic[4]; /// STAGE_MAGIC
+    uint16_t version; /// STAGE_VERSION
+    uint16_t spawnCount; /// Object spawn count
+    uint16_t width; /// Width in tiles
+    uint16_t height; /// Height in tiles
+    uint16_t tileW; /// Tile width
+    uint16_t tileH; /// Tile height
+}
+STAGE_HEADER;
+
+/// Object spawn, in row-major order
+typedef struct
+{
+    uint8_t id; /// Tile ID
+    uint8_t reserved;
+    uint16_t x; /// X position in tiles
+    uint16_t y; /// Y position in tiles
+}
+STAGE_SPAWN;
+
+/// Stage type, points to the file data
+typedef struct
+{
+    int width;
+    int height;
+    int tileW;
+    int tileH;
+    int pwidth; /// Width in pixels
+    int pheight; /// Height in pixels
+    int spawnCount;
+    const STAGE_SPAWN* spawns;
+    const uint8_t* tiles; /// Tile IDs
+    const uint8_t* collision; /// Tile IDs with the spawns removed
+    MAPPED_FILE* file; /// Owned file, if any
+}
+STAGE;
+
+/// Tells if a tile ID is an object spawn
+typedef bool (*SPAWN_CHECK)(int id);
+
+/// Get the size of a stage file
+/// < width Width in tiles
+/// < height Height in tiles
+/// < spawnCount Spawn count
+/// > Size in bytes
+size_t get_stage_size(int width, int height, int spawnCount);
+
+/// Compile the first layer of a tilemap to stage file data
+/// < t Tilemap
+/// < is_spawn Tells which tiles are object spawns
+/// < size Where the data size is stored
+/// > Stage file data, NULL on error. Free with free()
+uint8_t* compile_stage(const TILEMAP* t, SPAWN_CHECK is_spawn, size_t* size);
+
+/// Create a stage that points to stage file data. The
+/// data must stay alive until the stage is destroyed
+/// < data Stage file data
+/// < size Data size
+/// > A new stage, NULL on error
+STAGE* open_stage(const void* data, size_t size);
+
+/// Load a stage file
+/// < path File path
+/// > A new stage, NULL on error
+STAGE* load_stage(const char* path);
+
+/// Destroy a stage
+/// < s Stage
+void destroy_stage(STAGE* s);
+
+#endif // __STAGE_FILE__
@@ -1,239 +1,460 @@
 
 #include "tmxc.h"
 
+#include "mapfile.h"
+#include "stb_image.h"
+
 #include "stdio.h"
 #include "stdlib.h"
 #include "string.h"
-#include "malloc.h"
+#include "stdbool.h"
 
 #include "SDL2/SDL.h"
 
-/// File length
-static int file_length;
-/// Content as string
-static char* file_content;
+/// Maximum amount of attributes read from a tag
+#define MAX_ATTRIBUTES 16
+
+/// Tag attribute, points to the file content
+typedef struct
+{
+    const char* name;
+    int nameLen;
+    const char* value;
+    int valueLen;
+}
+ATTRIBUTE;
+
+/// Parser state. The file is read once, from
+/// the beginning to the end
+typedef struct
+{
+    const char* p;
+    const char* end;
+    TILEMAP* t;
+    int layerCapacity;
+    bool inData;
+    int tileIndex;
+    const char* err;
+}
+PARSER;
+
+/// Check if the name equals to a string
+/// < s Name
+/// < len Name length
+/// < str String
+/// > True if equal
+static bool name_is(const char* s, int len, const char* str)
+{
+    return (int)strlen(str) == len && memcmp(s,str,len) == 0;
+}
 
-/// Calculate length of the file
-/// < f File
-static void calculate_length(FILE* f)
+/// Scan an unsigned integer. Anything else than digits
+/// in front of the number is skipped
+/// < p Position, moved past the number
+/// < end End of the data
+/// < out Where the number is stored
+/// > True if a number was found
+static bool scan_int(const char** p, const char* end, unsigned int* out)
 {
-    int len = 0;
-    char c;
-    while ((c = fgetc(f)) != EOF) 
+    const char* s = *p;
+    while(s < end && (unsigned)(*s - '0') > 9 && *s != '<')
     {
-        len ++;
+        ++ s;
     }
-    rewind(f);
-    file_length = len;
+    if(s >= end || *s == '<')
+    {
+        *p = s;
+        return false;
+    }
+
+    unsigned int v = 0;
+    for(; s < end && (unsigned)(*s - '0') <= 9; ++ s)
+    {
+        v = v*10 + (unsigned)(*s - '0');
+    }
+
+    *p = s;
+    *out = v;
+    return true;
 }
 
-/// Create content
-/// < f File
-/// > 0 on success, 1 otherwise
-static int create_content(FILE* f)
+/// Get an attribute value as an integer
+/// < attr Attributes
+/// < count Attribute count
+/// < name Attribute name
+/// < def Default value
+/// > Value
+static int get_int(ATTRIBUTE* attr, int count, const char* name, int def)
 {
-    // Allocate memory for the file content
-    file_content = (char*)malloc(file_length * sizeof(char));
-    if(file_content == NULL)
+    int i = 0;
+    for(; i < count; ++ i)
     {
-        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!",NULL);
-        return 1;
+        if(name_is(attr[i].name,attr[i].nameLen,name))
+        {
+            const char* p = attr[i].value;
+            unsigned int v;
+            if(scan_int(&p,attr[i].value + attr[i].valueLen,&v))
+                return (int)v;
+
+            return def;
+        }
     }
+    return def;
+}
 
-    // Store characters
-    int p = 0;
-    char c;
-    while ((c = fgetc(f)) != EOF) 
+/// Check if an attribute has the given value
+/// < attr Attributes
+/// < count Attribute count
+/// < name Attribute name
+/// < value Value
+/// > True if so
+static bool has_value(ATTRIBUTE* attr, int count, const char* name, const char* value)
+{
+    int i = 0;
+    for(; i < count; ++ i)
     {
-        file_content[p] = c;
-        p ++;
+        if(name_is(attr[i].name,attr[i].nameLen,name))
+            return name_is(attr[i].value,attr[i].valueLen,value);
     }
-    rewind(f);
+    return false;
+}
 
-    return 0;
+/// Check if an attribute exists
+/// < attr Attributes
+/// < count Attribute count
+/// < name Attribute name
+/// > True if exists
+static bool has_attribute(ATTRIBUTE* attr, int count, const char* name)
+{
+    int i = 0;
+    for(; i < count; ++ i)
+    {
+        if(name_is(attr[i].name,attr[i].nameLen,name))
+            return true;
+    }
+    return false;
 }
 
-/// Get layer count
-/// > Layer count
-static int get_layer_count()
+/// Get the value of a base64 digit
+/// < c Character
+/// > Value, -1 if not a base64 digit
+static int base64_value(char c)
 {
-    // These WLEN things are actually quite useless
-    const int WLEN = 3;
-    int count = 0;
+    if(c >= 'A' && c <= 'Z') return c - 'A';
+    if(c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if(c >= '0' && c <= '9') return c - '0' + 52;
+    if(c == '+') return 62;
+    if(c == '/') return 63;
 
-    char * s = file_content;
+    return -1;
+}
 
-    int i = 0;
-    for(; i < file_length - WLEN; i++)
+/// Decode base64 data, whitespace is skipped
+/// < s Data
+/// < end End of the data
+/// < out Output buffer
+/// < size Output buffer size
+/// > Amount of bytes written, -1 if the buffer is too small
+static int decode_base64(const char* s, const char* end, unsigned char* out, int size)
+{
+    unsigned int acc = 0;
+    int bits = 0;
+    int n = 0;
+    int v;
+
+    for(; s < end && *s != '='; ++ s)
     {
-        if(
-            s[i] == '/' && s[i+1] == 'l' && s[i+2] == 'a'
-        )
+        v = base64_value(*s);
+        if(v < 0) continue;
+
+        acc = (acc << 6) | (unsigned int)v;
+        bits += 6;
+        if(bits >= 8)
         {
-            count ++;
+            bits -= 8;
+            if(n >= size) return -1;
+
+            out[n ++] = (unsigned char)(acc >> bits);
         }
     }
 
-    return count;
+    return n;
 }
 
-/// Get numeric value between " "
-/// < start Start pos
-static int get_value(int start)
+/// Parse CSV data to a layer
+/// < ps Parser
+/// < layer Layer
+static void parse_CSV(PARSER* ps, LAYER layer)
 {
-    char num[8];
-    int n = 0;
-    for(; n < 8; n++) num[n] = '\0';
-    int i = start;
-    int p = 0;
-    for(; i < file_length && file_content[i] != '"'; i++)
+    int i = 0;
+    unsigned int v;
+
+    while(i < ps->t->tcount && scan_int(&ps->p,ps->end,&v))
     {
-        num[p] = file_content[i];
-        p ++;
+        layer[i ++] = (int)v;
     }
-    return strtol(num,NULL,10);
 }
 
-/// Get tilemap dimensions, in tiles
-/// < w Where width is stored
-/// < h Where height is stored
-static void get_dimensions(int* w, int* h)
+/// Parse base64 data to a layer, possibly compressed
+/// < ps Parser
+/// < layer Layer
+/// < zlib Is the data zlib compressed
+/// > 0 on success, 1 on error
+static int parse_base64(PARSER* ps, LAYER layer, bool zlib)
 {
-    const int WLEN = 3;
-    int count = 0;
+    const char* start = ps->p;
+    const char* end = memchr(start,'<',ps->end - start);
+    if(end == NULL) end = ps->end;
+    ps->p = end;
 
-    char * s = file_content;
+    int size = ps->t->tcount * 4;
+    int n;
 
+    if(zlib)
+    {
+        // Decode to a temporary buffer first
+        int len = (int)(end - start) / 4 * 3 + 3;
+        unsigned char* buf = (unsigned char*)malloc(len);
+        if(buf == NULL)
+        {
+            ps->err = "Memory allocation error!";
+            return 1;
+        }
+        n = decode_base64(start,end,buf,len);
+        if(n > 0)
+            n = stbi_zlib_decode_buffer((char*)layer,size,(const char*)buf,n);
+        free(buf);
+    }
+    else
+    {
+        n = decode_base64(start,end,(unsigned char*)layer,size);
+    }
+
+    if(n != size)
+    {
+        ps->err = "Invalid layer data";
+        return 1;
+    }
+
+    // Tile IDs are stored as little endian
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
     int i = 0;
-    for(; i < file_length - WLEN; i++)
+    for(; i < ps->t->tcount; ++ i)
+    {
+        layer[i] = (int)SDL_SwapLE32((Uint32)layer[i]);
+    }
+#endif
+
+    return 0;
+}
+
+/// Add a new layer
+/// < ps Parser
+/// > 0 on success, 1 on error
+static int add_layer(PARSER* ps)
+{
+    TILEMAP* t = ps->t;
+
+    if(t->layerCount >= ps->layerCapacity)
     {
-        if(
-         (count == 0 && ( s[i] == 't' && s[i+1] == 'h' && s[i+2] == '='))
-        ||
-         ( s[i] == 'h' && s[i+1] == 't' && s[i+2] == '=')
-        )
+        int cap = ps->layerCapacity == 0 ? 4 : ps->layerCapacity*2;
+        LAYER* layers = (LAYER*)realloc(t->layers,sizeof(LAYER) * cap);
+        if(layers == NULL)
         {
-            if(count == 1)
-            {
-                *h = get_value(i+4);
-                break;
-            }
-            else
-            {
-                *w = get_value(i+4);
-            }
-            count ++;
+            ps->err = "Memory allocation error!";
+            return 1;
         }
+        t->layers = layers;
+        ps->layerCapacity = cap;
+    }
+
+    t->layers[t->layerCount] = (LAYER)calloc(t->tcount > 0 ? t->tcount : 1,sizeof(int));
+    if(t->layers[t->layerCount] == NULL)
+    {
+        ps->err = "Memory allocation error!";
+        return 1;
     }
+    ++ t->layerCount;
 
+    return 0;
 }
 
-/// Get tile dimensions
-/// TODO: Repeating code, replace with something better
-/// < w Where width is stored
-/// < h Where height is stored
-static void get_tile_dimensions(int* w, int* h)
+/// Read a tag and its attributes. The position is
+/// expected to be after '<'
+/// < ps Parser
+/// < name Where the tag name is stored
+/// < nameLen Where the tag name length is stored
+/// < attr Where the attributes are stored
+/// < closed Is the tag self-closing
+/// > Attribute count
+static int read_tag(PARSER* ps, const char** name, int* nameLen, ATTRIBUTE* attr, bool* closed)
 {
-    const int WLEN = 3;
+    const char* p = ps->p;
+    const char* end = ps->end;
     int count = 0;
+    char quote;
 
-    char * s = file_content;
+    *name = p;
+    while(p < end && *p != '>' && *p != '/' && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r')
+    {
+        ++ p;
+    }
+    *nameLen = (int)(p - *name);
+    *closed = false;
 
-    int i = 0;
-    for(; i < file_length - WLEN; i++)
+    while(p < end && *p != '>')
     {
-        if(
-         (count == 0 && ( s[i] == 'e' && s[i+1] == 'w' && s[i+2] == 'i'))
-        ||
-         ( s[i] == 'e' && s[i+1] == 'h' && s[i+2] == 'e')
-        )
+        if(*p == '/')
         {
-            if(count == 1)
-            {
-                *h = get_value(i+9);
-                break;
-            }
-            else
-            {
-                *w = get_value(i+8);
-            }
-            count ++;
+            *closed = true;
+            ++ p;
+            continue;
+        }
+        if(*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+        {
+            ++ p;
+            continue;
         }
+
+        // Attribute name
+        ATTRIBUTE a;
+        a.name = p;
+        while(p < end && *p != '=' && *p != '>' && *p != ' ')
+        {
+            ++ p;
+        }
+        a.nameLen = (int)(p - a.name);
+        while(p < end && *p != '"' && *p != '\'' && *p != '>')
+        {
+            ++ p;
+        }
+        if(p >= end || *p == '>') break;
+
+        // Value
+        quote = *(p ++);
+        a.value = p;
+        while(p < end && *p != quote)
+        {
+            ++ p;
+        }
+        a.valueLen = (int)(p - a.value);
+        if(p < end) ++ p;
+
+        if(count < MAX_ATTRIBUTES)
+            attr[count ++] = a;
     }
 
+    ps->p = p < end ? p+1 : end;
+    return count;
 }
 
-/// Parse CSV data to a layer data
-/// < layer Layer
-/// < start Start position in the file content
-/// > End position
-static int parse_CSV(int* layer, int start)
+/// Handle a tag
+/// < ps Parser
+/// < name Tag name
+/// < len Tag name length
+/// < attr Attributes
+/// < count Attribute count
+/// < closed Is the tag self-closing
+/// > 0 on success, 1 on error
+static int handle_tag(PARSER* ps, const char* name, int len, ATTRIBUTE* attr, int count, bool closed)
 {
-    char* s = file_content;
-    int i = start;
-    int p = 0;
-    char buf[10];
-    int bp = 0;
+    TILEMAP* t = ps->t;
 
-    for(; i < file_length && s[i] != '<'; i++)
+    if(name_is(name,len,"map"))
+    {
+        t->width = get_int(attr,count,"width",0);
+        t->height = get_int(attr,count,"height",0);
+        t->tileW = get_int(attr,count,"tilewidth",0);
+        t->tileH = get_int(attr,count,"tileheight",0);
+        t->tcount = t->width * t->height;
+    }
+    else if(name_is(name,len,"layer"))
     {
-        if(s[i] != ',')
+        return add_layer(ps);
+    }
+    else if(name_is(name,len,"data") && !closed && t->layerCount > 0)
+    {
+        LAYER layer = t->layers[t->layerCount-1];
+
+        if(has_value(attr,count,"encoding","csv"))
+        {
+            parse_CSV(ps,layer);
+        }
+        else if(has_value(attr,count,"encoding","base64"))
         {
-            if(s[i] != ' ' && s[i] != '\t' && s[i] != '\n')
+            bool zlib = has_value(attr,count,"compression","zlib");
+            if(!zlib && has_attribute(attr,count,"compression"))
             {
-                buf[bp] = s[i];
-                bp ++;
+                ps->err = "Unsupported layer compression";
+                return 1;
             }
+            return parse_base64(ps,layer,zlib);
         }
         else
         {
-            if(bp > 0)
-            {
-                buf[bp] = '\0';
-                
-                layer[p] = (int)strtol(buf,NULL,10);
-                p ++;
-            }
-            bp = 0;
+            // Plain XML, one tag per tile
+            ps->inData = true;
+            ps->tileIndex = 0;
+        }
+    }
+    else if(name_is(name,len,"tile") && ps->inData && t->layerCount > 0)
+    {
+        if(ps->tileIndex < t->tcount)
+        {
+            t->layers[t->layerCount-1][ps->tileIndex ++] = get_int(attr,count,"gid",0);
         }
     }
-    layer[p] = (int)strtol(buf,NULL,10);
 
-    return i;
+    return 0;
 }
 
-/// Parse layers
-/// < layers Layers
-static void parse_layers(LAYER* layers)
+/// Parse the file content
+/// < ps Parser
+/// > 0 on success, 1 on error
+static int parse(PARSER* ps)
 {
-    const int WLEN = 3;
-    int count = 0;
+    ATTRIBUTE attr[MAX_ATTRIBUTES];
+    const char* name;
+    int len;
+    int count;
+    bool closed;
 
-    char * s = file_content;
-
-    int i = 0;
-    for(; i < file_length - WLEN; i++)
+    while(ps->p < ps->end)
     {
-        if( s[i] == 'v' && s[i+1] == '"' && s[i+2] == '>')
+        ps->p = memchr(ps->p,'<',ps->end - ps->p);
+        if(ps->p == NULL) break;
+        ++ ps->p;
+        if(ps->p >= ps->end) break;
+
+        // Comments, declarations & closing tags
+        if(*ps->p == '!' && ps->end - ps->p >= 3 && ps->p[1] == '-' && ps->p[2] == '-')
         {
-            i = parse_CSV(layers[count],i+3);
-            count ++;
+            while(ps->p+2 < ps->end && !(ps->p[0] == '-' && ps->p[1] == '-' && ps->p[2] == '>'))
+            {
+                ++ ps->p;
+            }
+            continue;
         }
+        if(*ps->p == '?' || *ps->p == '!' || *ps->p == '/')
+        {
+            if(*ps->p == '/' && ps->end - ps->p >= 5 && memcmp(ps->p+1,"data",4) == 0)
+                ps->inData = false;
+
+            continue;
+        }
+
+        count = read_tag(ps,&name,&len,attr,&closed);
+        if(handle_tag(ps,name,len,attr,count,closed) != 0)
+            return 1;
     }
+
+    return 0;
 }
 
 /// Load a tilemap from a file
 TILEMAP* load_tilemap(const char* path)
 {
-    // Allocate memory for the map
-    TILEMAP* t = (TILEMAP*)malloc(sizeof(TILEMAP));
-    if(t == NULL)
-    {
-        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!",NULL);
-        return NULL;
-    }
-    // Open file
-    FILE * f = fopen(path,"r");
+    MAPPED_FILE* f = map_file(path);
     if(f == NULL)
     {
         char err[128];
@@ -243,53 +464,83 @@ TILEMAP* load_tilemap(const char* path)
         return NULL;
     }
 
-    // Calculate length
-    calculate_length(f);
-    // Create content
-    if(create_content(f) != 0)
+    // Allocate memory for the map
+    TILEMAP* t = (TILEMAP*)calloc(1,sizeof(TILEMAP));
+    if(t == NULL)
     {
+        unmap_file(f);
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!",NULL);
         return NULL;
     }
-    // Close file
-    fclose(f);
-
-    // Count layers
-    t->layerCount = get_layer_count();
-   
-    // Get dimensions
-    get_dimensions(&t->width,&t->height);
-    get_tile_dimensions(&t->tileW,&t->tileH);
-   
+
+    // Parse
+    PARSER ps;
+    ps.p = (const char*)f->data;
+    ps.end = ps.p + f->size;
+    ps.t = t;
+    ps.layerCapacity = 0;
+    ps.inData = false;
+    ps.tileIndex = 0;
+    ps.err = NULL;
+
+    int ret = parse(&ps);
+    unmap_file(f);
+    if(ret != 0)
+    {
+        char err[256];
+        snprintf(err,256,"Failed to parse a tilemap in %s: %s",path,ps.err);
+
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!",err,NULL);
+        destroy_tilemap(t);
+        return NULL;
+    }
+
     // Calculate size in pixels
     t->pwidth = t->width * t->tileW;
     t->pheight = t->height * t->tileH;
-    // Set tile count
-    t->tcount = t->width * t->height;
+
+    return t;
+}
+
+/// Create a tilemap with empty layers
+TILEMAP* create_tilemap(int width, int height, int tileW, int tileH, int layerCount)
+{
+    TILEMAP* t = (TILEMAP*)malloc(sizeof(TILEMAP));
+    if(t == NULL)
+    {
+        SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!",NULL);
+        return NULL;
+    }
+
+    t->width = width;
+    t->height = height;
+    t->tileW = tileW;
+    t->tileH = tileH;
+    t->pwidth = width * tileW;
+    t->pheight = height * tileH;
+    t->tcount = width * height;
+    t->layerCount = layerCount;
 
     // Allocate memory for the layers
-    t->layers = (LAYER*)malloc(sizeof(LAYER) * t->layerCount);
+    t->layers = (LAYER*)malloc(sizeof(LAYER) * layerCount);
     if(t->layers == NULL)
     {
+        free(t);
         SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!",NULL);
         return NULL;
     }
     int i = 0;
-    for(; i < t->layerCount; i++)
+    for(; i < layerCount; i++)
     {
-        t->layers[i] = (LAYER)malloc(sizeof(int) * t->width * t->height);
+        t->layers[i] = (LAYER)calloc(width * height,sizeof(int));
         if(t->layers[i] == NULL)
         {
-            free(t->layers);
+            t->layerCount = i;
+            destroy_tilemap(t);
             SDL_ShowSimpleMessageBox( SDL_MESSAGEBOX_ERROR,"Error!","Memory allocation error!",NULL);
             return NULL;
         }
     }
-    // Parse layers
-    parse_layers(t->layers);
-
-    // Free memory & set globals to their default values
-    free(file_content);
-    file_length = 0;
 
     return t;
 }
@@ -305,5 +556,6 @@ void destroy_tilemap(TILEMAP* t)
     {
         free(t->layers[i]);
     }
+    free(t->layers);
     free(t);
-}
\ No newline at end of file
+}
@@ -31,11 +31,21 @@ typedef struct
 }
 TILEMAP;
 
-/// Load a tilemap from a file
+/// Load a tilemap from a file. Layer data can be CSV,
+/// XML, base64 or zlib compressed base64
 /// < path Tilemap path
 /// > A new tilemap
 TILEMAP* load_tilemap(const char* path);
 
+/// Create a tilemap with empty layers
+/// < width Width in tiles
+/// < height Height in tiles
+/// < tileW Tile width
+/// < tileH Tile height
+/// < layerCount Layer count
+/// > A new tilemap
+TILEMAP* create_tilemap(int width, int height, int tileW, int tileH, int layerCount);
+
 /// Destroy a tilemap
 /// < t Tilemap
 void destroy_tilemap(TILEMAP* t);
@@ -45,13 +45,19 @@ static bool cursorMoving;
 static float wave;
 
 
-// Change to game scene
-static void change_to_game()
+// Prepare the game scene while fading
+static void prepare_game()
 {
     int id = cursorPos.y * 5 + cursorPos.x;
     status_set_if_final(id == 13 -1);
 
-    game_set_stage(get_stage_info(id));
+    game_prepare_stage(get_stage_info(id));
+}
+
+
+// Change to game scene
+static void change_to_game()
+{
     app_swap_scene("game");
 }
 
@@ -308,7 +314,7 @@ void grid_update(float tm)
         else
         {
             fade_out_music(500);
-            trn_set(FADE_IN,BLACK_CIRCLE,2.0f,change_to_game);
+            trn_set_prepared(BLACK_CIRCLE,2.0f,prepare_game,game_is_stage_prepared,change_to_game);
         }
 
         play_sample(sAccept,0.50f);
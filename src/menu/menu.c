@@ -13,6 +13,7 @@
 #include "../global.h"
 #include "../vpad.h"
 #include "../transition.h"
+#include "../asset_ids.h"
 
 #include "../game/status.h"
 
@@ -39,6 +40,12 @@ static float cloudPos;
 // Ending played
 static int endingPlayed;
 
+// Assets preloaded when the scene starts
+static const int MENU_ASSETS[] = {
+    ASSET_ID_SKY2, ASSET_ID_CLOUDS1, ASSET_ID_STAGE_BUTTONS, ASSET_ID_BIG_CURSOR,
+    ASSET_ID_LOGO, ASSET_ID_SKY4, ASSET_ID_INTRO_IMG, ASSET_ID_MENU, ASSET_ID_REJECT,
+};
+
 
 // Draw background
 static void draw_background()
@@ -79,6 +86,10 @@ static int menu_init()
 
     endingPlayed = 0;
 
+    // The menu is the first scene, so the rest
+    // of the scenes are loaded later
+    preload_asset_set(ass,MENU_ASSETS,sizeof(MENU_ASSETS) / sizeof(int));
+
     return 0;
 }
 
@@ -147,6 +158,7 @@ static void menu_on_swap()
         return;
     }
 
+    preload_asset_set(get_global_assets(),MENU_ASSETS,sizeof(MENU_ASSETS) / sizeof(int));
     play_music(mMenu,0.80f,-1);
 }
 
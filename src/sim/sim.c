@@ -0,0 +1,391 @@
+/// Headless simulation (source)
+/// (c) 2018 Jani Nykänen
+
+#include "sim.h"
+
+#include "../engine/controls.h"
+
+#include "../game/stage.h"
+#include "../game/objects.h"
+#include "../game/progress.h"
+#include "../game/hooks.h"
+#include "../game/zobrist.h"
+
+#include "string.h"
+
+// The rules are run at the speed of a 60 fps frame
+static const float SIM_TM = 1.0f;
+// Frames the objects must stay still to be settled
+static const int SETTLE_FRAMES = 2;
+// Maximum frames per step, in case something never settles
+static const int MAX_STEP_FRAMES = 10000;
+// Bits of the packed counters
+static const int KEY_BITS = 8;
+static const int TURN_BITS = 16;
+
+// Saved state, followed by the stage and the object states
+typedef struct
+{
+    PROGRESS_STATE progress;
+    bool dead;
+    bool won;
+    Uint32 frames;
+}
+SIM_SAVED;
+
+// Simulated input
+static RULE_STATE VEC2 stick;
+static RULE_STATE int button;
+// Is the player dead
+static RULE_STATE bool dead;
+// Is the star reached
+static RULE_STATE bool won;
+// Frames simulated
+static RULE_STATE Uint32 frames;
+// Are the quiet frames skipped
+static RULE_STATE bool instant = false;
+
+
+// Get the simulated stick
+static VEC2 sim_get_stick()
+{
+    return stick;
+}
+
+
+// Get the simulated button
+static int sim_get_button(int id)
+{
+    return id == 0 ? button : UP;
+}
+
+
+// Simulated input source
+static const GAME_INPUT SIM_INPUT = {sim_get_stick, sim_get_button};
+
+
+// Game event, only the outcome matters here
+static void on_sim_event(int event)
+{
+    if(event == EVENT_DYING)
+        dead = true;
+    else if(event == EVENT_VICTORY)
+        won = true;
+}
+
+
+// Run one frame
+static void run_frame()
+{
+    obj_update(SIM_TM);
+    ++ frames;
+}
+
+
+// Run the next frame, or skip the quiet
+// frames before the next change. A released
+// button is seen in one frame only
+static int next_frames(int max)
+{
+    int n = instant && button != RELEASED ? obj_skip_quiet_frames(max) : 0;
+    if(n > 0)
+    {
+        frames += n;
+        return n;
+    }
+
+    run_frame();
+    return 1;
+}
+
+
+// Is there a boulder in x,y
+static bool is_boulder(int x, int y)
+{
+    OBJECT* o;
+    int i = 0;
+    for(; i < obj_count(); ++ i)
+    {
+        o = obj_get(i);
+        if(o->type == OBJ_BOULDER && o->exist && o->x == x && o->y == y)
+            return true;
+    }
+    return false;
+}
+
+
+// Get the result
+static int get_result(int oldTurns)
+{
+    if(dead) return SIM_DEAD;
+    if(won) return SIM_WON;
+
+    return progress_get_turn_count() != oldTurns ? SIM_MOVED : SIM_NONE;
+}
+
+
+// Load a stage
+int sim_load(const STAGE* s)
+{
+    set_game_input(&SIM_INPUT);
+    set_event_callback(on_sim_event);
+
+    stick = vec2(0.0f,0.0f);
+    button = UP;
+    dead = false;
+    won = false;
+    frames = 0;
+
+    // Same order as when the game sets a stage
+    obj_init();
+    obj_clear();
+    if(stage_set_map(s) != 0)
+        return 1;
+
+    stage_reset(false);
+
+    stage_reset(true);
+    progress_reset();
+    obj_reset();
+
+    // Packed states store what differs from here
+    stage_set_start();
+
+    return 0;
+}
+
+
+// Take an action
+int sim_step(int action)
+{
+    if(dead || won || stage_get_map() == NULL)
+        return get_result(progress_get_turn_count());
+
+    PLAYER* pl = obj_get_player();
+    int oldTurns = progress_get_turn_count();
+    int n;
+    bool push = action == ACTION_PUSH_JUMP_LEFT || action == ACTION_PUSH_JUMP_RIGHT;
+    bool jump = push || action == ACTION_JUMP_LEFT || action == ACTION_JUMP_RIGHT;
+
+    VEC2 dir;
+    switch(action)
+    {
+    case ACTION_LEFT:
+    case ACTION_JUMP_LEFT:
+    case ACTION_PUSH_JUMP_LEFT:
+        dir = vec2(-1.0f,0.0f);
+        break;
+    case ACTION_RIGHT:
+    case ACTION_JUMP_RIGHT:
+    case ACTION_PUSH_JUMP_RIGHT:
+        dir = vec2(1.0f,0.0f);
+        break;
+    case ACTION_UP:
+        dir = vec2(0.0f,-1.0f);
+        break;
+    case ACTION_DOWN:
+        dir = vec2(0.0f,1.0f);
+        break;
+    default:
+        return SIM_NONE;
+    }
+
+    // Without a boulder to push, the direction held
+    // is the same as the direction chosen later
+    if(push && !is_boulder(pl->x + (int)dir.x,pl->y))
+        return SIM_NONE;
+
+    // A move is taken on the first frame. A jump is pressed with
+    // the stick at rest, since a stick held against a boulder would
+    // push it, and the direction is chosen while the player bounces
+    stick = jump && !push ? vec2(0.0f,0.0f) : dir;
+    button = jump ? PRESSED : UP;
+    run_frame();
+
+    int i = 0;
+    if(jump)
+    {
+        stick = dir;
+        button = RELEASED;
+        while(i < MAX_STEP_FRAMES && pl->bouncing && !dead && !won)
+        {
+            i += next_frames(MAX_STEP_FRAMES - i);
+            button = UP;
+        }
+    }
+    stick = vec2(0.0f,0.0f);
+    button = UP;
+
+    // Run until everything has settled. The
+    // quiet frames are as settled as the frame before
+    int still = 0;
+    int max;
+    for(i = 0; i < MAX_STEP_FRAMES && still < SETTLE_FRAMES && !dead && !won; )
+    {
+        max = MAX_STEP_FRAMES - i;
+        if(obj_have_settled() && max > SETTLE_FRAMES - still)
+            max = SETTLE_FRAMES - still;
+
+        n = next_frames(max);
+        i += n;
+        still = obj_have_settled() ? still+n : 0;
+    }
+
+    // Something never settled, like a boulder sinking
+    // into lava that was toggled to a block meanwhile
+    if(still < SETTLE_FRAMES && !dead && !won)
+        return SIM_STUCK;
+
+    return get_result(oldTurns);
+}
+
+
+// Set instant mode
+void sim_set_instant(bool state)
+{
+    instant = state;
+}
+
+
+// Get the state
+SIM_STATE sim_state()
+{
+    PLAYER* pl = obj_get_player();
+    POINT dim = stage_get_map() != NULL ? stage_get_map_size() : point(0,0);
+
+    SIM_STATE st;
+    st.x = pl->x;
+    st.y = pl->y;
+    st.turns = progress_get_turn_count();
+    st.keys = progress_get_key_count();
+    st.elecOn = stage_is_electricity_on();
+    st.dead = dead;
+    st.won = won;
+    st.frames = frames;
+
+    st.width = dim.x;
+    st.height = dim.y;
+    st.layer = stage_get_layer_data();
+    st.collision = stage_get_collision_map();
+
+    return st;
+}
+
+
+
+// Get state size
+size_t sim_get_state_size()
+{
+    return sizeof(SIM_SAVED) + stage_get_state_size() + obj_get_state_size();
+}
+
+
+// Save state
+void sim_save_state(void* buf)
+{
+    Uint8* p = (Uint8*)buf;
+
+    SIM_SAVED sv;
+    progress_save_state(&sv.progress);
+    sv.dead = dead;
+    sv.won = won;
+    sv.frames = frames;
+    memcpy(p,&sv,sizeof(SIM_SAVED));
+    p += sizeof(SIM_SAVED);
+
+    stage_save_state(p);
+    obj_save_state(p + stage_get_state_size());
+}
+
+
+// Load state
+void sim_load_state(const void* buf)
+{
+    const Uint8* p = (const Uint8*)buf;
+
+    SIM_SAVED sv;
+    memcpy(&sv,p,sizeof(SIM_SAVED));
+    progress_load_state(&sv.progress);
+    dead = sv.dead;
+    won = sv.won;
+    frames = sv.frames;
+    p += sizeof(SIM_SAVED);
+
+    stage_load_state(p);
+    obj_load_state(p + stage_get_state_size());
+}
+
+
+// Get hash
+Uint64 sim_get_hash()
+{
+    return stage_get_hash() ^ obj_get_hash()
+        ^ zobrist_key(ZOBRIST_KEYS,progress_get_key_count());
+}
+
+
+// Get layout hash
+Uint64 sim_get_layout_hash()
+{
+    Uint64 h = sim_get_hash();
+    POINT dim = stage_get_map_size();
+    const Uint8* col = stage_get_collision_map();
+
+    int i = 0;
+    for(; i < dim.x*dim.y; ++ i)
+    {
+        h ^= zobrist_key(ZOBRIST_COLLISION + i,col[i]);
+    }
+    for(i = 0; i < obj_count(); ++ i)
+    {
+        if(obj_get(i)->type == OBJ_ENEMY)
+            h ^= zobrist_key(ZOBRIST_OBJECTS + i,obj_get_word(i));
+    }
+    return h;
+}
+
+
+// Get packed size
+size_t sim_get_packed_size()
+{
+    size_t bits = KEY_BITS + TURN_BITS + stage_get_packed_bits();
+    if(stage_get_map() != NULL)
+        bits += obj_get_packed_bits();
+
+    return (bits + 7) / 8;
+}
+
+
+// Pack
+size_t sim_pack(void* buf)
+{
+    BIT_STREAM s = bits_create(buf);
+    int turns = progress_get_turn_count();
+
+    bits_write(&s,progress_get_key_count(),KEY_BITS);
+    bits_write(&s,turns < 0xFFFF ? turns : 0xFFFF,TURN_BITS);
+    stage_pack(&s);
+    if(stage_get_map() != NULL)
+        obj_pack(&s);
+
+    return bits_get_size(&s);
+}
+
+
+// Unpack
+void sim_unpack(const void* buf)
+{
+    BIT_STREAM s = bits_create((void*)buf);
+
+    PROGRESS_STATE pr;
+    pr.keys = (int)bits_read(&s,KEY_BITS);
+    pr.turns = (int)bits_read(&s,TURN_BITS);
+    progress_load_state(&pr);
+
+    stage_unpack(&s);
+    if(stage_get_map() != NULL)
+        obj_unpack(&s);
+
+    dead = false;
+    won = false;
+}
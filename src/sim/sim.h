@@ -0,0 +1,132 @@
+/// Headless simulation (header)
+/// (c) 2018 Jani Nykänen
+///
+/// Runs the game rules without a window, audio or input
+/// devices, one turn at a time. Built to libaqffos_sim.a
+/// for validating stages and for bots. Each thread has
+/// a simulation of its own
+
+#ifndef __SIM__
+#define __SIM__
+
+#include "../lib/stagefile.h"
+
+#include "SDL2/SDL.h"
+
+#include "stdbool.h"
+#include "stddef.h"
+
+/// Actions, one turn each
+enum
+{
+    ACTION_LEFT = 0,
+    ACTION_RIGHT = 1,
+    ACTION_UP = 2,
+    ACTION_DOWN = 3,
+    ACTION_JUMP_LEFT = 4, /// Jump pressed, then the direction chosen
+    ACTION_JUMP_RIGHT = 5,
+    ACTION_PUSH_JUMP_LEFT = 6, /// Direction held when the jump is pressed,
+    ACTION_PUSH_JUMP_RIGHT = 7, /// which pushes a boulder next to the player
+};
+
+/// Amount of actions
+#define ACTION_COUNT 8
+
+/// Step results
+enum
+{
+    SIM_NONE = 0, /// The action was not possible
+    SIM_MOVED = 1, /// A turn was taken
+    SIM_DEAD = 2, /// The player died
+    SIM_WON = 3, /// The star was reached
+    SIM_STUCK = 4, /// The objects never settled, nothing can move again
+};
+
+/// Simulation state
+typedef struct
+{
+    int x; /// Player x coordinate (in grid)
+    int y; /// Player y coordinate (in grid)
+    int turns;
+    int keys;
+    bool elecOn;
+    bool dead;
+    bool won;
+    Uint32 frames; /// Frames simulated since the load
+
+    int width;
+    int height;
+    const Uint8* layer; /// Tile layer, width*height tiles
+    const Uint8* collision; /// Collision map, width*height tiles
+}
+SIM_STATE;
+
+/// Load a stage and reset the simulation. The hooks of
+/// the game rules are pointed to the simulation
+/// < stage Stage, must stay valid while simulated
+/// > 0 on success, 1 if the stage is too big
+int sim_load(const STAGE* stage);
+
+/// Take an action and run the rules until the
+/// objects have settled
+/// < action Action
+/// > Step result
+int sim_step(int action);
+
+/// Get the simulation state
+/// > State
+SIM_STATE sim_state();
+
+/// Set the instant mode. In the instant mode a step runs the rules
+/// only on the frames where something changes. In the frames between
+/// them only the objects that move and the player are updated, and
+/// the idle ones are skipped. The outcome and the frame count of a
+/// step are the same as without the instant mode
+/// < state True to enable
+void sim_set_instant(bool state);
+
+/// Get the size of a saved simulation state
+/// > Size in bytes, the same for every state of the stage
+size_t sim_get_state_size();
+
+/// Save the simulation state, to go back to it
+/// later or to copy it to another thread
+/// < buf Buffer, sim_get_state_size() bytes
+void sim_save_state(void* buf);
+
+/// Load a saved state. The stage loaded with sim_load
+/// must be the same that the state was saved from
+/// < buf Buffer
+void sim_load_state(const void* buf);
+
+/// Get the hash of the state. It is kept up to date as the
+/// rules change the state, so getting it costs nothing. The
+/// turn count, the animations and the way the player faces
+/// are not hashed
+/// > Hash
+Uint64 sim_get_hash();
+
+/// Get the hash of the layout of the state: the tiles, the
+/// counters and the objects but the enemies. The collision
+/// map is left out, since the enemies clear the cells they pass
+/// > Hash
+Uint64 sim_get_layout_hash();
+
+/// Get the maximum size of a packed state
+/// > Size in bytes
+size_t sim_get_packed_size();
+
+/// Pack the state between the steps, when nothing moves. Only
+/// the counters, the tiles that differ from the start of the stage
+/// and the cells and the directions of the objects are stored, a
+/// few dozen bytes. The same state always packs to the same bytes
+/// < buf Buffer, sim_get_packed_size() bytes
+/// > Packed size in bytes
+size_t sim_pack(void* buf);
+
+/// Unpack a state packed from the stage loaded with
+/// sim_load. The player is alive
+/// < buf Packed state
+void sim_unpack(const void* buf);
+
+#endif // __SIM__
@@ -24,6 +24,10 @@ static float timer;
 
 // Callback function
 static void (*callback)(void);
+// Preparation state check
+static bool (*readyCheck)(void);
+// Is the screen kept black until the preparation is ready
+static bool waiting;
 
 
 // Initialize transition
@@ -33,6 +37,8 @@ void trn_init(ASSET_PACK* ass)
     fadeMode = BLACK_CIRCLE;
     speed = 1.0f;
     timer = 0.0f;
+    readyCheck = NULL;
+    waiting = false;
 
     // Get assets
     bmpCircle = (BITMAP*)get_asset(ass,"blackCircle");
@@ -47,17 +53,43 @@ void trn_set(int fading, int type, float s, void (*cb)(void))
     mode = type;
     timer = TIMER_MAX;
     callback = cb;
+    readyCheck = NULL;
+    waiting = false;
+}
+
+
+// Set a preparing transition
+void trn_set_prepared(int type, float s, void (*prepare)(void),
+    bool (*ready)(void), void (*cb)(void))
+{
+    trn_set(FADE_IN,type,s,cb);
+    readyCheck = ready;
+
+    if(prepare != NULL)
+    {
+        prepare();
+    }
 }
 
 
 // Update transition
 void trn_update(float tm)
 {
-    if(timer > 0.0f)
+    // The preparation is polled during the whole fade,
+    // so it can continue its work in steps
+    bool ready = fadeMode != FADE_IN || readyCheck == NULL || readyCheck();
+
+    if(timer > 0.0f || waiting)
     {
         timer -= speed * tm;
-        if(timer <= 0.0f && fadeMode == FADE_IN)
+        waiting = timer <= 0.0f && !ready;
+        if(waiting)
+        {
+            timer = 0.0f;
+        }
+        else if(timer <= 0.0f && fadeMode == FADE_IN)
         {
+            readyCheck = NULL;
             if(callback != NULL)
             {
                 callback();
@@ -72,7 +104,7 @@ void trn_update(float tm)
 // Draw transition
 void trn_draw()
 {
-    if(timer <= 0.0f) return;
+    if(timer <= 0.0f && !waiting) return;
 
     float t = timer/TIMER_MAX;
     if(fadeMode == FADE_IN) t = 1.0f - t;
@@ -111,5 +143,5 @@ void trn_draw()
 // Is active
 bool trn_is_active()
 {
-    return timer > 0.0f;
+    return timer > 0.0f || waiting;
 }
\ No newline at end of file
@@ -33,6 +33,18 @@ void trn_init(ASSET_PACK* ass);
 /// < cb Callback
 void trn_set(int fading, int type, float speed, void (*cb)(void));
 
+/// Set a fading in transition that prepares the next state
+/// while it fades. The preparation is started right away, and
+/// the screen stays black at the end of the fade until it is
+/// ready. Then the callback only has to swap the state in
+/// < type Transition type
+/// < speed Transition speed (1.0 by default)
+/// < prepare Starts the preparation, may be NULL
+/// < ready Polled once a frame, true when ready, may be NULL
+/// < cb Callback
+void trn_set_prepared(int type, float speed, void (*prepare)(void),
+    bool (*ready)(void), void (*cb)(void));
+
 /// Update transition
 /// < tm Time multiplier
 void trn_update(float tm);
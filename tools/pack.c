@@ -0,0 +1,440 @@
+/// Asset packer (source)
+/// (c) 2018 Jani Nykänen
+///
+/// Reads an asset list and writes a binary archive
+/// that can be loaded with load_asset_pack, or a header
+/// of asset IDs for get_asset_by_id.
+/// Usage: pack <asset list> <output archive>
+///        pack -ids <asset list> <output header>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../src/lib/stb_image.h"
+
+#include "../src/lib/parseword.h"
+#include "../src/lib/tmxc.h"
+#include "../src/lib/indexed.h"
+#include "../src/lib/pcm.h"
+
+#include "../src/engine/archive.h"
+#include "../src/engine/assets.h"
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "stdbool.h"
+#include "ctype.h"
+
+// Packed entry
+typedef struct
+{
+    ARCHIVE_ENTRY entry;
+    unsigned char* data;
+}
+PACKED;
+
+// Entries
+static PACKED* entries;
+// Entry count
+static int entryCount;
+// Entry capacity
+static int entryCapacity;
+// Only read the names
+static bool namesOnly;
+
+
+// Read a whole file
+static unsigned char* read_whole_file(const char* path, uint32_t* size)
+{
+    FILE* f = fopen(path,"rb");
+    if(f == NULL) return NULL;
+
+    fseek(f,0,SEEK_END);
+    long len = ftell(f);
+    fseek(f,0,SEEK_SET);
+
+    unsigned char* data = (unsigned char*)malloc(len > 0 ? len : 1);
+    if(data == NULL || fread(data,1,len,f) != (size_t)len)
+    {
+        free(data);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+
+    *size = (uint32_t)len;
+    return data;
+}
+
+
+// Pack a bitmap. Bitmaps with at most 256 colours
+// are stored as palette indices
+static unsigned char* pack_bitmap(const char* path, uint32_t* size)
+{
+    int w, h, comp;
+    unsigned char* pixels = stbi_load(path,&w,&h,&comp,4);
+    if(pixels == NULL) return NULL;
+
+    uint32_t colors[INDEXED_MAX_COLORS];
+    unsigned char* indices = (unsigned char*)malloc((size_t)w*h);
+    int colorCount = indices != NULL ? index_pixels(pixels,w*h,indices,colors) : -1;
+    int bits = colorCount >= 0 ? get_index_bits(colorCount) : 32;
+    size_t rowSize = colorCount >= 0 ? get_index_row_size(w,bits) : (size_t)w*4;
+
+    *size = sizeof(ARCHIVE_BITMAP) + h*rowSize;
+    if(colorCount >= 0)
+        *size += colorCount * 4;
+
+    unsigned char* data = (unsigned char*)calloc(1,*size);
+    if(data == NULL)
+    {
+        free(indices);
+        stbi_image_free(pixels);
+        return NULL;
+    }
+
+    ARCHIVE_BITMAP* head = (ARCHIVE_BITMAP*)data;
+    head->width = w;
+    head->height = h;
+
+    unsigned char* out = data + sizeof(ARCHIVE_BITMAP);
+    if(colorCount < 0)
+    {
+        head->format = ARCHIVE_RGBA;
+        memcpy(out,pixels,w*h*4);
+    }
+    else
+    {
+        head->format = bits == 4 ? ARCHIVE_INDEX4 : ARCHIVE_INDEX8;
+        head->colorCount = colorCount;
+        memcpy(out,colors,colorCount*4);
+        out += colorCount*4;
+
+        int y = 0;
+        for(; y < h; ++ y)
+        {
+            pack_index_row(indices + y*w,w,bits,out + y*rowSize);
+        }
+    }
+
+    free(indices);
+    stbi_image_free(pixels);
+    return data;
+}
+
+
+// Pack a tilemap
+static unsigned char* pack_tilemap(const char* path, uint32_t* size)
+{
+    TILEMAP* t = load_tilemap(path);
+    if(t == NULL) return NULL;
+
+    *size = sizeof(ARCHIVE_TILEMAP) + t->layerCount * t->tcount * 4;
+    unsigned char* data = (unsigned char*)calloc(1,*size);
+    if(data == NULL)
+    {
+        destroy_tilemap(t);
+        return NULL;
+    }
+
+    ARCHIVE_TILEMAP* head = (ARCHIVE_TILEMAP*)data;
+    head->width = t->width;
+    head->height = t->height;
+    head->tileW = t->tileW;
+    head->tileH = t->tileH;
+    head->layerCount = t->layerCount;
+
+    int32_t* tiles = (int32_t*)(data + sizeof(ARCHIVE_TILEMAP));
+    int i = 0;
+    int j;
+    for(; i < t->layerCount; ++ i)
+    {
+        for(j = 0; j < t->tcount; ++ j)
+            tiles[i*t->tcount + j] = (int32_t)t->layers[i][j];
+    }
+
+    destroy_tilemap(t);
+    return data;
+}
+
+
+// Pack a sample. Samples are decoded and converted to
+// the output format of the audio device when packing, so
+// the game can use them as they are
+static unsigned char* pack_sample(const char* path, uint32_t* size)
+{
+    SDL_AudioSpec spec;
+    spec.freq = PCM_FREQUENCY;
+    spec.format = PCM_FORMAT;
+    spec.channels = PCM_CHANNELS;
+
+    Uint32 len;
+    Uint8* pcm = decode_wav(SDL_RWFromFile(path,"rb"),&spec,&len);
+    if(pcm == NULL) return NULL;
+
+    *size = sizeof(ARCHIVE_SAMPLE) + len;
+    unsigned char* data = (unsigned char*)calloc(1,*size);
+    if(data == NULL)
+    {
+        free(pcm);
+        return NULL;
+    }
+
+    ARCHIVE_SAMPLE* head = (ARCHIVE_SAMPLE*)data;
+    head->frequency = spec.freq;
+    head->format = spec.format;
+    head->channels = spec.channels;
+    head->size = len;
+    memcpy(data + sizeof(ARCHIVE_SAMPLE),pcm,len);
+
+    free(pcm);
+    return data;
+}
+
+
+// Add an entry
+static int add_entry(const char* name, int type, const char* path)
+{
+    uint32_t size = 0;
+    unsigned char* data = NULL;
+
+    if(strlen(name) >= ARCHIVE_NAME_SIZE)
+    {
+        fprintf(stderr,"Asset name too long: %s\n",name);
+        return 1;
+    }
+
+    switch(namesOnly ? -1 : type)
+    {
+    case -1:
+        data = (unsigned char*)calloc(1,1);
+        break;
+    case ASSET_BITMAP:
+        data = pack_bitmap(path,&size);
+        break;
+    case ASSET_TILEMAP:
+        data = pack_tilemap(path,&size);
+        break;
+    case ASSET_SAMPLE:
+        data = pack_sample(path,&size);
+        break;
+    default:
+        // Music and stages are stored as they are
+        data = read_whole_file(path,&size);
+        break;
+    }
+    if(data == NULL)
+    {
+        fprintf(stderr,"Failed to pack %s\n",path);
+        return 1;
+    }
+
+    if(entryCount >= entryCapacity)
+    {
+        entryCapacity = entryCapacity == 0 ? 64 : entryCapacity*2;
+        entries = (PACKED*)realloc(entries,sizeof(PACKED) * entryCapacity);
+        if(entries == NULL)
+        {
+            fprintf(stderr,"Memory allocation error!\n");
+            return 1;
+        }
+    }
+
+    PACKED* p = &entries[entryCount ++];
+    memset(&p->entry,0,sizeof(ARCHIVE_ENTRY));
+    strncpy(p->entry.name,name,ARCHIVE_NAME_SIZE-1);
+    p->entry.type = type;
+    p->entry.size = size;
+    p->data = data;
+
+    return 0;
+}
+
+
+// Read the asset list
+static int read_list(const char* path)
+{
+    WORDDATA* w = parse_file(path);
+    if(w == NULL) return 1;
+
+    char* dir = "";
+    int type = ASSET_BITMAP;
+    bool begun = false;
+    char* name;
+    char full[1024];
+    int i = 0;
+
+    for(; i < w->wordCount; ++ i)
+    {
+        char* word = get_word(w,i);
+        if(!begun)
+        {
+            if(strcmp(word,"@path") == 0 && i+1 < w->wordCount)
+            {
+                dir = get_word(w,++ i);
+            }
+            else if(strcmp(word,"@type") == 0 && i+1 < w->wordCount)
+            {
+                word = get_word(w,++ i);
+                if(strcmp(word,"bitmap") == 0) type = ASSET_BITMAP;
+                else if(strcmp(word,"tilemap") == 0) type = ASSET_TILEMAP;
+                else if(strcmp(word,"music") == 0) type = ASSET_MUSIC;
+                else if(strcmp(word,"sample") == 0) type = ASSET_SAMPLE;
+                else if(strcmp(word,"stage") == 0) type = ASSET_STAGE;
+            }
+            else if(strcmp(word,"{") == 0)
+            {
+                begun = true;
+            }
+            continue;
+        }
+
+        if(strcmp(word,"}") == 0)
+        {
+            begun = false;
+            continue;
+        }
+        if(i+1 >= w->wordCount) break;
+
+        name = word;
+        snprintf(full,1024,"%s%s",dir,get_word(w,++ i));
+        if(add_entry(name,type,full) != 0)
+        {
+            destroy_word_data(w);
+            return 1;
+        }
+    }
+
+    destroy_word_data(w);
+    return 0;
+}
+
+
+// Write the archive
+static int write_archive(const char* path)
+{
+    FILE* f = fopen(path,"wb");
+    if(f == NULL)
+    {
+        fprintf(stderr,"Failed to create %s\n",path);
+        return 1;
+    }
+
+    // Compute offsets
+    uint32_t offset = sizeof(ARCHIVE_HEADER) + sizeof(ARCHIVE_ENTRY) * entryCount;
+    int i = 0;
+    for(; i < entryCount; ++ i)
+    {
+        offset = (offset + ARCHIVE_ALIGN-1) & ~(uint32_t)(ARCHIVE_ALIGN-1);
+        entries[i].entry.offset = offset;
+        offset += entries[i].entry.size;
+    }
+
+    // Header & entry table
+    ARCHIVE_HEADER head;
+    memset(&head,0,sizeof(ARCHIVE_HEADER));
+    memcpy(head.magic,ARCHIVE_MAGIC,4);
+    head.version = ARCHIVE_VERSION;
+    head.entryCount = entryCount;
+    fwrite(&head,sizeof(ARCHIVE_HEADER),1,f);
+    for(i = 0; i < entryCount; ++ i)
+    {
+        fwrite(&entries[i].entry,sizeof(ARCHIVE_ENTRY),1,f);
+    }
+
+    // Data
+    static const unsigned char zero[ARCHIVE_ALIGN] = {0};
+    long pos;
+    for(i = 0; i < entryCount; ++ i)
+    {
+        pos = ftell(f);
+        fwrite(zero,1,entries[i].entry.offset - pos,f);
+        fwrite(entries[i].data,1,entries[i].entry.size,f);
+    }
+
+    if(ferror(f))
+    {
+        fclose(f);
+        fprintf(stderr,"Failed to write %s\n",path);
+        return 1;
+    }
+    fclose(f);
+
+    printf("Packed %d assets, %u bytes\n",entryCount,offset);
+    return 0;
+}
+
+
+// Write the asset ID header. IDs are the
+// indices of the assets in the list
+static int write_ids(const char* path, const char* listPath)
+{
+    FILE* f = fopen(path,"w");
+    if(f == NULL)
+    {
+        fprintf(stderr,"Failed to create %s\n",path);
+        return 1;
+    }
+
+    fprintf(f,"/// Asset IDs (header)\n");
+    fprintf(f,"/// Generated from %s with \"make asset_ids\", do not edit\n\n",listPath);
+    fprintf(f,"#ifndef __ASSET_IDS__\n#define __ASSET_IDS__\n\n");
+    fprintf(f,"/// Asset IDs\nenum\n{\n");
+
+    // camelCase names become upper snake case
+    char id[ARCHIVE_NAME_SIZE*2];
+    const char* name;
+    int i = 0;
+    int j;
+    int k;
+    for(; i < entryCount; ++ i)
+    {
+        name = entries[i].entry.name;
+        for(j = 0, k = 0; name[j] != 0; ++ j)
+        {
+            if(j > 0 && isupper((unsigned char)name[j]) && islower((unsigned char)name[j-1]))
+                id[k ++] = '_';
+
+            id[k ++] = isalnum((unsigned char)name[j]) ? toupper((unsigned char)name[j]) : '_';
+        }
+        id[k] = 0;
+
+        fprintf(f,"    ASSET_ID_%s = %d,\n",id,i);
+    }
+    fprintf(f,"    ASSET_ID_COUNT = %d\n};\n\n",entryCount);
+    fprintf(f,"#endif // __ASSET_IDS__\n");
+
+    if(ferror(f))
+    {
+        fclose(f);
+        fprintf(stderr,"Failed to write %s\n",path);
+        return 1;
+    }
+    fclose(f);
+
+    return 0;
+}
+
+
+// Main
+int main(int argc, char** argv)
+{
+    if(argc >= 4 && strcmp(argv[1],"-ids") == 0)
+    {
+        namesOnly = true;
+        return read_list(argv[2]) != 0 || write_ids(argv[3],argv[2]) != 0;
+    }
+
+    if(argc < 3)
+    {
+        printf("Usage: %s <asset list> <output archive>\n",argv[0]);
+        printf("       %s -ids <asset list> <output header>\n",argv[0]);
+        return 1;
+    }
+
+    if(read_list(argv[1]) != 0 || write_archive(argv[2]) != 0)
+    {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,968 @@
+/// Stage solver (source)
+/// (c) 2018 Jani Nykänen
+///
+/// Finds the least turns needed to beat a stage, with a
+/// breadth-first search over the states between the turns.
+/// The states of a turn count are expanded on worker threads
+/// that take them in chunks from a shared cursor, and share
+/// the set of the visited state hashes. The states are
+/// stored packed, a few dozen bytes each.
+///
+/// The enemies multiply the states, since they move on every
+/// turn, but only a few of their placements matter. A search of
+/// a width keeps at most that many states of each layout, the
+/// states that differ only by the enemies. It is fast, but the
+/// solution it finds is not always the shortest one.
+///
+/// Usage: solve [-j jobs] [-m max states] [-w width] [-l stage list] [stage files]
+/// The stage files are searched fully, or with the given width.
+/// With a stage list the listed stages are searched with the
+/// widths 1, 2, 4 and so on, up to the given width or 64, until
+/// their turn targets are reached
+
+#include "../src/sim/sim.h"
+#include "../src/engine/workers.h"
+#include "../src/menu/info.h"
+
+#include "SDL2/SDL.h"
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+// Maximum amount of stages in a list
+#define LIST_MAX 25
+// States taken from the cursor at a time
+#define CHUNK 16
+// Key table shards
+#define SHARD_COUNT 256
+// Path buffer size
+#define PATH_SIZE 1024
+// Maximum width of the searches of a stage list
+#define LIST_WIDTH 64
+
+// Action names
+static const char* ACTION_NAMES[] = {"L","R","U","D","JL","JR","PJL","PJR"};
+
+// Growable array
+typedef struct
+{
+    Uint8* data;
+    size_t count;
+    size_t capacity;
+    size_t size;
+}
+ARRAY;
+
+// Search node
+typedef struct
+{
+    int parent;
+    int action;
+}
+NODE;
+
+// A state found by a worker. In the list of the new
+// nodes it is followed by the packed state itself
+typedef struct
+{
+    int parent;
+    int action;
+    Uint64 key;
+    Uint64 layout; // Layout hash, if the width is limited
+    size_t size; // Packed size
+}
+FOUND;
+
+// Key table shard, open addressing. Each key has a count
+typedef struct
+{
+    Uint64* keys;
+    Uint16* counts;
+    size_t capacity;
+    size_t count;
+    SDL_SpinLock lock;
+}
+SHARD;
+
+// Key table, each shard has a lock of its own
+typedef struct
+{
+    SHARD shards[SHARD_COUNT];
+}
+TABLE;
+
+typedef struct SOLVER SOLVER;
+
+// Worker
+typedef struct
+{
+    SOLVER* solver;
+
+    ARRAY found; // New nodes, bytes
+    ARRAY next; // Found a turn later, not yet visited
+    int goalTurns;
+    int goalParent;
+    int goalAction;
+    bool failed;
+}
+WORKER;
+
+// Solver
+struct SOLVER
+{
+    const STAGE* stage;
+    size_t packedSize;
+    size_t maxStates;
+    int width; // 0 if not limited
+
+    ARRAY nodes;
+    ARRAY found; // The nodes found by the workers, in key order
+    // The packed states of the current turn count and their
+    // offsets, the first one is the state of node "first"
+    ARRAY states;
+    ARRAY offsets;
+    int first;
+
+    // Level states or candidates to handle
+    size_t start;
+    size_t end;
+    const FOUND* candidates;
+    SDL_atomic_t cursor;
+
+    TABLE visited;
+    TABLE layouts; // States kept of each layout
+    size_t visitedCount;
+
+    WORKER workers[MAX_WORKERS];
+    int jobs;
+};
+
+// Solution
+typedef struct
+{
+    int turns; // -1 if there is none
+    int moves[PATH_SIZE];
+    int moveCount;
+    size_t states;
+    bool gaveUp; // The state limit was reached
+}
+SOLUTION;
+
+
+// Initialize an array
+static void array_init(ARRAY* a, size_t size)
+{
+    a->data = NULL;
+    a->count = 0;
+    a->capacity = 0;
+    a->size = size;
+}
+
+
+// Add elements to an array
+// > The first element, NULL on error
+static void* array_push_n(ARRAY* a, size_t n)
+{
+    if(a->count + n > a->capacity)
+    {
+        size_t cap = a->capacity == 0 ? 64 : a->capacity*2;
+        while(cap < a->count + n)
+            cap *= 2;
+
+        Uint8* data = (Uint8*)realloc(a->data,cap * a->size);
+        if(data == NULL) return NULL;
+
+        a->data = data;
+        a->capacity = cap;
+    }
+
+    void* p = a->data + a->count * a->size;
+    a->count += n;
+    return p;
+}
+
+
+// Add an element to an array
+// > Element, NULL on error
+static void* array_push(ARRAY* a)
+{
+    return array_push_n(a,1);
+}
+
+
+// Get an array element
+static void* array_get(const ARRAY* a, size_t i)
+{
+    return a->data + i * a->size;
+}
+
+
+// Free an array
+static void array_free(ARRAY* a)
+{
+    free(a->data);
+    array_init(a,a->size);
+}
+
+
+// Get the key of the current state, the hash of everything
+// the rules read between the turns but the turn count
+static Uint64 state_key()
+{
+    Uint64 h = sim_get_hash();
+
+    // Zero marks a free slot in the visited set
+    return h == 0 ? 1 : h;
+}
+
+
+// Add a key to a table, unless it is there the
+// maximum amount of times
+// < max Maximum count, 1 for a set
+// > True, if it was added
+static bool table_add(TABLE* t, Uint64 key, int max)
+{
+    SHARD* sh = &t->shards[(key >> 56) % SHARD_COUNT];
+    bool added = false;
+
+    SDL_AtomicLock(&sh->lock);
+
+    size_t mask = sh->capacity-1;
+    size_t i = (size_t)key & mask;
+    while(sh->keys[i] != 0 && sh->keys[i] != key)
+    {
+        i = (i+1) & mask;
+    }
+    if(sh->keys[i] == 0)
+    {
+        sh->keys[i] = key;
+        sh->counts[i] = 0;
+        ++ sh->count;
+    }
+    if(sh->counts[i] < max)
+    {
+        ++ sh->counts[i];
+        added = true;
+    }
+
+    SDL_AtomicUnlock(&sh->lock);
+
+    return added;
+}
+
+
+// Make room for new keys in a table, so that
+// the shards stay at most half full. Called
+// between the passes only
+// > 0 on success, 1 on error
+static int table_reserve(TABLE* t, size_t newKeys)
+{
+    // The keys are spread evenly, but leave room
+    // for twice the share of the new keys
+    size_t share = newKeys / SHARD_COUNT * 2 + 32;
+
+    SHARD* sh;
+    Uint64* keys;
+    Uint16* counts;
+    size_t need, cap, i, j;
+    int k = 0;
+    for(; k < SHARD_COUNT; ++ k)
+    {
+        sh = &t->shards[k];
+        need = (sh->count + share) * 2;
+        if(sh->capacity >= need) continue;
+
+        cap = sh->capacity == 0 ? 64 : sh->capacity;
+        while(cap < need)
+            cap *= 2;
+
+        keys = (Uint64*)calloc(cap,sizeof(Uint64));
+        counts = (Uint16*)malloc(cap * sizeof(Uint16));
+        if(keys == NULL || counts == NULL)
+        {
+            free(keys);
+            free(counts);
+            return 1;
+        }
+
+        for(i = 0; i < sh->capacity; ++ i)
+        {
+            if(sh->keys[i] == 0) continue;
+
+            j = (size_t)sh->keys[i] & (cap-1);
+            while(keys[j] != 0)
+                j = (j+1) & (cap-1);
+            keys[j] = sh->keys[i];
+            counts[j] = sh->counts[i];
+        }
+        free(sh->keys);
+        free(sh->counts);
+        sh->keys = keys;
+        sh->counts = counts;
+        sh->capacity = cap;
+    }
+    return 0;
+}
+
+
+// Get the amount of keys in a table
+static size_t table_count(const TABLE* t)
+{
+    size_t count = 0;
+    int i = 0;
+    for(; i < SHARD_COUNT; ++ i)
+    {
+        count += t->shards[i].count;
+    }
+    return count;
+}
+
+
+// Free a table
+static void table_free(TABLE* t)
+{
+    int i = 0;
+    for(; i < SHARD_COUNT; ++ i)
+    {
+        free(t->shards[i].keys);
+        free(t->shards[i].counts);
+    }
+}
+
+
+// Get the size of a found node with its state,
+// the headers must stay aligned
+static size_t found_size(size_t packed)
+{
+    return (sizeof(FOUND) + packed + 7) / 8 * 8;
+}
+
+
+// Store a new node with the current state
+static void add_found(WORKER* w, int parent, int action, Uint64 key)
+{
+    // Room is made for the largest state
+    size_t pos = w->found.count;
+    FOUND* f = (FOUND*)array_push_n(&w->found,found_size(w->solver->packedSize));
+    if(f == NULL)
+    {
+        w->failed = true;
+        return;
+    }
+    f->parent = parent;
+    f->action = action;
+    f->key = key;
+    f->layout = w->solver->width > 0 ? sim_get_layout_hash() : 0;
+    f->size = sim_pack(f+1);
+    w->found.count = pos + found_size(f->size);
+}
+
+
+// Get a packed state of the current turn count
+static const void* get_state(const SOLVER* s, size_t i)
+{
+    return array_get(&s->states,*(size_t*)array_get(&s->offsets,i));
+}
+
+
+// Take the actions in a state of the current turn count
+static void expand(SOLVER* s, WORKER* w, size_t i)
+{
+    const void* state = get_state(s,i);
+    int parent = s->first + (int)i;
+
+    sim_unpack(state);
+    Uint64 oldKey = state_key();
+
+    Uint64 key;
+    FOUND* f;
+    int r, turns;
+    int a = 0;
+    for(; a < ACTION_COUNT; ++ a)
+    {
+        sim_unpack(state);
+        r = sim_step(a);
+        if(r == SIM_DEAD || r == SIM_STUCK) continue;
+
+        if(r == SIM_WON)
+        {
+            turns = sim_state().turns;
+            if(w->goalParent < 0 || turns < w->goalTurns)
+            {
+                w->goalTurns = turns;
+                w->goalParent = parent;
+                w->goalAction = a;
+            }
+            continue;
+        }
+
+        // Some actions change the stage without taking
+        // a turn, like pushing when a jump is blocked
+        key = state_key();
+        if(r == SIM_NONE)
+        {
+            if(key != oldKey && table_add(&s->visited,key,1))
+                add_found(w,parent,a,key);
+            continue;
+        }
+
+        // Visited when all the states of
+        // this turn count are known
+        f = (FOUND*)array_push(&w->next);
+        if(f == NULL)
+        {
+            w->failed = true;
+            return;
+        }
+        f->parent = parent;
+        f->action = a;
+        f->key = key;
+    }
+}
+
+
+// Make a node of a candidate of the next turn count
+static void take_candidate(SOLVER* s, WORKER* w, size_t i)
+{
+    const FOUND* c = &s->candidates[i];
+    if(!table_add(&s->visited,c->key,1)) return;
+
+    // Only the parent state is stored
+    sim_unpack(get_state(s,c->parent - s->first));
+    sim_step(c->action);
+
+    add_found(w,c->parent,c->action,c->key);
+}
+
+
+// Worker job
+static int solve_job(void* data)
+{
+    WORKER* w = (WORKER*)data;
+    SOLVER* s = w->solver;
+
+    // The simulation is per thread
+    if(sim_load(s->stage) != 0)
+    {
+        w->failed = true;
+        return 1;
+    }
+    sim_set_instant(true);
+
+    int count = (int)(s->end - s->start);
+    size_t i, end;
+    int pos;
+    while(!w->failed && (pos = SDL_AtomicAdd(&s->cursor,CHUNK)) < count)
+    {
+        end = s->start + pos + CHUNK;
+        if(end > s->end) end = s->end;
+
+        for(i = s->start + pos; i < end; ++ i)
+        {
+            if(s->candidates == NULL)
+                expand(s,w,i);
+            else
+                take_candidate(s,w,i);
+        }
+    }
+    return w->failed ? 1 : 0;
+}
+
+
+// Run a pass on the workers
+// < start First index
+// < end Index after the last
+// < candidates Candidates, NULL to expand level states
+// > 0 on success, 1 on error
+static int run_pass(SOLVER* s, size_t start, size_t end, const FOUND* candidates)
+{
+    JOB jobs[MAX_WORKERS];
+    WORKER* w;
+
+    s->start = start;
+    s->end = end;
+    s->candidates = candidates;
+    SDL_AtomicSet(&s->cursor,0);
+
+    int i = 0;
+    for(; i < s->jobs; ++ i)
+    {
+        w = &s->workers[i];
+        w->found.count = 0;
+        w->next.count = 0;
+        w->failed = false;
+
+        jobs[i].run = solve_job;
+        jobs[i].data = w;
+    }
+    run_jobs(jobs,s->jobs,NULL,NULL);
+
+    s->visitedCount = table_count(&s->visited);
+
+    for(i = 0; i < s->jobs; ++ i)
+    {
+        if(s->workers[i].failed)
+            return 1;
+    }
+    return 0;
+}
+
+
+// Compare found nodes by their keys
+static int compare_found(const void* a, const void* b)
+{
+    Uint64 ka = (*(const FOUND**)a)->key;
+    Uint64 kb = (*(const FOUND**)b)->key;
+
+    return ka < kb ? -1 : (ka > kb ? 1 : 0);
+}
+
+
+// Move the new nodes of the workers to the node list. They
+// are sorted by their keys, so that the same nodes are kept
+// of each layout however the work was split
+// < states Where to store their states
+// < offsets Where to store the offsets of the states
+// > 0 on success, 1 on error
+static int add_nodes(SOLVER* s, ARRAY* states, ARRAY* offsets)
+{
+    WORKER* w;
+    FOUND* f;
+    FOUND** p;
+    NODE* n;
+    size_t* off;
+    void* st;
+    size_t pos;
+    int i = 0;
+
+    s->found.count = 0;
+    for(; i < s->jobs; ++ i)
+    {
+        w = &s->workers[i];
+        for(pos = 0; pos < w->found.count; pos += found_size(f->size))
+        {
+            f = (FOUND*)array_get(&w->found,pos);
+            p = (FOUND**)array_push(&s->found);
+            if(p == NULL) return 1;
+
+            *p = f;
+        }
+    }
+    if(s->found.count > 0)
+        qsort(s->found.data,s->found.count,sizeof(FOUND*),compare_found);
+
+    if(s->width > 0 && table_reserve(&s->layouts,s->found.count) != 0)
+        return 1;
+
+    for(pos = 0; pos < s->found.count; ++ pos)
+    {
+        f = *(FOUND**)array_get(&s->found,pos);
+        if(s->width > 0 && !table_add(&s->layouts,f->layout,s->width))
+            continue;
+
+        n = (NODE*)array_push(&s->nodes);
+        off = (size_t*)array_push(offsets);
+        if(n == NULL || off == NULL) return 1;
+
+        *off = states->count;
+        st = array_push_n(states,f->size);
+        if(st == NULL) return 1;
+
+        n->parent = f->parent;
+        n->action = f->action;
+        memcpy(st,f+1,f->size);
+    }
+    return 0;
+}
+
+
+// Store the path to the goal
+static void store_path(SOLVER* s, int parent, int action, SOLUTION* sol)
+{
+    int count = 1;
+    int i = parent;
+    for(; i > 0; i = ((NODE*)array_get(&s->nodes,i))->parent)
+    {
+        ++ count;
+    }
+    if(count > PATH_SIZE)
+        count = PATH_SIZE;
+    sol->moveCount = count;
+
+    sol->moves[-- count] = action;
+    for(i = parent; i > 0 && count > 0; i = ((NODE*)array_get(&s->nodes,i))->parent)
+    {
+        sol->moves[-- count] = ((NODE*)array_get(&s->nodes,i))->action;
+    }
+}
+
+
+// Search the least turns
+// > 0 on success, 1 on error
+static int search(SOLVER* s, SOLUTION* sol)
+{
+    ARRAY candidates;
+    ARRAY next;
+    ARRAY nextOffsets;
+    WORKER* w;
+    NODE* n;
+    FOUND* f;
+    size_t pos, end, j;
+    int i;
+
+    array_init(&candidates,sizeof(FOUND));
+
+    // The root node
+    n = (NODE*)array_push(&s->nodes);
+    size_t* off = (size_t*)array_push(&s->offsets);
+    void* st = array_push_n(&s->states,s->packedSize);
+    if(n == NULL || off == NULL || st == NULL) return 1;
+
+    n->parent = -1;
+    n->action = -1;
+    *off = 0;
+    s->states.count = sim_pack(st);
+    if(table_reserve(&s->visited,1) != 0
+     || table_reserve(&s->layouts,1) != 0)
+        return 1;
+    table_add(&s->visited,state_key(),1);
+    table_add(&s->layouts,sim_get_layout_hash(),1);
+    s->first = 0;
+
+    for(;;)
+    {
+        int goalTurns = -1;
+        int goalParent = -1;
+        int goalAction = -1;
+        for(i = 0; i < s->jobs; ++ i)
+        {
+            s->workers[i].goalParent = -1;
+        }
+
+        // Expand the states of this turn count, and then
+        // the ones found from them without taking a turn
+        candidates.count = 0;
+        for(pos = 0; pos < s->offsets.count; pos = end)
+        {
+            end = s->offsets.count;
+            if(table_reserve(&s->visited,(end-pos) * ACTION_COUNT) != 0
+             || run_pass(s,pos,end,NULL) != 0
+             || add_nodes(s,&s->states,&s->offsets) != 0)
+                goto ERROR;
+
+            for(i = 0; i < s->jobs; ++ i)
+            {
+                w = &s->workers[i];
+                for(j = 0; j < w->next.count; ++ j)
+                {
+                    f = (FOUND*)array_push(&candidates);
+                    if(f == NULL) goto ERROR;
+                    *f = *(FOUND*)array_get(&w->next,j);
+                }
+            }
+        }
+
+        // The goal is found from the first turn count
+        // that leads to it, the order picks the path
+        for(i = 0; i < s->jobs; ++ i)
+        {
+            w = &s->workers[i];
+            if(w->goalParent < 0) continue;
+
+            if(goalParent < 0 || w->goalTurns < goalTurns
+             || (w->goalTurns == goalTurns && (w->goalParent < goalParent
+                || (w->goalParent == goalParent && w->goalAction < goalAction))))
+            {
+                goalTurns = w->goalTurns;
+                goalParent = w->goalParent;
+                goalAction = w->goalAction;
+            }
+        }
+        if(goalParent >= 0)
+        {
+            sol->turns = goalTurns;
+            store_path(s,goalParent,goalAction,sol);
+            break;
+        }
+
+        if(candidates.count == 0)
+            break;
+
+        if(s->visitedCount > s->maxStates)
+        {
+            sol->gaveUp = true;
+            break;
+        }
+
+        // Visit the candidates of the next turn count
+        array_init(&next,1);
+        array_init(&nextOffsets,sizeof(size_t));
+        int first = (int)s->nodes.count;
+        if(table_reserve(&s->visited,candidates.count) != 0
+         || run_pass(s,0,candidates.count,(const FOUND*)candidates.data) != 0
+         || add_nodes(s,&next,&nextOffsets) != 0)
+        {
+            array_free(&next);
+            array_free(&nextOffsets);
+            goto ERROR;
+        }
+
+        array_free(&s->states);
+        array_free(&s->offsets);
+        s->states = next;
+        s->offsets = nextOffsets;
+        s->first = first;
+    }
+
+    sol->states = s->visitedCount;
+    array_free(&candidates);
+    return 0;
+
+ERROR:
+    array_free(&candidates);
+    return 1;
+}
+
+
+// Check the solution on this thread
+// > 0 if it beats the stage in the same turns
+static int verify(const STAGE* stage, const SOLUTION* sol)
+{
+    if(sim_load(stage) != 0) return 1;
+    sim_set_instant(true);
+
+    int r = SIM_NONE;
+    int i = 0;
+    for(; i < sol->moveCount; ++ i)
+    {
+        r = sim_step(sol->moves[i]);
+    }
+    return r == SIM_WON && sim_state().turns == sol->turns ? 0 : 1;
+}
+
+
+// Solve a stage
+// < stage Stage
+// < jobs Job count
+// < maxStates Maximum amount of states
+// < width States kept of each layout, 0 for no limit
+// < sol Solution
+// > 0 on success, 1 on error
+static int solve(const STAGE* stage, int jobs, size_t maxStates, int width, SOLUTION* sol)
+{
+    SOLVER* s = (SOLVER*)calloc(1,sizeof(SOLVER));
+    if(s == NULL) return 1;
+
+    sol->turns = -1;
+    sol->moveCount = 0;
+    sol->states = 0;
+    sol->gaveUp = false;
+
+    // Needed for the state size
+    if(sim_load(stage) != 0)
+    {
+        free(s);
+        return 1;
+    }
+    sim_set_instant(true);
+
+    s->stage = stage;
+    s->packedSize = sim_get_packed_size();
+    s->maxStates = maxStates;
+    s->width = width;
+    s->jobs = jobs;
+
+    array_init(&s->nodes,sizeof(NODE));
+    array_init(&s->found,sizeof(FOUND*));
+    array_init(&s->states,1);
+    array_init(&s->offsets,sizeof(size_t));
+
+    int i = 0;
+    for(; i < jobs; ++ i)
+    {
+        s->workers[i].solver = s;
+        array_init(&s->workers[i].found,1);
+        array_init(&s->workers[i].next,sizeof(FOUND));
+    }
+
+    int ret = search(s,sol);
+
+    for(i = 0; i < jobs; ++ i)
+    {
+        array_free(&s->workers[i].found);
+        array_free(&s->workers[i].next);
+    }
+    table_free(&s->visited);
+    table_free(&s->layouts);
+    array_free(&s->nodes);
+    array_free(&s->found);
+    array_free(&s->states);
+    array_free(&s->offsets);
+    free(s);
+
+    if(ret == 0 && sol->turns >= 0 && verify(stage,sol) != 0)
+    {
+        fprintf(stderr,"The solution does not replay\n");
+        return 1;
+    }
+    return ret;
+}
+
+
+// Solve a stage file and print the solution. With a target,
+// the searches are widened until the target is reached
+// < path Stage file
+// < target Turn target, -1 if none
+// < width States kept of each layout, 0 for no limit. With
+//   a target, the widest search
+// > 0 on success, 1 on error or if the target is not reached
+static int solve_file(const char* path, int target, int jobs, size_t maxStates, int width)
+{
+    STAGE* stage = load_stage(path);
+    if(stage == NULL)
+    {
+        fprintf(stderr,"Failed to load %s\n",path);
+        return 1;
+    }
+
+    SOLUTION sol;
+    int w = target >= 0 && width > 0 ? 1 : width;
+    size_t states = 0;
+    int ret;
+    Uint64 start = SDL_GetPerformanceCounter();
+    for(;;)
+    {
+        ret = solve(stage,jobs,maxStates,w,&sol);
+        states += sol.states;
+        if(ret != 0 || target < 0 || w >= width
+         || (sol.turns >= 0 && sol.turns <= target))
+            break;
+
+        w = w*2 < width ? w*2 : width;
+    }
+    float time = (float)(SDL_GetPerformanceCounter() - start)
+        / (float)SDL_GetPerformanceFrequency();
+    destroy_stage(stage);
+
+    if(ret != 0)
+    {
+        printf("%s: failed\n",path);
+        return 1;
+    }
+
+    // Only a full search proves that there
+    // is no solution or no shorter one
+    if(sol.turns < 0)
+    {
+        if(sol.gaveUp)
+            printf("%s: gave up",path);
+        else if(w > 0)
+            printf("%s: no solution with width %d",path,w);
+        else
+            printf("%s: no solution",path);
+
+        if(target >= 0)
+            printf(", target %d not reached",target);
+        printf(", %lu states, %.2f s\n",(unsigned long)states,time);
+        return 1;
+    }
+
+    printf("%s: %d turns",path,sol.turns);
+    if(w > 0)
+        printf(" with width %d",w);
+    if(target >= 0)
+    {
+        if(target < sol.turns)
+            printf(w > 0 ? ", target %d not reached" : ", target %d cannot be reached",target);
+        else if(target > sol.turns)
+            printf(", target %d can be beaten",target);
+    }
+    printf(", %lu states, %.2f s\n",(unsigned long)states,time);
+
+    int i = 0;
+    for(; i < sol.moveCount; ++ i)
+    {
+        printf("%s%s",i == 0 ? "    " : " ",ACTION_NAMES[sol.moves[i]]);
+    }
+    printf("\n");
+    fflush(stdout);
+
+    return target >= 0 && target < sol.turns ? 1 : 0;
+}
+
+
+// Solve the stages in a list
+// > 0 on success, 1 on error
+static int solve_list(const char* path, int jobs, size_t maxStates, int width)
+{
+    if(load_stage_info(LIST_MAX,path) != 0)
+    {
+        fprintf(stderr,"Failed to load %s\n",path);
+        return 1;
+    }
+
+    // The stages are in the "stages" folder next to the list
+    const char* slash = strrchr(path,'/');
+    int dirLen = slash == NULL ? 0 : (int)(slash-path) +1;
+
+    char file[256];
+    STAGE_INFO info;
+    int ret = 0;
+    int i = 0;
+    for(; i < LIST_MAX; ++ i)
+    {
+        info = get_stage_info(i);
+        printf("\"%s\"\n",info.name);
+
+        snprintf(file,sizeof(file),"%.*sstages/%s.stg",dirLen,path,info.assetName);
+        ret |= solve_file(file,info.turnCount,jobs,maxStates,width);
+    }
+    return ret;
+}
+
+
+// Main
+int main(int argc, char** argv)
+{
+    int jobs = SDL_GetCPUCount();
+    size_t maxStates = 100000000;
+    int width = -1;
+    const char* list = NULL;
+    int ret = 0;
+    int i = 1;
+
+    for(; i < argc-1 && argv[i][0] == '-'; i += 2)
+    {
+        if(strcmp(argv[i],"-j") == 0)
+            jobs = (int)strtol(argv[i+1],NULL,10);
+        else if(strcmp(argv[i],"-m") == 0)
+            maxStates = (size_t)strtoull(argv[i+1],NULL,10);
+        else if(strcmp(argv[i],"-w") == 0)
+            width = (int)strtol(argv[i+1],NULL,10);
+        else if(strcmp(argv[i],"-l") == 0)
+            list = argv[i+1];
+        else
+            break;
+    }
+    if(list == NULL && i >= argc)
+    {
+        printf("Usage: %s [-j jobs] [-m max states] [-w width] [-l stage list] [stage files]\n",argv[0]);
+        return 1;
+    }
+
+    if(jobs < 1) jobs = 1;
+    if(jobs > MAX_WORKERS) jobs = MAX_WORKERS;
+    // The counts of the layouts are 16-bit
+    if(width > 0xFFFF) width = 0xFFFF;
+
+    if(list != NULL)
+        ret |= solve_list(list,jobs,maxStates,width < 0 ? LIST_WIDTH : width);
+
+    for(; i < argc; ++ i)
+    {
+        ret |= solve_file(argv[i],-1,jobs,maxStates,width < 0 ? 0 : width);
+    }
+
+    return ret;
+}
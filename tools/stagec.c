@@ -0,0 +1,55 @@
+/// Stage compiler (source)
+/// (c) 2018 Jani Nykänen
+///
+/// Compiles a TMX stage to a stage file that can be
+/// loaded with load_stage.
+/// Usage: stagec <input tmx> <output stage>
+
+// Only the zlib decoder is needed, for compressed layers. The
+// whole implementation is built, like in the packer, since
+// leaving decoders out leaves unused functions behind
+#define STB_IMAGE_IMPLEMENTATION
+#include "../src/lib/stb_image.h"
+
+#include "../src/lib/tmxc.h"
+#include "../src/lib/stagefile.h"
+
+#include "../src/game/tiles.h"
+
+#include "SDL2/SDL.h"
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+
+// Main
+int main(int argc, char** argv)
+{
+    if(argc < 3)
+    {
+        printf("Usage: %s <input tmx> <output stage>\n",argv[0]);
+        return 1;
+    }
+
+    TILEMAP* t = load_tilemap(argv[1]);
+    if(t == NULL) return 1;
+
+    size_t size;
+    uint8_t* data = compile_stage(t,is_spawn_tile,&size);
+    destroy_tilemap(t);
+    if(data == NULL) return 1;
+
+    FILE* f = fopen(argv[2],"wb");
+    if(f == NULL || fwrite(data,1,size,f) != size)
+    {
+        fprintf(stderr,"Failed to write %s\n",argv[2]);
+        if(f != NULL) fclose(f);
+        free(data);
+        return 1;
+    }
+    fclose(f);
+    free(data);
+
+    return 0;
+}